@@ -48,6 +48,14 @@ $(DSP_MOUNT_POINT): $(LOCAL_INSTALLED_MODULE)
 
 ALL_DEFAULT_INSTALLED_MODULES += $(FIRMWARE_MOUNT_POINT) $(BT_FIRMWARE_MOUNT_POINT) $(DSP_MOUNT_POINT)
 
+# Firmware images dropped in radio/ end up in RADIO/ of the target files,
+# releasetools.py flashes them from the OTA.
+ifeq ($(ADD_RADIO_FILES),true)
+RADIO_FILES := $(notdir $(wildcard $(addprefix $(LOCAL_PATH)/radio/,xbl.img tz.img hyp.img modem.img dsp.img abl.img)))
+$(foreach f, $(RADIO_FILES), \
+    $(call add-radio-file,radio/$(f)))
+endif
+
 IMS_LIBS := libimscamera_jni.so libimsmedia_jni.so
 IMS_SYMLINKS := $(addprefix $(TARGET_OUT_SYSTEM_EXT_APPS_PRIVILEGED)/ims/lib/arm64/,$(notdir $(IMS_LIBS)))
 $(IMS_SYMLINKS): $(LOCAL_INSTALLED_MODULE)
@@ -203,6 +203,9 @@ TARGET_RECOVERY_UI_MARGIN_HEIGHT := 120
 TARGET_RECOVERY_UPDATER_LIBS := librecovery_updater_raphael
 TARGET_RELEASETOOLS_EXTENSIONS := $(DEVICE_PATH)
 
+# Ship the firmware from $(DEVICE_PATH)/radio in the OTA
+ADD_RADIO_FILES ?= false
+
 # RIL
 ENABLE_VENDOR_RIL_SERVICE := true
 
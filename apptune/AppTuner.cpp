@@ -0,0 +1,118 @@
+/*
+ * Copyright (C) 2021 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "AppTuner.h"
+
+#include <algorithm>
+
+namespace apptune {
+
+AppTuner::AppTuner(const Profiles& profiles, Resolver resolver)
+    : profiles_(profiles), resolver_(std::move(resolver)), pending_(false) {}
+
+AppTuner::Process* AppTuner::resolve(pid_t pid) {
+    auto it = processes_.find(pid);
+    if (it == processes_.end()) {
+        it = processes_.emplace(pid, Process{std::nullopt, "", 0, false}).first;
+    }
+    Process& p = it->second;
+    p.seen = true;
+    if (p.retries < 0) {
+        return &p;
+    }
+
+    std::optional<std::string> name = resolver_(pid);
+    if (!name && ++p.retries < kMaxRetries) {
+        pending_ = true;
+        return nullptr;
+    }
+    // Resolved, or given up on.
+    p.retries = -1;
+    if (name) {
+        p.classIndex = profiles_.find(*name);
+        p.name = std::move(*name);
+    }
+    return &p;
+}
+
+Plan AppTuner::update(const GroupMembers (&members)[kNumGroups]) {
+    const std::vector<AppClass>& classes = profiles_.classes();
+    Plan plan = {{}, -1, -1, ""};
+    pending_ = false;
+    for (auto& [pid, p] : processes_) {
+        p.seen = false;
+    }
+
+    for (size_t g = 0; g < kNumGroups; g++) {
+        Group group = static_cast<Group>(g);
+        const GroupMembers& m = members[g];
+
+        for (pid_t pid : m.direct) {
+            const Process* p = resolve(pid);
+            if (p == nullptr || !p->classIndex) {
+                continue;
+            }
+            size_t c = *p->classIndex;
+            if (!classes[c].cpus[g].empty()) {
+                plan.moves.push_back({pid, group, c});
+            }
+            if (group == Group::TOP_APP) {
+                plan.topApp = p->name;
+                plan.topClass = classes[c].name;
+            }
+        }
+
+        // Placed processes only ever got there through a resolved name.
+        for (size_t c = 0; c < m.placed.size(); c++) {
+            for (pid_t pid : m.placed[c]) {
+                const Process* p = resolve(pid);
+                if (group == Group::TOP_APP && p != nullptr) {
+                    plan.topApp = p->name;
+                    plan.topClass = classes[c].name;
+                }
+            }
+        }
+    }
+
+    // The clamps of every profiled app on top, the strongest boost and the
+    // loosest cap win.
+    auto applyClamps = [&](const AppClass& cls) {
+        plan.uclampMin = std::max(plan.uclampMin, cls.uclampMin);
+        if (cls.uclampMax >= 0) {
+            plan.uclampMax = std::max(plan.uclampMax, cls.uclampMax);
+        }
+    };
+    const GroupMembers& top = members[static_cast<size_t>(Group::TOP_APP)];
+    for (pid_t pid : top.direct) {
+        auto it = processes_.find(pid);
+        if (it != processes_.end() && it->second.classIndex) {
+            applyClamps(classes[*it->second.classIndex]);
+        }
+    }
+    for (size_t c = 0; c < top.placed.size(); c++) {
+        if (!top.placed[c].empty()) {
+            applyClamps(classes[c]);
+        }
+    }
+
+    // Gone from every watched group, the pid may be reused by anything.
+    for (auto it = processes_.begin(); it != processes_.end();) {
+        it = it->second.seen ? std::next(it) : processes_.erase(it);
+    }
+    return plan;
+}
+
+}  // namespace apptune
@@ -0,0 +1,91 @@
+/*
+ * Copyright (C) 2021 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <sys/types.h>
+
+#include <functional>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "Profiles.h"
+
+namespace apptune {
+
+// The processes found in a group and in the child cpusets of its classes.
+struct GroupMembers {
+    std::vector<pid_t> direct;
+    // Indexed by class, empty for classes without a child of this group.
+    std::vector<std::vector<pid_t>> placed;
+};
+
+struct Move {
+    pid_t pid;
+    Group group;
+    size_t classIndex;
+};
+
+// Everything one transition has to write.
+struct Plan {
+    std::vector<Move> moves;
+    // Clamps for the top-app group in percent, -1 restores the default.
+    int uclampMin;
+    int uclampMax;
+    // The profiled app on top, for logging, and its class.
+    std::string topApp;
+    std::string topClass;
+};
+
+// Sorts the processes entering top-app and foreground into the child cpusets
+// of their class and picks the top-app clamps. Process names are resolved
+// once per pid and cached for as long as the pid stays in a watched group.
+class AppTuner {
+  public:
+    // Number of passes a process still named after the zygote is retried
+    // before it is given up on.
+    static constexpr int kMaxRetries = 50;
+
+    // Returns the process name, or nullopt if it hasn't been set yet.
+    using Resolver = std::function<std::optional<std::string>(pid_t)>;
+
+    AppTuner(const Profiles& profiles, Resolver resolver);
+
+    Plan update(const GroupMembers (&members)[kNumGroups]);
+
+    // Whether a process was seen before it was named, and needs another pass.
+    bool pending() const { return pending_; }
+
+  private:
+    struct Process {
+        std::optional<size_t> classIndex;
+        std::string name;
+        int retries;
+        bool seen;
+    };
+
+    Process* resolve(pid_t pid);
+
+    const Profiles& profiles_;
+    Resolver resolver_;
+    std::unordered_map<pid_t, Process> processes_;
+    bool pending_;
+};
+
+}  // namespace apptune
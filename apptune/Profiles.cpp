@@ -0,0 +1,157 @@
+/*
+ * Copyright (C) 2021 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Profiles.h"
+
+#include <string.h>
+
+#include <android-base/file.h>
+#include <android-base/logging.h>
+
+namespace apptune {
+
+const char* GroupToString(Group group) {
+    switch (group) {
+        case Group::TOP_APP:
+            return "top-app";
+        case Group::FOREGROUND:
+            return "foreground";
+    }
+    return "unknown";
+}
+
+bool Profiles::load(const std::string& path) {
+    std::string blob;
+    if (!android::base::ReadFileToString(path, &blob)) {
+        PLOG(ERROR) << "Failed to read " << path;
+        return false;
+    }
+    if (!parse(std::move(blob))) {
+        LOG(ERROR) << "Rejecting malformed profiles " << path;
+        return false;
+    }
+    return true;
+}
+
+bool Profiles::parse(std::string blob) {
+    blob_ = std::move(blob);
+    classes_.clear();
+    if (!validate()) {
+        blob_.clear();
+        return false;
+    }
+
+    auto records = reinterpret_cast<const format::ClassRecord*>(blob_.data() +
+                                                                  sizeof(format::Header));
+    for (size_t i = 0; i < header()->numClasses; i++) {
+        const format::ClassRecord& r = records[i];
+        classes_.push_back({
+                .name = string(r.name),
+                .cpus = {string(r.topAppCpus), string(r.foregroundCpus)},
+                .uclampMin = r.uclampMin,
+                .uclampMax = r.uclampMax,
+        });
+    }
+    return true;
+}
+
+size_t Profiles::numPackages() const {
+    return blob_.empty() ? 0 : header()->numPackages;
+}
+
+std::optional<size_t> Profiles::find(std::string_view processName) const {
+    std::string name(processName.substr(0, processName.find(':')));
+    const format::PackageRecord* first = packages();
+    const format::PackageRecord* last = first + numPackages();
+    while (first < last) {
+        const format::PackageRecord* mid = first + (last - first) / 2;
+        int cmp = strcmp(string(mid->name), name.c_str());
+        if (cmp == 0) {
+            return mid->classIndex;
+        }
+        if (cmp < 0) {
+            first = mid + 1;
+        } else {
+            last = mid;
+        }
+    }
+    return std::nullopt;
+}
+
+const format::Header* Profiles::header() const {
+    return reinterpret_cast<const format::Header*>(blob_.data());
+}
+
+const format::PackageRecord* Profiles::packages() const {
+    return reinterpret_cast<const format::PackageRecord*>(
+            blob_.data() + sizeof(format::Header) +
+            header()->numClasses * sizeof(format::ClassRecord));
+}
+
+const char* Profiles::string(uint32_t offset) const {
+    return blob_.data() + header()->stringsOffset + offset;
+}
+
+// Everything the accessors dereference is bounds checked here, once.
+bool Profiles::validate() const {
+    if (blob_.size() < sizeof(format::Header)) {
+        return false;
+    }
+
+    const format::Header* h = header();
+    if (memcmp(h->magic, format::kMagic, sizeof(h->magic)) != 0) {
+        LOG(ERROR) << "Bad magic";
+        return false;
+    }
+    if (h->version != format::kVersion) {
+        LOG(ERROR) << "Unsupported version " << h->version;
+        return false;
+    }
+    if (h->size != blob_.size()) {
+        LOG(ERROR) << "Truncated, expected " << h->size << " bytes, got " << blob_.size();
+        return false;
+    }
+
+    size_t tablesEnd = sizeof(format::Header) + h->numClasses * sizeof(format::ClassRecord) +
+                       static_cast<size_t>(h->numPackages) * sizeof(format::PackageRecord);
+    if (tablesEnd > h->stringsOffset || h->stringsOffset >= blob_.size() ||
+        blob_.back() != '\0') {
+        LOG(ERROR) << "Bad section offsets";
+        return false;
+    }
+
+    size_t stringsSize = blob_.size() - h->stringsOffset;
+    auto classes = reinterpret_cast<const format::ClassRecord*>(blob_.data() +
+                                                                  sizeof(format::Header));
+    for (size_t i = 0; i < h->numClasses; i++) {
+        const format::ClassRecord& c = classes[i];
+        if (c.name >= stringsSize || c.topAppCpus >= stringsSize ||
+            c.foregroundCpus >= stringsSize || c.uclampMin > 100 || c.uclampMax > 100) {
+            LOG(ERROR) << "Bad class record " << i;
+            return false;
+        }
+    }
+    for (size_t i = 0; i < h->numPackages; i++) {
+        const format::PackageRecord& p = packages()[i];
+        if (p.name >= stringsSize || p.classIndex >= h->numClasses) {
+            LOG(ERROR) << "Bad package record " << i;
+            return false;
+        }
+    }
+    return true;
+}
+
+}  // namespace apptune
@@ -0,0 +1,112 @@
+/*
+ * Copyright (C) 2021 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace apptune {
+
+constexpr const char* kProfilesPath = "/vendor/etc/app_profiles.bin";
+
+// On-disk layout written by apptune_compile.py, all fields are little endian:
+//
+//   Header
+//   ClassRecord[numClasses]
+//   PackageRecord[numPackages], sorted by name
+//   strings, NUL terminated, starting with an empty one
+namespace format {
+
+constexpr char kMagic[4] = {'A', 'P', 'P', 'T'};
+constexpr uint16_t kVersion = 1;
+
+struct Header {
+    char magic[4];
+    uint16_t version;
+    uint16_t numClasses;
+    uint32_t numPackages;
+    uint32_t stringsOffset;
+    uint32_t size;
+};
+static_assert(sizeof(Header) == 20);
+
+struct ClassRecord {
+    // Offsets into the string table, the cpu lists are empty when unset.
+    uint32_t name;
+    uint32_t topAppCpus;
+    uint32_t foregroundCpus;
+    // Percent, -1 when unset.
+    int16_t uclampMin;
+    int16_t uclampMax;
+};
+static_assert(sizeof(ClassRecord) == 16);
+
+struct PackageRecord {
+    uint32_t name;
+    uint32_t classIndex;
+};
+static_assert(sizeof(PackageRecord) == 8);
+
+}  // namespace format
+
+// The cgroups apps are refined in, every class gets a child cpuset of each
+// group it has cpus for.
+enum class Group {
+    TOP_APP = 0,
+    FOREGROUND,
+};
+constexpr size_t kNumGroups = 2;
+
+const char* GroupToString(Group group);
+
+struct AppClass {
+    std::string name;
+    // Indexed by Group, empty when the class leaves that group alone.
+    std::string cpus[kNumGroups];
+    int uclampMin;
+    int uclampMax;
+};
+
+// A compiled profile. The classes are decoded up front, packages are looked
+// up in place.
+class Profiles {
+  public:
+    bool load(const std::string& path = kProfilesPath);
+    bool parse(std::string blob);
+
+    const std::vector<AppClass>& classes() const { return classes_; }
+    size_t numPackages() const;
+
+    // Class index of a process, matched by its name up to any ":" suffix.
+    std::optional<size_t> find(std::string_view processName) const;
+
+  private:
+    bool validate() const;
+    const format::Header* header() const;
+    const format::PackageRecord* packages() const;
+    const char* string(uint32_t offset) const;
+
+    std::string blob_;
+    std::vector<AppClass> classes_;
+};
+
+}  // namespace apptune
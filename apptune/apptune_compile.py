@@ -0,0 +1,168 @@
+#!/usr/bin/env python
+#
+# Copyright (C) 2021 The LineageOS Project
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#      http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+#
+
+
+"""Validates the per-app scheduling profiles and compiles them into the binary
+layout read by apptune/Profiles.h."""
+
+import argparse
+import re
+import struct
+import sys
+
+MAGIC = b'APPT'
+VERSION = 1
+
+HEADER = struct.Struct('<4sHHIII')
+CLASS = struct.Struct('<IIIhh')
+PACKAGE = struct.Struct('<II')
+
+NUM_CPUS = 8
+
+CLASS_NAME = re.compile(r'^[a-z][a-z0-9_-]*$')
+PACKAGE_NAME = re.compile(r'^[A-Za-z0-9_]+(\.[A-Za-z0-9_]+)*$')
+
+
+class ProfileError(Exception):
+    pass
+
+
+def parse_cpus(value):
+    for part in value.split(','):
+        bounds = part.split('-')
+        try:
+            first, last = int(bounds[0]), int(bounds[-1])
+        except ValueError:
+            raise ProfileError('malformed cpu list "%s"' % value)
+        if len(bounds) > 2 or first > last or last >= NUM_CPUS:
+            raise ProfileError('malformed cpu list "%s"' % value)
+    return value
+
+
+def parse_percent(key, value):
+    try:
+        percent = int(value)
+    except ValueError:
+        raise ProfileError('%s="%s" is not an integer' % (key, value))
+    if percent < 0 or percent > 100:
+        raise ProfileError('%s=%d is not a percentage' % (key, percent))
+    return percent
+
+
+def parse_class(words):
+    if len(words) < 2 or not CLASS_NAME.match(words[1]):
+        raise ProfileError('class needs a lowercase name')
+    cls = {
+        'name': words[1],
+        'top-app': '',
+        'foreground': '',
+        'uclamp.min': -1,
+        'uclamp.max': -1,
+    }
+    for word in words[2:]:
+        key, sep, value = word.partition('=')
+        if not sep or key not in cls or key == 'name':
+            raise ProfileError('unknown class setting "%s"' % word)
+        if key.startswith('uclamp'):
+            cls[key] = parse_percent(key, value)
+        else:
+            cls[key] = parse_cpus(value)
+    if cls['uclamp.min'] > cls['uclamp.max'] >= 0:
+        raise ProfileError('class %s has uclamp.min above uclamp.max' % cls['name'])
+    if not (cls['top-app'] or cls['foreground'] or cls['uclamp.min'] >= 0 or
+            cls['uclamp.max'] >= 0):
+        raise ProfileError('class %s does not change anything' % cls['name'])
+    return cls
+
+
+def parse(path):
+    classes = []
+    class_index = {}
+    packages = {}
+    with open(path) as f:
+        for lineno, line in enumerate(f, 1):
+            words = line.split('#', 1)[0].split()
+            if not words:
+                continue
+            try:
+                if words[0] == 'class':
+                    cls = parse_class(words)
+                    if cls['name'] in class_index:
+                        raise ProfileError('duplicate class %s' % cls['name'])
+                    class_index[cls['name']] = len(classes)
+                    classes.append(cls)
+                elif words[0] == 'package':
+                    if len(words) != 3 or not PACKAGE_NAME.match(words[1]):
+                        raise ProfileError('expected "package <name> <class>"')
+                    if words[2] not in class_index:
+                        raise ProfileError('unknown class %s' % words[2])
+                    if words[1] in packages:
+                        raise ProfileError('duplicate package %s' % words[1])
+                    packages[words[1]] = class_index[words[2]]
+                else:
+                    raise ProfileError('unknown directive "%s"' % words[0])
+            except ProfileError as e:
+                raise ProfileError('line %d: %s' % (lineno, e))
+    return classes, packages
+
+
+def compile_blob(classes, packages):
+    strings = bytearray(b'\0')
+    string_offsets = {'': 0}
+
+    def intern(s):
+        if s not in string_offsets:
+            string_offsets[s] = len(strings)
+            strings.extend(s.encode('utf-8') + b'\0')
+        return string_offsets[s]
+
+    class_records = bytearray()
+    for c in classes:
+        class_records += CLASS.pack(intern(c['name']), intern(c['top-app']),
+                                    intern(c['foreground']), c['uclamp.min'], c['uclamp.max'])
+
+    # Sorted bytewise, the reader binary searches with strcmp.
+    package_records = bytearray()
+    for name in sorted(packages, key=lambda p: p.encode('utf-8')):
+        package_records += PACKAGE.pack(intern(name), packages[name])
+
+    strings_offset = HEADER.size + len(class_records) + len(package_records)
+    size = strings_offset + len(strings)
+    header = HEADER.pack(MAGIC, VERSION, len(classes), len(packages), strings_offset, size)
+    return header + bytes(class_records + package_records + strings)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument('input', help='profile source')
+    parser.add_argument('output', nargs='?', help='compiled profiles, only validates when omitted')
+    args = parser.parse_args()
+
+    try:
+        classes, packages = parse(args.input)
+    except (ProfileError, IOError) as e:
+        sys.stderr.write('%s: error: %s\n' % (args.input, e))
+        return 1
+
+    if args.output:
+        with open(args.output, 'wb') as f:
+            f.write(compile_blob(classes, packages))
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
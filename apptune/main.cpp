@@ -0,0 +1,324 @@
+/*
+ * Copyright (C) 2021 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "apptuned"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <charconv>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <android-base/file.h>
+#include <android-base/logging.h>
+#include <android-base/properties.h>
+#include <android-base/strings.h>
+#include <android-base/unique_fd.h>
+#include <sysfs/Node.h>
+
+#include "AppTuner.h"
+#include "Profiles.h"
+
+using ::android::base::ReadFileToString;
+using ::android::base::SetProperty;
+using ::android::base::StartsWith;
+using ::android::base::unique_fd;
+
+using ::apptune::AppClass;
+using ::apptune::AppTuner;
+using ::apptune::Group;
+using ::apptune::GroupMembers;
+using ::apptune::GroupToString;
+using ::apptune::kNumGroups;
+using ::apptune::Plan;
+using ::apptune::Profiles;
+
+namespace {
+
+constexpr const char* kCpusetRoot = "/dev/cpuset/";
+constexpr const char* kUclampMinPath = "/dev/cpuctl/top-app/cpu.uclamp.min";
+constexpr const char* kUclampMaxPath = "/dev/cpuctl/top-app/cpu.uclamp.max";
+constexpr const char* kBoostPath = "/dev/stune/top-app/schedtune.boost";
+
+// Set while an app of the game class is on top, the power HAL puts the touch
+// panel into game mode for it.
+constexpr const char* kGameClass = "game";
+constexpr const char* kGameProperty = "vendor.apptune.game";
+
+// How long to wait before looking up a process again which was still named
+// after the zygote.
+constexpr int kRetryMs = 20;
+
+int64_t NowUs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000LL + ts.tv_nsec / 1000;
+}
+
+std::string GroupPath(Group group) {
+    return std::string(kCpusetRoot) + GroupToString(group);
+}
+
+bool ParsePids(const std::string& buf, std::vector<pid_t>* out) {
+    out->clear();
+    const char* p = buf.data();
+    const char* end = p + buf.size();
+    while (p < end) {
+        pid_t pid;
+        auto [next, ec] = std::from_chars(p, end, pid);
+        if (ec != std::errc() || (next < end && *next != '\n')) {
+            return false;
+        }
+        out->push_back(pid);
+        p = next + 1;
+    }
+    return true;
+}
+
+// The name of a specialized app process, nullopt while it is still a bare
+// zygote fork. A process which is gone resolves to an empty name.
+std::optional<std::string> ProcessName(pid_t pid) {
+    std::string cmdline;
+    if (!ReadFileToString(sysfs::Root() + "/proc/" + std::to_string(pid) + "/cmdline",
+                          &cmdline)) {
+        return "";
+    }
+    std::string name = cmdline.substr(0, cmdline.find('\0'));
+    if (name.empty() || name == "<pre-initialized>" || StartsWith(name, "zygote") ||
+        StartsWith(name, "usap")) {
+        return std::nullopt;
+    }
+    return name;
+}
+
+struct Child {
+    // Indexed by class, invalid for classes without a child of the group.
+    std::vector<sysfs::Node> procs;
+};
+
+class Daemon {
+  public:
+    bool init();
+    void run();
+
+  private:
+    bool createChild(Group group, const AppClass& cls, sysfs::Node* procs);
+    bool readMembers(GroupMembers (&members)[kNumGroups]);
+    size_t apply(const Plan& plan);
+
+    Profiles profiles_;
+    sysfs::Node group_procs_[kNumGroups];
+    Child children_[kNumGroups];
+    unique_fd inotify_fd_;
+    sysfs::Node uclamp_min_;
+    sysfs::Node uclamp_max_;
+    std::string default_uclamp_min_;
+    std::string default_uclamp_max_;
+    int applied_uclamp_min_ = -1;
+    int applied_uclamp_max_ = -1;
+    bool applied_game_ = false;
+};
+
+bool Daemon::createChild(Group group, const AppClass& cls, sysfs::Node* procs) {
+    std::string parent = GroupPath(group);
+    std::string path = parent + "/" + cls.name;
+    std::string mems;
+    if ((mkdir((sysfs::Root() + path).c_str(), 0755) < 0 && errno != EEXIST) ||
+        !sysfs::ReadValue(parent + "/mems", &mems) ||
+        !sysfs::WriteValue(path + "/cpus", cls.cpus[static_cast<size_t>(group)]) ||
+        !sysfs::WriteValue(path + "/mems", mems)) {
+        PLOG(ERROR) << "Failed to set up cpuset " << path;
+        return false;
+    }
+    return procs->open(path + "/cgroup.procs", O_RDWR);
+}
+
+bool Daemon::init() {
+    if (!profiles_.load()) {
+        return false;
+    }
+
+    inotify_fd_.reset(inotify_init1(IN_NONBLOCK | IN_CLOEXEC));
+    if (inotify_fd_ < 0) {
+        PLOG(ERROR) << "Failed to create inotify instance";
+        return false;
+    }
+
+    const std::vector<AppClass>& classes = profiles_.classes();
+    size_t numChildren = 0;
+    for (size_t g = 0; g < kNumGroups; g++) {
+        Group group = static_cast<Group>(g);
+        std::string path = GroupPath(group);
+        if (!group_procs_[g].open(path + "/cgroup.procs", O_RDONLY)) {
+            return false;
+        }
+
+        // Apps are moved by pid through cgroup.procs, single threads through
+        // tasks. Both are written on every transition.
+        for (const char* file : {"/cgroup.procs", "/tasks"}) {
+            if (inotify_add_watch(inotify_fd_, (sysfs::Root() + path + file).c_str(),
+                                  IN_MODIFY) < 0) {
+                PLOG(ERROR) << "Failed to watch " << path << file;
+                return false;
+            }
+        }
+
+        children_[g].procs.resize(classes.size());
+        for (size_t c = 0; c < classes.size(); c++) {
+            if (!classes[c].cpus[g].empty() &&
+                createChild(group, classes[c], &children_[g].procs[c])) {
+                numChildren++;
+            }
+        }
+    }
+
+    // Kernels without uclamp get the boost from schedtune instead. It has no
+    // cap, uclamp.max is only applied through cpuctl.
+    struct stat st;
+    if (stat((sysfs::Root() + kUclampMinPath).c_str(), &st) == 0) {
+        uclamp_min_.open(kUclampMinPath, O_RDWR);
+        uclamp_max_.open(kUclampMaxPath, O_RDWR);
+    } else {
+        uclamp_min_.open(kBoostPath, O_RDWR);
+    }
+    uclamp_min_.read(&default_uclamp_min_);
+    if (uclamp_max_.valid()) {
+        uclamp_max_.read(&default_uclamp_max_);
+    }
+
+    LOG(INFO) << "event=start classes=" << classes.size()
+              << " packages=" << profiles_.numPackages() << " cpusets=" << numChildren
+              << " clamp=" << uclamp_min_.path();
+    return true;
+}
+
+bool Daemon::readMembers(GroupMembers (&members)[kNumGroups]) {
+    for (size_t g = 0; g < kNumGroups; g++) {
+        std::string buf;
+        if (!group_procs_[g].read(&buf) || !ParsePids(buf, &members[g].direct)) {
+            LOG(ERROR) << "Malformed " << group_procs_[g].path();
+            return false;
+        }
+
+        const std::vector<sysfs::Node>& procs = children_[g].procs;
+        members[g].placed.resize(procs.size());
+        for (size_t c = 0; c < procs.size(); c++) {
+            members[g].placed[c].clear();
+            if (procs[c].valid() &&
+                (!procs[c].read(&buf) || !ParsePids(buf, &members[g].placed[c]))) {
+                LOG(ERROR) << "Malformed " << procs[c].path();
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// Returns the number of writes.
+size_t Daemon::apply(const Plan& plan) {
+    size_t writes = 0;
+    for (const auto& move : plan.moves) {
+        const sysfs::Node& procs =
+                children_[static_cast<size_t>(move.group)].procs[move.classIndex];
+        // The app may be gone by now, the kernel refuses it with ESRCH.
+        if (procs.valid() && procs.write(move.pid)) {
+            writes++;
+        }
+    }
+
+    if (plan.uclampMin != applied_uclamp_min_) {
+        applied_uclamp_min_ = plan.uclampMin;
+        uclamp_min_.write(plan.uclampMin < 0 ? default_uclamp_min_
+                                             : std::to_string(plan.uclampMin));
+        writes++;
+    }
+    if (plan.uclampMax != applied_uclamp_max_ && uclamp_max_.valid()) {
+        applied_uclamp_max_ = plan.uclampMax;
+        uclamp_max_.write(plan.uclampMax < 0 ? default_uclamp_max_
+                                             : std::to_string(plan.uclampMax));
+        writes++;
+    }
+
+    bool game = plan.topClass == kGameClass;
+    if (game != applied_game_) {
+        applied_game_ = game;
+        SetProperty(kGameProperty, game ? "1" : "0");
+        writes++;
+    }
+    return writes;
+}
+
+void Daemon::run() {
+    AppTuner tuner(profiles_, ProcessName);
+    GroupMembers members[kNumGroups];
+
+    // Whatever is on top when we start counts as the first transition.
+    bool changed = true;
+    while (true) {
+        if (!changed) {
+            struct pollfd pfd = {
+                    .fd = inotify_fd_,
+                    .events = POLLIN,
+                    .revents = 0,
+            };
+            TEMP_FAILURE_RETRY(poll(&pfd, 1, tuner.pending() ? kRetryMs : -1));
+        }
+        int64_t start = NowUs();
+
+        // Every thread of an app is moved separately, the events of one
+        // transition are handled in a single pass.
+        char buf[4096];
+        while (read(inotify_fd_, buf, sizeof(buf)) > 0) {
+        }
+        changed = false;
+
+        if (!readMembers(members)) {
+            continue;
+        }
+
+        Plan plan = tuner.update(members);
+        size_t writes = apply(plan);
+        if (writes == 0) {
+            continue;
+        }
+
+        LOG(INFO) << "event=transition top=" << (plan.topApp.empty() ? "-" : plan.topApp)
+                  << " moves=" << plan.moves.size() << " uclamp_min=" << plan.uclampMin
+                  << " uclamp_max=" << plan.uclampMax << " writes=" << writes
+                  << " apply_us=" << NowUs() - start;
+    }
+}
+
+}  // anonymous namespace
+
+int main() {
+    Daemon daemon;
+    if (!daemon.init()) {
+        return 1;
+    }
+
+    daemon.run();
+    return 1;  // should never get here
+}
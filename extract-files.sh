@@ -66,9 +66,31 @@ function blob_fixup() {
     esac
 }
 
-# Initialize the helper
-setup_vendor "${DEVICE}" "${VENDOR}" "${ANDROID_ROOT}" false "${CLEAN_VENDOR}"
+# Copying from an extracted dump is left to extract_blobs.raphael when it has
+# been built, it works in parallel and skips blobs which haven't changed.
+BLOB_TOOL="$(command -v extract_blobs.raphael || true)"
 
-extract "${MY_DIR}/proprietary-files.txt" "${SRC}" "${KANG}" --section "${SECTION}"
+if [ -d "${SRC}" ] && [ -n "${BLOB_TOOL}" ] && [ -z "${KANG}" ] && [ -z "${SECTION}" ]; then
+    # The tool prunes unlisted blobs itself, a clean would defeat its cache
+    setup_vendor "${DEVICE}" "${VENDOR}" "${ANDROID_ROOT}" false false
+
+    BLOB_ROOT="${ANDROID_ROOT}/${OUTDIR}/proprietary"
+    # The cache already counts every fresh copy as done, so they have to be
+    # fixed up even when some other blob is missing
+    BLOB_STATUS=0
+    COPIED=$("${BLOB_TOOL}" extract "${MY_DIR}/proprietary-files.txt" "${SRC}" "${BLOB_ROOT}") \
+        || BLOB_STATUS=$?
+    for BLOB in ${COPIED}; do
+        blob_fixup "${BLOB}" "${BLOB_ROOT}/${BLOB}"
+    done
+    if [ "${BLOB_STATUS}" -ne 0 ]; then
+        exit "${BLOB_STATUS}"
+    fi
+else
+    # Initialize the helper
+    setup_vendor "${DEVICE}" "${VENDOR}" "${ANDROID_ROOT}" false "${CLEAN_VENDOR}"
+
+    extract "${MY_DIR}/proprietary-files.txt" "${SRC}" "${KANG}" --section "${SECTION}"
+fi
 
 "${MY_DIR}/setup-makefiles.sh"
@@ -0,0 +1,102 @@
+/*
+ * Copyright (C) 2021 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "BlobCache.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <android-base/file.h>
+#include <android-base/stringprintf.h>
+#include <android-base/strings.h>
+
+namespace blobs {
+
+bool BlobCache::load(const std::string& path) {
+    std::string buf;
+    if (!android::base::ReadFileToString(path, &buf)) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    entries_.clear();
+    for (const auto& line : android::base::Split(buf, "\n")) {
+        char sha1[41];
+        Entry entry;
+        int pathOffset = -1;
+        if (sscanf(line.c_str(), "%40s %" SCNu64 " %" SCNd64 " %" SCNu64 " %" SCNd64 " %n", sha1,
+                   &entry.st.size, &entry.st.mtimeNs, &entry.src.size, &entry.src.mtimeNs,
+                   &pathOffset) != 5 ||
+            pathOffset < 0 || static_cast<size_t>(pathOffset) >= line.size()) {
+            // A bad line only costs a copy or a hash, don't throw everything away.
+            continue;
+        }
+        entry.sha1 = strcmp(sha1, "-") == 0 ? "" : sha1;
+        entries_[line.substr(pathOffset)] = std::move(entry);
+    }
+    return true;
+}
+
+bool BlobCache::save(const std::string& path) const {
+    std::string buf;
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto& [file, entry] : entries_) {
+        buf += android::base::StringPrintf(
+                "%s %" PRIu64 " %" PRId64 " %" PRIu64 " %" PRId64 " %s\n",
+                entry.sha1.empty() ? "-" : entry.sha1.c_str(), entry.st.size, entry.st.mtimeNs,
+                entry.src.size, entry.src.mtimeNs, file.c_str());
+    }
+
+    // Renamed into place, an interrupted run leaves the old cache behind.
+    std::string tmpPath = path + ".tmp";
+    return android::base::WriteStringToFile(buf, tmpPath) &&
+           rename(tmpPath.c_str(), path.c_str()) == 0;
+}
+
+std::optional<std::string> BlobCache::sha1(const std::string& path, const FileStat& st) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = entries_.find(path);
+    if (it == entries_.end() || !(it->second.st == st) || it->second.sha1.empty()) {
+        return std::nullopt;
+    }
+    return it->second.sha1;
+}
+
+bool BlobCache::copiedFrom(const std::string& path, const FileStat& src) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = entries_.find(path);
+    return it != entries_.end() && it->second.src == src;
+}
+
+void BlobCache::copied(const std::string& path, const FileStat& st, const FileStat& src) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    entries_[path] = {st, "", src};
+}
+
+void BlobCache::hashed(const std::string& path, const FileStat& st, const std::string& sha1) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Entry& entry = entries_[path];
+    entry.st = st;
+    entry.sha1 = sha1;
+}
+
+void BlobCache::erase(const std::string& path) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    entries_.erase(path);
+}
+
+}  // namespace blobs
@@ -0,0 +1,70 @@
+/*
+ * Copyright (C) 2021 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+#include <stdint.h>
+
+#include <map>
+#include <mutex>
+#include <optional>
+#include <string>
+
+namespace blobs {
+
+struct FileStat {
+    uint64_t size;
+    int64_t mtimeNs;
+
+    bool operator==(const FileStat& other) const {
+        return size == other.size && mtimeNs == other.mtimeNs;
+    }
+};
+
+// Remembers, per file in the vendor tree, its hash and the dump file it was
+// copied from. Keyed on size and mtime, like make does, so an unchanged blob
+// is neither copied nor hashed again. Safe to use from several threads.
+//
+// Stored one file per line as "<sha1|-> <size> <mtime ns> <src size> <src mtime ns> <path>".
+class BlobCache {
+  public:
+    bool load(const std::string& path);
+    bool save(const std::string& path) const;
+
+    // The hash of path, if it is known for this exact version of the file.
+    std::optional<std::string> sha1(const std::string& path, const FileStat& st) const;
+
+    // Whether path was last copied from a source file with this size and mtime.
+    bool copiedFrom(const std::string& path, const FileStat& src) const;
+
+    // Records a fresh copy, its hash isn't known yet.
+    void copied(const std::string& path, const FileStat& st, const FileStat& src);
+    void hashed(const std::string& path, const FileStat& st, const std::string& sha1);
+    void erase(const std::string& path);
+
+  private:
+    struct Entry {
+        FileStat st;
+        std::string sha1;
+        FileStat src;
+    };
+
+    mutable std::mutex mutex_;
+    std::map<std::string, Entry> entries_;
+};
+
+}  // namespace blobs
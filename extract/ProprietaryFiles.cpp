@@ -0,0 +1,100 @@
+/*
+ * Copyright (C) 2021 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "ProprietaryFiles.h"
+
+#include <android-base/file.h>
+#include <android-base/strings.h>
+
+namespace blobs {
+
+namespace {
+
+std::string StripPin(const std::string& line) {
+    return line.substr(0, line.find('|'));
+}
+
+}  // anonymous namespace
+
+bool ParseBlob(const std::string& line, Blob* out) {
+    std::string spec = StripPin(line);
+    size_t pin = line.find('|');
+    out->sha1 = pin == std::string::npos ? "" : line.substr(pin + 1, line.find('|', pin + 1) - pin - 1);
+
+    if (!spec.empty() && spec[0] == '-') {
+        spec.erase(0, 1);
+    }
+    spec = spec.substr(0, spec.find(';'));
+
+    size_t colon = spec.find(':');
+    out->src = spec.substr(0, colon);
+    out->dst = colon == std::string::npos ? out->src : spec.substr(colon + 1);
+    return !out->src.empty() && !out->dst.empty();
+}
+
+bool ProprietaryFiles::load(const std::string& path) {
+    std::string buf;
+    if (!android::base::ReadFileToString(path, &buf)) {
+        return false;
+    }
+
+    lines_ = android::base::Split(buf, "\n");
+    if (!lines_.empty() && lines_.back().empty()) {
+        lines_.pop_back();
+    }
+
+    blobs_.clear();
+    bool pinnedSection = false;
+    for (size_t i = 0; i < lines_.size(); i++) {
+        const std::string& line = lines_[i];
+        if (line.empty()) {
+            continue;
+        }
+        if (line[0] == '#') {
+            pinnedSection = line.find(" - from") != std::string::npos;
+            continue;
+        }
+
+        Blob blob;
+        if (!ParseBlob(line, &blob)) {
+            return false;
+        }
+        blob.pinnedSection = pinnedSection;
+        blob.line = i;
+        blobs_.push_back(std::move(blob));
+    }
+    return true;
+}
+
+bool ProprietaryFiles::save(const std::string& path) const {
+    std::string buf;
+    for (const auto& line : lines_) {
+        buf += line + "\n";
+    }
+    return android::base::WriteStringToFile(buf, path);
+}
+
+void ProprietaryFiles::pin(const Blob& blob, const std::string& sha1) {
+    lines_[blob.line] = StripPin(lines_[blob.line]) + "|" + sha1;
+}
+
+void ProprietaryFiles::unpinAll() {
+    for (const auto& blob : blobs_) {
+        lines_[blob.line] = StripPin(lines_[blob.line]);
+    }
+}
+
+}  // namespace blobs
@@ -0,0 +1,62 @@
+/*
+ * Copyright (C) 2021 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+#include <stddef.h>
+
+#include <string>
+#include <vector>
+
+namespace blobs {
+
+// One entry of proprietary-files.txt:
+//
+//   [-]<src>[:<dst>][;<args>][|<sha1>]
+struct Blob {
+    // Path in the firmware dump.
+    std::string src;
+    // Path in the vendor tree.
+    std::string dst;
+    // Pinned hash, empty when the blob is taken from whatever dump is used.
+    std::string sha1;
+    // Listed below a "# ... - from ..." comment, update-sha1sums.py pins those.
+    bool pinnedSection;
+    size_t line;
+};
+
+// The list is kept line by line so rewriting the pins leaves everything else,
+// comments included, untouched.
+class ProprietaryFiles {
+  public:
+    bool load(const std::string& path);
+    bool save(const std::string& path) const;
+
+    const std::vector<Blob>& blobs() const { return blobs_; }
+
+    void pin(const Blob& blob, const std::string& sha1);
+    void unpinAll();
+
+  private:
+    std::vector<std::string> lines_;
+    std::vector<Blob> blobs_;
+};
+
+// Parses a single non-comment line, returns false if it names no file.
+bool ParseBlob(const std::string& line, Blob* out);
+
+}  // namespace blobs
@@ -0,0 +1,397 @@
+/*
+ * Copyright (C) 2021 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/fs.h>
+#include <openssl/sha.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <android-base/file.h>
+#include <android-base/unique_fd.h>
+
+#include "BlobCache.h"
+#include "ProprietaryFiles.h"
+
+using ::android::base::unique_fd;
+
+using ::blobs::Blob;
+using ::blobs::BlobCache;
+using ::blobs::FileStat;
+using ::blobs::ProprietaryFiles;
+
+namespace {
+
+// Lives in the output directory so it goes away with it.
+constexpr const char* kCacheName = ".blob-cache";
+
+constexpr size_t kChunkSize = 1024 * 1024;
+
+enum class Result {
+    KEPT,
+    COPIED,
+    MISSING,
+    MISMATCH,
+};
+
+bool Stat(const std::string& path, FileStat* out) {
+    struct stat st;
+    if (stat(path.c_str(), &st) < 0 || !S_ISREG(st.st_mode)) {
+        return false;
+    }
+    out->size = st.st_size;
+    out->mtimeNs = st.st_mtim.tv_sec * 1000000000LL + st.st_mtim.tv_nsec;
+    return true;
+}
+
+// Runs fn(0) ... fn(count - 1) on every core.
+void ParallelFor(size_t count, const std::function<void(size_t)>& fn) {
+    std::atomic<size_t> next(0);
+    std::vector<std::thread> threads;
+    for (unsigned i = 0; i < std::max(1U, std::thread::hardware_concurrency()); i++) {
+        threads.emplace_back([&] {
+            for (size_t n; (n = next++) < count;) {
+                fn(n);
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
+
+bool HashFile(const std::string& path, std::string* out) {
+    unique_fd fd(TEMP_FAILURE_RETRY(open(path.c_str(), O_RDONLY | O_CLOEXEC)));
+    if (fd < 0) {
+        return false;
+    }
+
+    SHA_CTX ctx;
+    SHA1_Init(&ctx);
+    std::unique_ptr<uint8_t[]> buf(new uint8_t[kChunkSize]);
+    ssize_t n;
+    while ((n = TEMP_FAILURE_RETRY(read(fd, buf.get(), kChunkSize))) > 0) {
+        SHA1_Update(&ctx, buf.get(), n);
+    }
+    if (n < 0) {
+        return false;
+    }
+
+    uint8_t digest[SHA_DIGEST_LENGTH];
+    SHA1_Final(digest, &ctx);
+    out->clear();
+    for (uint8_t b : digest) {
+        char hex[3];
+        snprintf(hex, sizeof(hex), "%02x", b);
+        *out += hex;
+    }
+    return true;
+}
+
+// Hashes the blob unless the cache already knows this version of it.
+bool CachedHash(BlobCache* cache, const std::string& outDir, const Blob& blob, const FileStat& st,
+                std::string* out) {
+    if (auto sha1 = cache->sha1(blob.dst, st)) {
+        *out = *sha1;
+        return true;
+    }
+    if (!HashFile(outDir + "/" + blob.dst, out)) {
+        return false;
+    }
+    cache->hashed(blob.dst, st, *out);
+    return true;
+}
+
+bool MakeParents(const std::string& path) {
+    for (size_t slash = path.find('/', 1); slash != std::string::npos;
+         slash = path.find('/', slash + 1)) {
+        if (mkdir(path.substr(0, slash).c_str(), 0755) < 0 && errno != EEXIST) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Same modes as extract_utils, which makes everything under a partition's
+// bin directory executable.
+mode_t ModeFor(const std::string& path) {
+    size_t slash = path.find('/');
+    if (slash == std::string::npos) {
+        return 0644;
+    }
+    bool bin = path.compare(0, 4, "bin/") == 0 || path.compare(slash, 5, "/bin/") == 0;
+    return bin ? 0755 : 0644;
+}
+
+// Shares the extents with a reflink where the filesystem can, and lets the
+// kernel do the copy otherwise.
+bool CopyFile(const std::string& from, const std::string& to, mode_t mode) {
+    std::string tmp = to + ".tmp";
+    unique_fd in(TEMP_FAILURE_RETRY(open(from.c_str(), O_RDONLY | O_CLOEXEC)));
+    unique_fd out(TEMP_FAILURE_RETRY(
+            open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, mode)));
+    // The umask and a leftover temporary file would both get in the way.
+    if (in < 0 || out < 0 || fchmod(out, mode) < 0) {
+        return false;
+    }
+
+    bool ok = ioctl(out, FICLONE, in.get()) == 0;
+    if (!ok) {
+        ssize_t n;
+        while ((n = copy_file_range(in, nullptr, out, nullptr, kChunkSize, 0)) > 0) {
+        }
+        ok = n == 0;
+
+        // Older kernels refuse to copy across filesystems.
+        if (!ok && (errno == EXDEV || errno == ENOSYS || errno == EINVAL) &&
+            lseek(in, 0, SEEK_SET) == 0 && ftruncate(out, 0) == 0 &&
+            lseek(out, 0, SEEK_SET) == 0) {
+            std::unique_ptr<uint8_t[]> buf(new uint8_t[kChunkSize]);
+            while ((n = TEMP_FAILURE_RETRY(read(in, buf.get(), kChunkSize))) > 0 &&
+                   android::base::WriteFully(out, buf.get(), n)) {
+            }
+            ok = n == 0;
+        }
+    }
+
+    if (!ok || rename(tmp.c_str(), to.c_str()) < 0) {
+        unlink(tmp.c_str());
+        return false;
+    }
+    return true;
+}
+
+// Removes files which are no longer listed, like extract_utils does by
+// cleaning the whole directory, but without losing the unchanged ones.
+size_t Prune(const std::string& dir, const std::string& rel, const std::set<std::string>& keep,
+             BlobCache* cache) {
+    std::unique_ptr<DIR, int (*)(DIR*)> d(opendir(dir.c_str()), closedir);
+    if (!d) {
+        return 0;
+    }
+
+    size_t pruned = 0;
+    while (struct dirent* de = readdir(d.get())) {
+        if (!strcmp(de->d_name, ".") || !strcmp(de->d_name, "..") ||
+            (rel.empty() && !strcmp(de->d_name, kCacheName))) {
+            continue;
+        }
+
+        std::string path = dir + "/" + de->d_name;
+        std::string name = rel.empty() ? de->d_name : rel + "/" + de->d_name;
+        struct stat st;
+        if (lstat(path.c_str(), &st) < 0) {
+            continue;
+        }
+        if (S_ISDIR(st.st_mode)) {
+            pruned += Prune(path, name, keep, cache);
+            rmdir(path.c_str());
+        } else if (!keep.count(name)) {
+            unlink(path.c_str());
+            cache->erase(name);
+            pruned++;
+        }
+    }
+    return pruned;
+}
+
+// Finds the blob in a dump of either the partitions or of a system-as-root
+// system image.
+bool FindSource(const std::string& srcDir, const Blob& blob, std::string* path, FileStat* st) {
+    for (const char* prefix : {"/", "/system/"}) {
+        *path = srcDir + prefix + blob.src;
+        if (Stat(*path, st)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+int Extract(const std::string& listPath, const std::string& srcDir, const std::string& outDir) {
+    ProprietaryFiles list;
+    if (!list.load(listPath)) {
+        fprintf(stderr, "Failed to parse %s\n", listPath.c_str());
+        return 1;
+    }
+
+    BlobCache cache;
+    std::string cachePath = outDir + "/" + kCacheName;
+    cache.load(cachePath);
+
+    const std::vector<Blob>& blobs = list.blobs();
+    std::vector<Result> results(blobs.size());
+    ParallelFor(blobs.size(), [&](size_t i) {
+        const Blob& blob = blobs[i];
+        std::string dst = outDir + "/" + blob.dst;
+        FileStat dstStat;
+        bool exists = Stat(dst, &dstStat);
+
+        // A pinned blob which is already in place is kept even if the dump
+        // has a different version, that's the point of pinning it.
+        std::string sha1;
+        if (!blob.sha1.empty() && exists &&
+            CachedHash(&cache, outDir, blob, dstStat, &sha1) && sha1 == blob.sha1) {
+            chmod(dst.c_str(), ModeFor(blob.dst));
+            results[i] = Result::KEPT;
+            return;
+        }
+
+        std::string src;
+        FileStat srcStat;
+        if (!FindSource(srcDir, blob, &src, &srcStat)) {
+            results[i] = Result::MISSING;
+            return;
+        }
+        if (blob.sha1.empty() && exists && cache.copiedFrom(blob.dst, srcStat)) {
+            // Trees from before the modes were set don't need a full copy.
+            chmod(dst.c_str(), ModeFor(blob.dst));
+            results[i] = Result::KEPT;
+            return;
+        }
+
+        if (!MakeParents(dst) || !CopyFile(src, dst, ModeFor(blob.dst)) || !Stat(dst, &dstStat)) {
+            fprintf(stderr, "Failed to copy %s: %s\n", src.c_str(), strerror(errno));
+            results[i] = Result::MISSING;
+            return;
+        }
+        cache.copied(blob.dst, dstStat, srcStat);
+
+        if (!blob.sha1.empty() && (!CachedHash(&cache, outDir, blob, dstStat, &sha1) ||
+                                   sha1 != blob.sha1)) {
+            results[i] = Result::MISMATCH;
+            return;
+        }
+        results[i] = Result::COPIED;
+    });
+
+    std::set<std::string> keep;
+    size_t counts[4] = {};
+    for (size_t i = 0; i < blobs.size(); i++) {
+        keep.insert(blobs[i].dst);
+        counts[static_cast<int>(results[i])]++;
+        switch (results[i]) {
+            case Result::COPIED:
+                // Printed for extract-files.sh, which only fixes up fresh copies.
+                printf("%s\n", blobs[i].dst.c_str());
+                break;
+            case Result::MISSING:
+                fprintf(stderr, "!! %s: not found in %s\n", blobs[i].src.c_str(), srcDir.c_str());
+                break;
+            case Result::MISMATCH:
+                fprintf(stderr, "!! %s: hash does not match the pinned %s\n",
+                        blobs[i].dst.c_str(), blobs[i].sha1.c_str());
+                break;
+            case Result::KEPT:
+                break;
+        }
+    }
+    size_t pruned = Prune(outDir, "", keep, &cache);
+
+    if (!cache.save(cachePath)) {
+        fprintf(stderr, "Failed to write %s\n", cachePath.c_str());
+    }
+
+    fprintf(stderr, "%zu copied, %zu unchanged, %zu pruned, %zu missing, %zu mismatched\n",
+            counts[static_cast<int>(Result::COPIED)], counts[static_cast<int>(Result::KEPT)],
+            pruned, counts[static_cast<int>(Result::MISSING)],
+            counts[static_cast<int>(Result::MISMATCH)]);
+    return counts[static_cast<int>(Result::MISSING)] || counts[static_cast<int>(Result::MISMATCH)]
+                   ? 1
+                   : 0;
+}
+
+// Same output as update-sha1sums.py.
+int UpdateSha1(const std::string& listPath, const std::string& outDir, bool cleanup) {
+    ProprietaryFiles list;
+    if (!list.load(listPath)) {
+        fprintf(stderr, "Failed to parse %s\n", listPath.c_str());
+        return 1;
+    }
+
+    if (cleanup) {
+        list.unpinAll();
+        return list.save(listPath) ? 0 : 1;
+    }
+
+    BlobCache cache;
+    std::string cachePath = outDir + "/" + kCacheName;
+    cache.load(cachePath);
+
+    const std::vector<Blob>& blobs = list.blobs();
+    std::vector<std::string> hashes(blobs.size());
+    ParallelFor(blobs.size(), [&](size_t i) {
+        if (!blobs[i].pinnedSection) {
+            return;
+        }
+        std::string dst = outDir + "/" + blobs[i].dst;
+        FileStat st;
+        if (!Stat(dst, &st) || !CachedHash(&cache, outDir, blobs[i], st, &hashes[i])) {
+            hashes[i].clear();
+        }
+    });
+
+    for (size_t i = 0; i < blobs.size(); i++) {
+        if (!blobs[i].pinnedSection) {
+            continue;
+        }
+        if (hashes[i].empty()) {
+            fprintf(stderr, "Failed to hash %s\n", blobs[i].dst.c_str());
+            return 1;
+        }
+        list.pin(blobs[i], hashes[i]);
+    }
+
+    cache.save(cachePath);
+    return list.save(listPath) ? 0 : 1;
+}
+
+void Usage(const char* argv0) {
+    fprintf(stderr,
+            "usage: %s extract <proprietary-files.txt> <dump> <proprietary dir>\n"
+            "       %s sha1 [-c] <proprietary-files.txt> <proprietary dir>\n",
+            argv0, argv0);
+}
+
+}  // anonymous namespace
+
+int main(int argc, char** argv) {
+    if (argc == 5 && strcmp(argv[1], "extract") == 0) {
+        return Extract(argv[2], argv[3], argv[4]);
+    }
+    if (argc == 4 && strcmp(argv[1], "sha1") == 0) {
+        return UpdateSha1(argv[2], argv[3], false);
+    }
+    if (argc == 5 && strcmp(argv[1], "sha1") == 0 && strcmp(argv[2], "-c") == 0) {
+        return UpdateSha1(argv[3], argv[4], true);
+    }
+
+    Usage(argv[0]);
+    return 1;
+}
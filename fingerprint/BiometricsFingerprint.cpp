@@ -24,10 +24,8 @@
 #include <hardware/hardware.h>
 #include <hardware/hw_auth_token.h>
 #include <inttypes.h>
-#include <poll.h>
 #include <unistd.h>
 
-#include <fstream>
 #include <thread>
 
 #define COMMAND_NIT 10
@@ -40,35 +38,6 @@
 
 #define FOD_UI_PATH "/sys/devices/platform/soc/soc:qcom,dsi-display-primary/fod_ui"
 
-namespace {
-
-template <typename T>
-static void set(const std::string& path, const T& value) {
-    std::ofstream file(path);
-    file << value;
-}
-
-static bool readBool(int fd) {
-    char c;
-    int rc;
-
-    rc = lseek(fd, 0, SEEK_SET);
-    if (rc) {
-        ALOGE("failed to seek fd, err: %d", rc);
-        return false;
-    }
-
-    rc = read(fd, &c, sizeof(char));
-    if (rc != 1) {
-        ALOGE("failed to read bool from fd, err: %d", rc);
-        return false;
-    }
-
-    return c != '0';
-}
-
-}  // anonymous namespace
-
 namespace android {
 namespace hardware {
 namespace biometrics {
@@ -90,36 +59,65 @@ BiometricsFingerprint::BiometricsFingerprint() : mClientCallback(nullptr), mDevi
         ALOGE("Can't open HAL module");
     }
 
+    mFodStatus.open(FOD_STATUS_PATH, O_WRONLY);
+
+    std::thread(&BiometricsFingerprint::fodNitLoop, this).detach();
+
     std::thread([this]() {
-        int fd = open(FOD_UI_PATH, O_RDONLY);
-        if (fd < 0) {
-            ALOGE("failed to open fd, err: %d", fd);
+        sysfs::Node fodUi(FOD_UI_PATH, O_RDONLY);
+        if (!fodUi.valid()) {
             return;
         }
 
-        struct pollfd fodUiPoll = {
-                .fd = fd,
-                .events = POLLERR | POLLPRI,
-                .revents = 0,
-        };
-
         while (true) {
-            int rc = poll(&fodUiPoll, 1, -1);
-            if (rc < 0) {
-                ALOGE("failed to poll fd, err: %d", rc);
+            if (!fodUi.waitForChange()) {
                 continue;
             }
 
-            bool fingerDown = readBool(fd);
+            bool fingerDown = false;
+            if (!fodUi.read(&fingerDown)) {
+                continue;
+            }
             ALOGI("fod_ui status: %d", fingerDown);
-            mDevice->extCmd(mDevice, COMMAND_NIT, fingerDown ? PARAM_NIT_FOD : PARAM_NIT_NONE);
+            // Usually onFingerDown() got there first and this is a no-op.
+            setFodNit(fingerDown);
             if (!fingerDown) {
-                set(FOD_STATUS_PATH, FOD_STATUS_OFF);
+                mFodStatus.write(FOD_STATUS_OFF);
             }
         }
     }).detach();
 }
 
+void BiometricsFingerprint::setFodNit(bool enabled) {
+    {
+        std::lock_guard<std::mutex> lock(mFodMutex);
+        if (mFodNitTarget == enabled) {
+            return;
+        }
+        mFodNitTarget = enabled;
+    }
+    mFodNitCv.notify_one();
+}
+
+// Runs the panel luminance switches, so that they overlap with the touch
+// controller handling fod_status instead of waiting for fod_ui to report back.
+void BiometricsFingerprint::fodNitLoop() {
+    bool current = false;
+
+    std::unique_lock<std::mutex> lock(mFodMutex);
+    while (true) {
+        mFodNitCv.wait(lock, [&] { return mFodNitTarget != current; });
+        current = mFodNitTarget;
+        lock.unlock();
+
+        // The matcher is calibrated under the FOD luminance mode, so it is
+        // entered on every finger down, however bright the panel already is.
+        mDevice->extCmd(mDevice, COMMAND_NIT, current ? PARAM_NIT_FOD : PARAM_NIT_NONE);
+
+        lock.lock();
+    }
+}
+
 BiometricsFingerprint::~BiometricsFingerprint() {
     ALOGV("~BiometricsFingerprint()");
     if (mDevice == nullptr) {
@@ -375,10 +373,17 @@ fingerprint_device_t* BiometricsFingerprint::openHal() {
 }
 
 void BiometricsFingerprint::notify(const fingerprint_msg_t* msg) {
-    BiometricsFingerprint* thisPtr =
-        static_cast<BiometricsFingerprint*>(BiometricsFingerprint::getInstance());
-    std::lock_guard<std::mutex> lock(thisPtr->mClientCallbackMutex);
-    if (thisPtr == nullptr || thisPtr->mClientCallback == nullptr) {
+    // The vendor library only calls back once the device has been opened,
+    // which happens in the constructor.
+    BiometricsFingerprint* thisPtr = sInstance;
+    // Copying the reference out neither allocates nor holds the lock across
+    // the binder call.
+    sp<IBiometricsFingerprintClientCallback> callback;
+    {
+        std::lock_guard<std::mutex> lock(thisPtr->mClientCallbackMutex);
+        callback = thisPtr->mClientCallback;
+    }
+    if (callback == nullptr) {
         ALOGE("Receiving callbacks before the client callback is registered.");
         return;
     }
@@ -388,7 +393,7 @@ void BiometricsFingerprint::notify(const fingerprint_msg_t* msg) {
             int32_t vendorCode = 0;
             FingerprintError result = VendorErrorFilter(msg->data.error, &vendorCode);
             ALOGD("onError(%d)", result);
-            if (!thisPtr->mClientCallback->onError(devId, result, vendorCode).isOk()) {
+            if (!callback->onError(devId, result, vendorCode).isOk()) {
                 ALOGE("failed to invoke fingerprint onError callback");
             }
         } break;
@@ -397,14 +402,14 @@ void BiometricsFingerprint::notify(const fingerprint_msg_t* msg) {
             FingerprintAcquiredInfo result =
                 VendorAcquiredFilter(msg->data.acquired.acquired_info, &vendorCode);
             ALOGD("onAcquired(%d)", result);
-            if (!thisPtr->mClientCallback->onAcquired(devId, result, vendorCode).isOk()) {
+            if (!callback->onAcquired(devId, result, vendorCode).isOk()) {
                 ALOGE("failed to invoke fingerprint onAcquired callback");
             }
         } break;
         case FINGERPRINT_TEMPLATE_ENROLLING:
             ALOGD("onEnrollResult(fid=%d, gid=%d, rem=%d)", msg->data.enroll.finger.fid,
                   msg->data.enroll.finger.gid, msg->data.enroll.samples_remaining);
-            if (!thisPtr->mClientCallback
+            if (!callback
                      ->onEnrollResult(devId, msg->data.enroll.finger.fid,
                                       msg->data.enroll.finger.gid,
                                       msg->data.enroll.samples_remaining)
@@ -415,7 +420,7 @@ void BiometricsFingerprint::notify(const fingerprint_msg_t* msg) {
         case FINGERPRINT_TEMPLATE_REMOVED:
             ALOGD("onRemove(fid=%d, gid=%d, rem=%d)", msg->data.removed.finger.fid,
                   msg->data.removed.finger.gid, msg->data.removed.remaining_templates);
-            if (!thisPtr->mClientCallback
+            if (!callback
                      ->onRemoved(devId, msg->data.removed.finger.fid, msg->data.removed.finger.gid,
                                  msg->data.removed.remaining_templates)
                      .isOk()) {
@@ -426,10 +431,14 @@ void BiometricsFingerprint::notify(const fingerprint_msg_t* msg) {
             if (msg->data.authenticated.finger.fid != 0) {
                 ALOGD("onAuthenticated(fid=%d, gid=%d)", msg->data.authenticated.finger.fid,
                       msg->data.authenticated.finger.gid);
-                const uint8_t* hat = reinterpret_cast<const uint8_t*>(&msg->data.authenticated.hat);
-                const hidl_vec<uint8_t> token(
-                    std::vector<uint8_t>(hat, hat + sizeof(msg->data.authenticated.hat)));
-                if (!thisPtr->mClientCallback
+                // The token is flattened into the parcel before the call
+                // returns, so it can point straight at msg.
+                hidl_vec<uint8_t> token;
+                token.setToExternal(
+                    reinterpret_cast<uint8_t*>(
+                        const_cast<hw_auth_token_t*>(&msg->data.authenticated.hat)),
+                    sizeof(msg->data.authenticated.hat));
+                if (!callback
                          ->onAuthenticated(devId, msg->data.authenticated.finger.fid,
                                            msg->data.authenticated.finger.gid, token)
                          .isOk()) {
@@ -437,7 +446,7 @@ void BiometricsFingerprint::notify(const fingerprint_msg_t* msg) {
                 }
             } else {
                 // Not a recognized fingerprint
-                if (!thisPtr->mClientCallback
+                if (!callback
                          ->onAuthenticated(devId, msg->data.authenticated.finger.fid,
                                            msg->data.authenticated.finger.gid, hidl_vec<uint8_t>())
                          .isOk()) {
@@ -448,7 +457,7 @@ void BiometricsFingerprint::notify(const fingerprint_msg_t* msg) {
         case FINGERPRINT_TEMPLATE_ENUMERATING:
             ALOGD("onEnumerate(fid=%d, gid=%d, rem=%d)", msg->data.enumerated.finger.fid,
                   msg->data.enumerated.finger.gid, msg->data.enumerated.remaining_templates);
-            if (!thisPtr->mClientCallback
+            if (!callback
                      ->onEnumerate(devId, msg->data.enumerated.finger.fid,
                                    msg->data.enumerated.finger.gid,
                                    msg->data.enumerated.remaining_templates)
@@ -469,11 +478,14 @@ Return<bool> BiometricsFingerprint::isUdfps(uint32_t /* sensorId */) {
 
 Return<void> BiometricsFingerprint::onFingerDown(uint32_t /* x */, uint32_t /* y */,
                                                 float /* minor */, float /* major */) {
-    set(FOD_STATUS_PATH, FOD_STATUS_ON);
+    setFodNit(true);
+    mFodStatus.write(FOD_STATUS_ON);
     return Void();
 }
 
 Return<void> BiometricsFingerprint::onFingerUp() {
+    // Drops a switch that has not run yet, or undoes the one that did.
+    setFodNit(false);
     return Void();
 }
 
@@ -24,8 +24,12 @@
 #include <hidl/MQDescriptor.h>
 #include <hidl/Status.h>
 #include <log/log.h>
+#include <sysfs/Node.h>
 #include <vendor/xiaomi/hardware/fingerprintextension/1.0/IXiaomiFingerprint.h>
 
+#include <condition_variable>
+#include <mutex>
+
 #include "fingerprint.h"
 
 namespace android {
@@ -84,6 +88,14 @@ struct BiometricsFingerprint : public IBiometricsFingerprint, public IXiaomiFing
     std::mutex mClientCallbackMutex;
     sp<IBiometricsFingerprintClientCallback> mClientCallback;
     fingerprint_device_t* mDevice;
+    sysfs::Node mFodStatus;
+
+    void setFodNit(bool enabled);
+    void fodNitLoop();
+
+    std::mutex mFodMutex;
+    std::condition_variable mFodNitCv;
+    bool mFodNitTarget = false;
 
     // Methods from ::android::hardware::biometrics::fingerprint::V2_3::IBiometricsFingerprint follow.
     Return<bool> isUdfps(uint32_t sensorId) override;
@@ -18,14 +18,17 @@
 #include <drm/sde_drm.h>
 #include <stdint.h>
 
-uint32_t getUdfpsZOrder(uint32_t z, bool touched) {
-    if (touched) {
-        z |= FOD_PRESSED_LAYER_ZORDER;
-    }
+// SurfaceFlinger calls these for every layer on every frame, keep them
+// free of branches and state.
 
-    return z;
+// The SDE driver picks the plane carrying this bit as the FOD layer and
+// switches the panel for it, the pipe is SDM's choice.
+uint32_t getUdfpsZOrder(uint32_t z, bool touched) {
+    return z | (touched ? FOD_PRESSED_LAYER_ZORDER : 0);
 }
 
+// SurfaceFlinger already allocates every layer with GRALLOC_USAGE_HW_COMPOSER
+// and the QTI gralloc has no usage bit that reserves an overlay pipe.
 uint64_t getUdfpsUsageBits(uint64_t usageBits, bool) {
     return usageBits;
 }
@@ -0,0 +1,105 @@
+/*
+ * Copyright (C) 2021 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "FakeFingerprintModule.h"
+
+#include <errno.h>
+#include <string.h>
+
+#include <chrono>
+
+namespace android {
+namespace hardware {
+namespace biometrics {
+namespace fingerprint {
+namespace testing {
+
+FakeFingerprintModule& FakeFingerprintModule::get() {
+    static FakeFingerprintModule sModule;
+    return sModule;
+}
+
+FakeFingerprintModule::FakeFingerprintModule() {
+    memset(&module, 0, sizeof(module));
+    memset(&device, 0, sizeof(device));
+
+    methods_.open = open;
+    module.common.tag = HARDWARE_MODULE_TAG;
+    module.common.module_api_version = FINGERPRINT_MODULE_API_VERSION_2_1;
+    module.common.id = FINGERPRINT_HARDWARE_MODULE_ID;
+    module.common.methods = &methods_;
+
+    device.common.tag = HARDWARE_DEVICE_TAG;
+    device.common.version = FINGERPRINT_MODULE_API_VERSION_2_1;
+    device.common.module = &module.common;
+    device.common.close = [](hw_device_t*) { return 0; };
+    device.set_notify = setNotify;
+    device.extCmd = extCmd;
+}
+
+int FakeFingerprintModule::open(const hw_module_t*, const char*, hw_device_t** device) {
+    *device = &get().device.common;
+    return 0;
+}
+
+int FakeFingerprintModule::setNotify(fingerprint_device_t*, fingerprint_notify_t notify) {
+    get().notify_ = notify;
+    return 0;
+}
+
+int FakeFingerprintModule::extCmd(fingerprint_device_t*, int32_t cmd, int32_t param) {
+    FakeFingerprintModule& self = get();
+    {
+        std::lock_guard<std::mutex> lock(self.lock_);
+        self.ext_cmds_.emplace_back(cmd, param);
+    }
+    self.cv_.notify_all();
+    return 0;
+}
+
+std::vector<std::pair<int32_t, int32_t>> FakeFingerprintModule::waitForExtCmds(size_t count) {
+    std::unique_lock<std::mutex> lock(lock_);
+    cv_.wait_for(lock, std::chrono::seconds(1), [&] { return ext_cmds_.size() >= count; });
+    return ext_cmds_;
+}
+
+std::vector<std::pair<int32_t, int32_t>> FakeFingerprintModule::extCmds() {
+    std::lock_guard<std::mutex> lock(lock_);
+    return ext_cmds_;
+}
+
+void FakeFingerprintModule::reset() {
+    std::lock_guard<std::mutex> lock(lock_);
+    ext_cmds_.clear();
+}
+
+}  // namespace testing
+}  // namespace fingerprint
+}  // namespace biometrics
+}  // namespace hardware
+}  // namespace android
+
+using android::hardware::biometrics::fingerprint::testing::FakeFingerprintModule;
+
+extern "C" int hw_get_module_by_class(const char* class_id, const char* inst,
+                                      const hw_module_t** module) {
+    if (strcmp(class_id, FINGERPRINT_HARDWARE_MODULE_ID) != 0 || inst == nullptr ||
+        strcmp(inst, "goodix_fod") != 0) {
+        return -ENOENT;
+    }
+    *module = &FakeFingerprintModule::get().module.common;
+    return 0;
+}
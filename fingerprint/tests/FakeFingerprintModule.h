@@ -0,0 +1,68 @@
+/*
+ * Copyright (C) 2021 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "../fingerprint.h"
+
+namespace android {
+namespace hardware {
+namespace biometrics {
+namespace fingerprint {
+namespace testing {
+
+// Stands in for the goodix_fod vendor module, which hw_get_module_by_class()
+// returns while this is linked in.
+class FakeFingerprintModule {
+  public:
+    static FakeFingerprintModule& get();
+
+    // Delivers a message from the "vendor library" to the HAL.
+    void send(const fingerprint_msg_t& msg) const { notify_(&msg); }
+
+    // Blocks until count extCmd calls were made, returns all of them.
+    std::vector<std::pair<int32_t, int32_t>> waitForExtCmds(size_t count);
+    std::vector<std::pair<int32_t, int32_t>> extCmds();
+    void reset();
+
+    fingerprint_module_t module;
+    fingerprint_device_t device;
+
+  private:
+    FakeFingerprintModule();
+
+    static int open(const hw_module_t* module, const char* id, hw_device_t** device);
+    static int setNotify(fingerprint_device_t* dev, fingerprint_notify_t notify);
+    static int extCmd(fingerprint_device_t* dev, int32_t cmd, int32_t param);
+
+    fingerprint_notify_t notify_ = nullptr;
+    hw_module_methods_t methods_;
+
+    std::mutex lock_;
+    std::condition_variable cv_;
+    std::vector<std::pair<int32_t, int32_t>> ext_cmds_;
+};
+
+}  // namespace testing
+}  // namespace fingerprint
+}  // namespace biometrics
+}  // namespace hardware
+}  // namespace android
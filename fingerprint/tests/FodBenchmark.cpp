@@ -0,0 +1,101 @@
+/*
+ * Copyright (C) 2021 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Replays taps on the FOD spot and measures how long the panel takes to be
+// asked for the FOD luminance after onFingerDown, against the fake vendor
+// module. The time the vendor library spends in extCmd is left out.
+
+#include <chrono>
+
+#include <benchmark/benchmark.h>
+#include <sysfs/testing/FakeSysfs.h>
+
+#include "../BiometricsFingerprint.h"
+#include "FakeFingerprintModule.h"
+
+namespace android {
+namespace hardware {
+namespace biometrics {
+namespace fingerprint {
+namespace V2_3 {
+namespace implementation {
+namespace {
+
+using sysfs::testing::FakeSysfs;
+using testing::FakeFingerprintModule;
+
+constexpr const char* kFodStatusPath = "/sys/devices/virtual/touch/tp_dev/fod_status";
+constexpr const char* kFodUiPath = "/sys/devices/platform/soc/soc:qcom,dsi-display-primary/fod_ui";
+
+// The service runs detached threads for its whole lifetime, so a single
+// instance is shared by all benchmarks.
+BiometricsFingerprint* Hal() {
+    static BiometricsFingerprint* hal = [] {
+        FakeSysfs* fake = new FakeSysfs();
+        fake->add(kFodStatusPath, "0\n");
+        fake->add(kFodUiPath, "0\n");
+        return new BiometricsFingerprint();
+    }();
+    return hal;
+}
+
+void BM_FingerDownToFodNit(benchmark::State& state) {
+    BiometricsFingerprint* hal = Hal();
+    FakeFingerprintModule& module = FakeFingerprintModule::get();
+    module.reset();
+
+    size_t cmds = 0;
+    for (auto _ : state) {
+        auto start = std::chrono::steady_clock::now();
+        hal->onFingerDown(0, 0, 0, 0);
+        module.waitForExtCmds(++cmds);
+        auto end = std::chrono::steady_clock::now();
+        state.SetIterationTime(std::chrono::duration<double>(end - start).count());
+
+        hal->onFingerUp();
+        module.waitForExtCmds(++cmds);
+    }
+}
+BENCHMARK(BM_FingerDownToFodNit)->UseManualTime();
+
+// What the framework thread itself spends in onFingerDown.
+void BM_OnFingerDown(benchmark::State& state) {
+    BiometricsFingerprint* hal = Hal();
+    FakeFingerprintModule& module = FakeFingerprintModule::get();
+    module.reset();
+
+    size_t cmds = 0;
+    for (auto _ : state) {
+        hal->onFingerDown(0, 0, 0, 0);
+
+        state.PauseTiming();
+        module.waitForExtCmds(++cmds);
+        hal->onFingerUp();
+        module.waitForExtCmds(++cmds);
+        state.ResumeTiming();
+    }
+}
+BENCHMARK(BM_OnFingerDown);
+
+}  // namespace
+}  // namespace implementation
+}  // namespace V2_3
+}  // namespace fingerprint
+}  // namespace biometrics
+}  // namespace hardware
+}  // namespace android
+
+BENCHMARK_MAIN();
@@ -0,0 +1,112 @@
+/*
+ * Copyright (C) 2021 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <chrono>
+#include <thread>
+
+#include <gtest/gtest.h>
+#include <sysfs/testing/FakeSysfs.h>
+
+#include "FakeFingerprintModule.h"
+#include "HalEnvironment.h"
+
+namespace android {
+namespace hardware {
+namespace biometrics {
+namespace fingerprint {
+namespace V2_3 {
+namespace implementation {
+namespace {
+
+using sysfs::testing::FakeSysfs;
+using testing::FakeFingerprintModule;
+using ExtCmds = std::vector<std::pair<int32_t, int32_t>>;
+using Writes = std::vector<std::string>;
+
+constexpr std::pair<int32_t, int32_t> kFodNitOn = {10, 1};
+constexpr std::pair<int32_t, int32_t> kFodNitOff = {10, 0};
+
+class FodTest : public ::testing::Test {
+  protected:
+    void SetUp() override {
+        fake_->resetCounts();
+        module_.reset();
+    }
+
+    void TearDown() override {
+        // Leave the panel out of the FOD mode for the next test.
+        hal_->onFingerUp();
+        WaitFor([this] { return module_.extCmds().size() % 2 == 0; });
+    }
+
+    FakeSysfs* fake_ = HalEnvironment::fake;
+    BiometricsFingerprint* hal_ = HalEnvironment::hal;
+    FakeFingerprintModule& module_ = FakeFingerprintModule::get();
+};
+
+TEST_F(FodTest, FingerDownLightsTheSpot) {
+    hal_->onFingerDown(0, 0, 0, 0);
+    EXPECT_EQ(module_.waitForExtCmds(1), ExtCmds{kFodNitOn});
+    EXPECT_EQ(fake_->writes(kFodStatusPath), Writes{"1"});
+
+    hal_->onFingerUp();
+    EXPECT_EQ(module_.waitForExtCmds(2), (ExtCmds{kFodNitOn, kFodNitOff}));
+}
+
+TEST_F(FodTest, FingerDownIsOneWrite) {
+    hal_->onFingerDown(0, 0, 0, 0);
+    module_.waitForExtCmds(1);
+    // The service never reopens the node, nor reads it back.
+    EXPECT_EQ(fake_->counts(kFodStatusPath), (sysfs::testing::IoCounts{.writes = 1}));
+}
+
+TEST_F(FodTest, FodUiReleasesTheTouchController) {
+    // The panel reports the spot before the framework calls onFingerDown.
+    fake_->set(kFodUiPath, "1\n");
+    fake_->notify(kFodUiPath);
+    EXPECT_EQ(module_.waitForExtCmds(1), ExtCmds{kFodNitOn});
+    hal_->onFingerDown(0, 0, 0, 0);
+
+    fake_->set(kFodUiPath, "0\n");
+    fake_->notify(kFodUiPath);
+    EXPECT_EQ(module_.waitForExtCmds(2), (ExtCmds{kFodNitOn, kFodNitOff}));
+    ASSERT_TRUE(WaitFor([this] { return fake_->writes(kFodStatusPath).size() == 2; }));
+    EXPECT_EQ(fake_->writes(kFodStatusPath), (Writes{"1", "-1"}));
+}
+
+TEST_F(FodTest, QuickTapsCollapse) {
+    for (int i = 0; i < 100; i++) {
+        hal_->onFingerDown(0, 0, 0, 0);
+        hal_->onFingerUp();
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    // Every switch on is undone, and none is left behind.
+    ExtCmds cmds = module_.extCmds();
+    ASSERT_EQ(cmds.size() % 2, 0u);
+    for (size_t i = 0; i < cmds.size(); i += 2) {
+        EXPECT_EQ(cmds[i], kFodNitOn);
+        EXPECT_EQ(cmds[i + 1], kFodNitOff);
+    }
+    EXPECT_EQ(fake_->counts(kFodStatusPath).writes, 100u);
+}
+
+}  // namespace
+}  // namespace implementation
+}  // namespace V2_3
+}  // namespace fingerprint
+}  // namespace biometrics
+}  // namespace hardware
+}  // namespace android
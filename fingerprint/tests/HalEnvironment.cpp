@@ -0,0 +1,72 @@
+/*
+ * Copyright (C) 2021 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "HalEnvironment.h"
+
+#include <chrono>
+#include <thread>
+
+
+#include "FakeFingerprintModule.h"
+
+namespace android {
+namespace hardware {
+namespace biometrics {
+namespace fingerprint {
+namespace V2_3 {
+namespace implementation {
+
+using sysfs::testing::FakeSysfs;
+using testing::FakeFingerprintModule;
+
+bool WaitFor(const std::function<bool()>& condition) {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+    while (!condition()) {
+        if (std::chrono::steady_clock::now() > deadline) {
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return true;
+}
+
+FakeSysfs* HalEnvironment::fake;
+BiometricsFingerprint* HalEnvironment::hal;
+
+void HalEnvironment::SetUp() {
+    fake = new FakeSysfs();
+    fake->add(kFodStatusPath, "0\n");
+    fake->add(kFodUiPath, "0\n");
+
+    hal = new BiometricsFingerprint();
+    ASSERT_EQ(hal->mDevice, &FakeFingerprintModule::get().device);
+    // Wait for the fod_ui thread to start listening.
+    ASSERT_TRUE(WaitFor([] { return fake->counts(kFodUiPath).polls > 0; }));
+}
+
+}  // namespace implementation
+}  // namespace V2_3
+}  // namespace fingerprint
+}  // namespace biometrics
+}  // namespace hardware
+}  // namespace android
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    ::testing::AddGlobalTestEnvironment(
+            new android::hardware::biometrics::fingerprint::V2_3::implementation::HalEnvironment());
+    return RUN_ALL_TESTS();
+}
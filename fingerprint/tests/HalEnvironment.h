@@ -0,0 +1,54 @@
+/*
+ * Copyright (C) 2021 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <functional>
+
+#include <gtest/gtest.h>
+#include <sysfs/testing/FakeSysfs.h>
+
+#include "../BiometricsFingerprint.h"
+
+namespace android {
+namespace hardware {
+namespace biometrics {
+namespace fingerprint {
+namespace V2_3 {
+namespace implementation {
+
+constexpr const char* kFodStatusPath = "/sys/devices/virtual/touch/tp_dev/fod_status";
+constexpr const char* kFodUiPath = "/sys/devices/platform/soc/soc:qcom,dsi-display-primary/fod_ui";
+
+// Polls for up to a second.
+bool WaitFor(const std::function<bool()>& condition);
+
+// The service runs detached threads for its whole lifetime, so a single
+// instance is shared by all tests.
+class HalEnvironment : public ::testing::Environment {
+  public:
+    void SetUp() override;
+
+    static sysfs::testing::FakeSysfs* fake;
+    static BiometricsFingerprint* hal;
+};
+
+}  // namespace implementation
+}  // namespace V2_3
+}  // namespace fingerprint
+}  // namespace biometrics
+}  // namespace hardware
+}  // namespace android
@@ -0,0 +1,236 @@
+/*
+ * Copyright (C) 2021 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Delivers every message type the vendor library sends and checks that
+// notify() hands it to the client without allocating. Only allocations on
+// the notifying thread are counted.
+
+#include <stdlib.h>
+
+#include <new>
+
+#include <gtest/gtest.h>
+
+#include "FakeFingerprintModule.h"
+#include "HalEnvironment.h"
+
+namespace {
+
+thread_local bool sCounting = false;
+thread_local size_t sAllocations = 0;
+
+void* CountedAlloc(size_t size) noexcept {
+    if (sCounting) {
+        sAllocations++;
+    }
+    return malloc(size ? size : 1);
+}
+
+void* CheckedAlloc(size_t size) {
+    void* p = CountedAlloc(size);
+    if (p == nullptr) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+}  // anonymous namespace
+
+void* operator new(size_t size) {
+    return CheckedAlloc(size);
+}
+void* operator new[](size_t size) {
+    return CheckedAlloc(size);
+}
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+    return CountedAlloc(size);
+}
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+    return CountedAlloc(size);
+}
+void operator delete(void* p) noexcept {
+    free(p);
+}
+void operator delete[](void* p) noexcept {
+    free(p);
+}
+void operator delete(void* p, size_t) noexcept {
+    free(p);
+}
+void operator delete[](void* p, size_t) noexcept {
+    free(p);
+}
+
+namespace android {
+namespace hardware {
+namespace biometrics {
+namespace fingerprint {
+namespace V2_3 {
+namespace implementation {
+namespace {
+
+using testing::FakeFingerprintModule;
+
+// Records the last call without allocating.
+class FakeClientCallback : public IBiometricsFingerprintClientCallback {
+  public:
+    Return<void> onEnrollResult(uint64_t, uint32_t fid, uint32_t, uint32_t remaining) override {
+        record("enroll", fid, remaining);
+        return Void();
+    }
+    Return<void> onAcquired(uint64_t, FingerprintAcquiredInfo info, int32_t vendor) override {
+        record("acquired", static_cast<uint32_t>(info), vendor);
+        return Void();
+    }
+    Return<void> onAuthenticated(uint64_t, uint32_t fid, uint32_t,
+                                 const hidl_vec<uint8_t>& token) override {
+        record("authenticated", fid, token.size());
+        token_ = token.data();
+        return Void();
+    }
+    Return<void> onError(uint64_t, FingerprintError error, int32_t vendor) override {
+        record("error", static_cast<uint32_t>(error), vendor);
+        return Void();
+    }
+    Return<void> onRemoved(uint64_t, uint32_t fid, uint32_t, uint32_t remaining) override {
+        record("removed", fid, remaining);
+        return Void();
+    }
+    Return<void> onEnumerate(uint64_t, uint32_t fid, uint32_t, uint32_t remaining) override {
+        record("enumerate", fid, remaining);
+        return Void();
+    }
+
+    const char* last_ = nullptr;
+    uint32_t arg1_ = 0;
+    int64_t arg2_ = 0;
+    const uint8_t* token_ = nullptr;
+
+  private:
+    void record(const char* name, uint32_t arg1, int64_t arg2) {
+        last_ = name;
+        arg1_ = arg1;
+        arg2_ = arg2;
+    }
+};
+
+class NotifyTest : public ::testing::Test {
+  protected:
+    void SetUp() override {
+        callback_ = new FakeClientCallback();
+        hal_->setNotify(callback_);
+    }
+
+    void TearDown() override { hal_->setNotify(nullptr); }
+
+    // Returns the number of allocations notify() made.
+    size_t send(const fingerprint_msg_t& msg) {
+        sAllocations = 0;
+        sCounting = true;
+        module_.send(msg);
+        sCounting = false;
+        return sAllocations;
+    }
+
+    BiometricsFingerprint* hal_ = HalEnvironment::hal;
+    FakeFingerprintModule& module_ = FakeFingerprintModule::get();
+    sp<FakeClientCallback> callback_;
+};
+
+TEST_F(NotifyTest, ErrorDoesNotAllocate) {
+    fingerprint_msg_t msg = {};
+    msg.type = FINGERPRINT_ERROR;
+    msg.data.error = static_cast<fingerprint_error_t>(FINGERPRINT_ERROR_VENDOR_BASE + 3);
+    EXPECT_EQ(send(msg), 0u);
+    EXPECT_STREQ(callback_->last_, "error");
+    EXPECT_EQ(callback_->arg1_, static_cast<uint32_t>(FingerprintError::ERROR_VENDOR));
+    EXPECT_EQ(callback_->arg2_, 3);
+}
+
+TEST_F(NotifyTest, AcquiredDoesNotAllocate) {
+    fingerprint_msg_t msg = {};
+    msg.type = FINGERPRINT_ACQUIRED;
+    msg.data.acquired.acquired_info = FINGERPRINT_ACQUIRED_PARTIAL;
+    EXPECT_EQ(send(msg), 0u);
+    EXPECT_STREQ(callback_->last_, "acquired");
+    EXPECT_EQ(callback_->arg1_, static_cast<uint32_t>(FingerprintAcquiredInfo::ACQUIRED_PARTIAL));
+}
+
+TEST_F(NotifyTest, EnrollDoesNotAllocate) {
+    fingerprint_msg_t msg = {};
+    msg.type = FINGERPRINT_TEMPLATE_ENROLLING;
+    msg.data.enroll.finger = {.gid = 0, .fid = 7};
+    msg.data.enroll.samples_remaining = 12;
+    EXPECT_EQ(send(msg), 0u);
+    EXPECT_STREQ(callback_->last_, "enroll");
+    EXPECT_EQ(callback_->arg1_, 7u);
+    EXPECT_EQ(callback_->arg2_, 12);
+}
+
+TEST_F(NotifyTest, RemovedDoesNotAllocate) {
+    fingerprint_msg_t msg = {};
+    msg.type = FINGERPRINT_TEMPLATE_REMOVED;
+    msg.data.removed.finger = {.gid = 0, .fid = 7};
+    msg.data.removed.remaining_templates = 2;
+    EXPECT_EQ(send(msg), 0u);
+    EXPECT_STREQ(callback_->last_, "removed");
+    EXPECT_EQ(callback_->arg2_, 2);
+}
+
+TEST_F(NotifyTest, EnumerateDoesNotAllocate) {
+    fingerprint_msg_t msg = {};
+    msg.type = FINGERPRINT_TEMPLATE_ENUMERATING;
+    msg.data.enumerated.finger = {.gid = 0, .fid = 9};
+    msg.data.enumerated.remaining_templates = 1;
+    EXPECT_EQ(send(msg), 0u);
+    EXPECT_STREQ(callback_->last_, "enumerate");
+    EXPECT_EQ(callback_->arg1_, 9u);
+}
+
+// The token is handed over in place, not copied.
+TEST_F(NotifyTest, AuthenticatedDoesNotAllocate) {
+    fingerprint_msg_t msg = {};
+    msg.type = FINGERPRINT_AUTHENTICATED;
+    msg.data.authenticated.finger = {.gid = 0, .fid = 7};
+    EXPECT_EQ(send(msg), 0u);
+    EXPECT_STREQ(callback_->last_, "authenticated");
+    EXPECT_EQ(callback_->arg2_, static_cast<int64_t>(sizeof(hw_auth_token_t)));
+    EXPECT_EQ(callback_->token_, reinterpret_cast<const uint8_t*>(&msg.data.authenticated.hat));
+}
+
+TEST_F(NotifyTest, RejectedDoesNotAllocate) {
+    fingerprint_msg_t msg = {};
+    msg.type = FINGERPRINT_AUTHENTICATED;
+    EXPECT_EQ(send(msg), 0u);
+    EXPECT_STREQ(callback_->last_, "authenticated");
+    EXPECT_EQ(callback_->arg2_, 0);
+}
+
+TEST_F(NotifyTest, NoClientIsDropped) {
+    hal_->setNotify(nullptr);
+    fingerprint_msg_t msg = {};
+    msg.type = FINGERPRINT_ACQUIRED;
+    EXPECT_EQ(send(msg), 0u);
+    EXPECT_EQ(callback_->last_, nullptr);
+}
+
+}  // namespace
+}  // namespace implementation
+}  // namespace V2_3
+}  // namespace fingerprint
+}  // namespace biometrics
+}  // namespace hardware
+}  // namespace android
@@ -0,0 +1,43 @@
+/*
+ * Copyright (C) 2021 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// SurfaceFlinger asks for the z-order and usage of every layer on every
+// frame, this times a frame's worth of calls with the icon pressed.
+
+#include <compositionengine/UdfpsExtension.h>
+
+#include <benchmark/benchmark.h>
+
+namespace {
+
+void BM_LayerHints(benchmark::State& state) {
+    const uint32_t layers = state.range(0);
+    bool touched = true;
+
+    for (auto _ : state) {
+        for (uint32_t z = 0; z < layers; z++) {
+            benchmark::DoNotOptimize(getUdfpsZOrder(z, touched));
+            benchmark::DoNotOptimize(getUdfpsUsageBits(z, touched));
+        }
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * layers);
+}
+BENCHMARK(BM_LayerHints)->Arg(1)->Arg(8)->Arg(32);
+
+}  // namespace
+
+BENCHMARK_MAIN();
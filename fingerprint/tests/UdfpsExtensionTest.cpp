@@ -0,0 +1,40 @@
+/*
+ * Copyright (C) 2021 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <compositionengine/UdfpsExtension.h>
+#include <drm/sde_drm.h>
+#include <gtest/gtest.h>
+#include <hardware/gralloc.h>
+
+namespace {
+
+TEST(UdfpsExtensionTest, PressedIconIsTaggedForTheDriver) {
+    EXPECT_EQ(getUdfpsZOrder(7, true), 7u | FOD_PRESSED_LAYER_ZORDER);
+}
+
+TEST(UdfpsExtensionTest, ReleasedIconKeepsItsZOrder) {
+    EXPECT_EQ(getUdfpsZOrder(7, false), 7u);
+    EXPECT_EQ(getUdfpsZOrder(getUdfpsZOrder(7, true), true), 7u | FOD_PRESSED_LAYER_ZORDER);
+}
+
+TEST(UdfpsExtensionTest, UsageIsLeftToSurfaceFlinger) {
+    constexpr uint64_t kLayerUsage = GRALLOC_USAGE_HW_COMPOSER | GRALLOC_USAGE_HW_TEXTURE;
+
+    EXPECT_EQ(getUdfpsUsageBits(kLayerUsage, true), kLayerUsage);
+    EXPECT_EQ(getUdfpsUsageBits(kLayerUsage, false), kLayerUsage);
+}
+
+}  // namespace
@@ -0,0 +1,211 @@
+/*
+ * Copyright (C) 2021 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "IoTuner.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <algorithm>
+
+#include <android-base/parseint.h>
+#include <android-base/strings.h>
+
+namespace iotune {
+
+namespace {
+
+// Indexed by Profile. The boot values match what init.target.rc writes
+// before the daemon starts, idle is the old static runtime setup.
+constexpr Tunables kTunables[] = {
+        {2048, 256, 2048},
+        {128, 256, 128},
+        {1024, 128, 1024},
+        {128, 128, 512},
+};
+
+// A launch either stalls on I/O or issues many reads too small to have
+// benefited from read-ahead.
+constexpr float kLaunchStallRatio = 10.0f;
+constexpr float kLaunchIops = 150.0f;
+constexpr float kLaunchMaxKbPerIo = 64.0f;
+
+// Streaming reads are large and sustained.
+constexpr float kStreamingMinKbPerIo = 128.0f;
+constexpr float kStreamingMinKbps = 1024.0f;
+
+}  // anonymous namespace
+
+const char* ProfileToString(Profile profile) {
+    switch (profile) {
+        case Profile::BOOT:
+            return "boot";
+        case Profile::LAUNCH:
+            return "launch";
+        case Profile::STREAMING:
+            return "streaming";
+        case Profile::IDLE:
+            return "idle";
+    }
+    return "unknown";
+}
+
+bool ParseDiskStat(const char* buf, size_t len, DiskStat* out) {
+    char tmp[256];
+    len = std::min(len, sizeof(tmp) - 1);
+    memcpy(tmp, buf, len);
+    tmp[len] = '\0';
+
+    uint64_t readMerges;
+    return sscanf(tmp, "%" SCNu64 " %" SCNu64 " %" SCNu64, &out->readIos, &readMerges,
+                  &out->readSectors) == 3;
+}
+
+bool ParseIoPressure(const char* buf, size_t len, uint64_t* stallTotalUs) {
+    char tmp[128];
+    const char* eol = static_cast<const char*>(memchr(buf, '\n', len));
+    len = std::min(static_cast<size_t>(eol ? eol - buf : len), sizeof(tmp) - 1);
+    memcpy(tmp, buf, len);
+    tmp[len] = '\0';
+
+    float avg10, avg60, avg300;
+    return sscanf(tmp, "some avg10=%f avg60=%f avg300=%f total=%" SCNu64, &avg10, &avg60,
+                  &avg300, stallTotalUs) == 4;
+}
+
+bool ParseTrace(const std::string& trace, std::vector<TimedSample>* out) {
+    out->clear();
+    for (const auto& record : android::base::Split(trace, "@")) {
+        std::vector<std::string> lines = android::base::Split(record, "\n");
+        if (lines.size() < 2) {
+            // Only the text before the first sample has no line break.
+            if (!android::base::Trim(record).empty()) {
+                return false;
+            }
+            continue;
+        }
+
+        TimedSample s = {};
+        if (!android::base::ParseInt(lines[0], &s.ms)) {
+            return false;
+        }
+        for (size_t i = 1; i < lines.size(); i++) {
+            const std::string& line = lines[i];
+            size_t space = line.find(' ');
+            std::string key = line.substr(0, space);
+            const char* value = space == std::string::npos ? "" : line.c_str() + space + 1;
+
+            if (key == "boot_completed") {
+                s.bootCompleted = true;
+            } else if (key == "io") {
+                if (!ParseIoPressure(value, strlen(value), &s.sample.stallTotalUs)) {
+                    return false;
+                }
+            } else if (!key.empty()) {
+                DiskStat stat;
+                if (!ParseDiskStat(value, strlen(value), &stat)) {
+                    return false;
+                }
+                s.sample.disk.readIos += stat.readIos;
+                s.sample.disk.readSectors += stat.readSectors;
+            }
+        }
+        out->push_back(s);
+    }
+    return true;
+}
+
+IoTuner::IoTuner()
+    : profile_(Profile::BOOT),
+      booted_(false),
+      have_last_(false),
+      last_{},
+      last_ms_(0),
+      pending_(Profile::BOOT),
+      pending_since_ms_(-1),
+      read_iops_(0),
+      read_kb_per_io_(0),
+      read_kbps_(0),
+      stall_ratio_(0) {}
+
+const Tunables& IoTuner::tunables() const {
+    return kTunables[static_cast<int>(profile_)];
+}
+
+void IoTuner::bootCompleted() {
+    booted_ = true;
+}
+
+Profile IoTuner::classify() const {
+    if (!booted_) {
+        return Profile::BOOT;
+    }
+    if (stall_ratio_ >= kLaunchStallRatio ||
+        (read_iops_ >= kLaunchIops && read_kb_per_io_ < kLaunchMaxKbPerIo)) {
+        return Profile::LAUNCH;
+    }
+    if (read_kb_per_io_ >= kStreamingMinKbPerIo && read_kbps_ >= kStreamingMinKbps) {
+        return Profile::STREAMING;
+    }
+    return Profile::IDLE;
+}
+
+bool IoTuner::update(const IoSample& sample, int64_t nowMs) {
+    // Counters go backwards when a device is removed, skip that window.
+    if (have_last_ && nowMs > last_ms_ && sample.disk.readIos >= last_.disk.readIos &&
+        sample.disk.readSectors >= last_.disk.readSectors &&
+        sample.stallTotalUs >= last_.stallTotalUs) {
+        float window_s = (nowMs - last_ms_) / 1000.0f;
+        uint64_t ios = sample.disk.readIos - last_.disk.readIos;
+        float kb = (sample.disk.readSectors - last_.disk.readSectors) / 2.0f;
+        read_iops_ = ios / window_s;
+        read_kbps_ = kb / window_s;
+        read_kb_per_io_ = ios > 0 ? kb / ios : 0;
+        stall_ratio_ = (sample.stallTotalUs - last_.stallTotalUs) / (window_s * 10000.0f);
+    }
+    last_ = sample;
+    last_ms_ = nowMs;
+    have_last_ = true;
+
+    Profile target = classify();
+    if (target == profile_) {
+        pending_since_ms_ = -1;
+        return false;
+    }
+
+    if (target == Profile::LAUNCH || profile_ == Profile::BOOT) {
+        profile_ = target;
+        pending_since_ms_ = -1;
+        return true;
+    }
+
+    if (pending_since_ms_ < 0 || pending_ != target) {
+        pending_ = target;
+        pending_since_ms_ = nowMs;
+        return false;
+    }
+
+    if (nowMs - pending_since_ms_ < kHoldMs) {
+        return false;
+    }
+
+    profile_ = target;
+    pending_since_ms_ = -1;
+    return true;
+}
+
+}  // namespace iotune
@@ -0,0 +1,116 @@
+/*
+ * Copyright (C) 2021 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+namespace iotune {
+
+// The read side of /sys/block/<dev>/stat, summed over the tuned disks.
+struct DiskStat {
+    uint64_t readIos;
+    uint64_t readSectors;
+};
+
+// One snapshot of the block layer and /proc/pressure/io.
+struct IoSample {
+    DiskStat disk;
+    uint64_t stallTotalUs;
+};
+
+enum class Profile {
+    // Everything is read for the first time, read ahead as far as possible.
+    BOOT = 0,
+    // Lots of small random reads, deep queue and little read-ahead.
+    LAUNCH,
+    // Large sequential reads, e.g. media playback.
+    STREAMING,
+    IDLE,
+};
+
+struct Tunables {
+    int ufsReadAheadKb;
+    int ufsNrRequests;
+    int dmReadAheadKb;
+};
+
+const char* ProfileToString(Profile profile);
+
+// Parse the contents of /sys/block/<dev>/stat, returns false on malformed input.
+bool ParseDiskStat(const char* buf, size_t len, DiskStat* out);
+
+// Parse the "some" total out of /proc/pressure/io.
+bool ParseIoPressure(const char* buf, size_t len, uint64_t* stallTotalUs);
+
+// A sample of a recorded trace, taken at the given monotonic time.
+struct TimedSample {
+    int64_t ms;
+    // Boot completed right before this sample.
+    bool bootCompleted;
+    IoSample sample;
+};
+
+// Parse a recorded trace. Every sample is an "@<monotonic ms>" line followed
+// by "<dev> <contents of /sys/block/<dev>/stat>" lines and an
+// "io <first line of /proc/pressure/io>" line, the disks are summed up. A
+// "boot_completed" line marks the end of boot. Returns false on malformed
+// input.
+bool ParseTrace(const std::string& trace, std::vector<TimedSample>* out);
+
+// Picks a queue profile from how much and how the disks are read. Launches
+// are switched to right away, every other change has to hold for kHoldMs.
+class IoTuner {
+  public:
+    static constexpr int64_t kHoldMs = 3000;
+
+    IoTuner();
+
+    // Leaves the boot profile, the next update picks a runtime one.
+    void bootCompleted();
+
+    // Feed a new sample taken at nowMs, returns true if the profile changed.
+    bool update(const IoSample& sample, int64_t nowMs);
+
+    Profile profile() const { return profile_; }
+    const Tunables& tunables() const;
+
+    // Read load of the last update.
+    float readIops() const { return read_iops_; }
+    float readKbPerIo() const { return read_kb_per_io_; }
+    float stallRatio() const { return stall_ratio_; }
+
+  private:
+    Profile classify() const;
+
+    Profile profile_;
+    bool booted_;
+    bool have_last_;
+    IoSample last_;
+    int64_t last_ms_;
+    Profile pending_;
+    int64_t pending_since_ms_;
+    float read_iops_;
+    float read_kb_per_io_;
+    float read_kbps_;
+    float stall_ratio_;
+};
+
+}  // namespace iotune
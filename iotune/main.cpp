@@ -0,0 +1,254 @@
+/*
+ * Copyright (C) 2021 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "iotuned"
+
+#include <fcntl.h>
+#include <poll.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <android-base/file.h>
+#include <android-base/logging.h>
+#include <android-base/properties.h>
+#include <android-base/unique_fd.h>
+#include <sysfs/Node.h>
+
+#include "IoTuner.h"
+
+using ::android::base::GetBoolProperty;
+using ::android::base::ReadFileToString;
+using ::android::base::unique_fd;
+
+using ::iotune::DiskStat;
+using ::iotune::IoSample;
+using ::iotune::IoTuner;
+using ::iotune::ParseDiskStat;
+using ::iotune::ParseIoPressure;
+using ::iotune::ParseTrace;
+using ::iotune::Profile;
+using ::iotune::ProfileToString;
+using ::iotune::TimedSample;
+using ::iotune::Tunables;
+
+namespace {
+
+constexpr const char* kPsiIoPath = "/proc/pressure/io";
+
+// The UFS LUNs holding the dynamic partitions and userdata, and the dm
+// devices stacked on top of them. Only the disks are sampled, dm I/O shows
+// up there as well.
+constexpr const char* kUfsDevices[] = {"sda", "sde"};
+constexpr const char* kDmDevices[] = {"dm-0", "dm-1", "dm-2"};
+
+// Stall time in us within a 1s window which wakes us up while idle.
+constexpr const char* kPsiTrigger = "some 50000 1000000";
+
+constexpr int kActivePollMs = 500;
+constexpr int kIdlePollMs = 2000;
+
+int64_t NowMs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000LL + ts.tv_nsec / 1000000;
+}
+
+std::string Describe(const IoTuner& tuner) {
+    const Tunables& t = tuner.tunables();
+    std::ostringstream out;
+    out << "profile=" << ProfileToString(tuner.profile()) << " iops=" << tuner.readIops()
+        << " kb_per_io=" << tuner.readKbPerIo() << " stall=" << tuner.stallRatio()
+        << " ufs_read_ahead_kb=" << t.ufsReadAheadKb << " ufs_nr_requests=" << t.ufsNrRequests
+        << " dm_read_ahead_kb=" << t.dmReadAheadKb;
+    return out.str();
+}
+
+std::string QueuePath(const char* dev, const char* attr) {
+    return std::string("/sys/block/") + dev + "/queue/" + attr;
+}
+
+struct Disk {
+    sysfs::Node stat;
+    sysfs::Node readAhead;
+    sysfs::Node nrRequests;
+};
+
+class Daemon {
+  public:
+    bool init();
+    void run();
+
+  private:
+    bool readSample(IoSample* sample);
+    void apply();
+
+    sysfs::Node psi_;
+    unique_fd trigger_fd_;
+    std::vector<Disk> disks_;
+    std::vector<sysfs::Node> dm_read_ahead_;
+    IoTuner tuner_;
+};
+
+bool Daemon::init() {
+    if (!psi_.open(kPsiIoPath, O_RDONLY)) {
+        return false;
+    }
+
+    for (const char* dev : kUfsDevices) {
+        Disk disk;
+        if (!disk.stat.open(std::string("/sys/block/") + dev + "/stat", O_RDONLY)) {
+            continue;
+        }
+        disk.readAhead.open(QueuePath(dev, "read_ahead_kb"), O_WRONLY);
+        disk.nrRequests.open(QueuePath(dev, "nr_requests"), O_WRONLY);
+        disks_.push_back(std::move(disk));
+    }
+    if (disks_.empty()) {
+        LOG(ERROR) << "No disks to tune";
+        return false;
+    }
+
+    for (const char* dev : kDmDevices) {
+        sysfs::Node node(QueuePath(dev, "read_ahead_kb"), O_WRONLY);
+        if (node.valid()) {
+            dm_read_ahead_.push_back(std::move(node));
+        }
+    }
+
+    // Without a trigger an idle device is only sampled every kIdlePollMs.
+    trigger_fd_.reset(
+            open((sysfs::Root() + kPsiIoPath).c_str(), O_RDWR | O_NONBLOCK | O_CLOEXEC));
+    if (trigger_fd_ < 0 || write(trigger_fd_, kPsiTrigger, strlen(kPsiTrigger) + 1) < 0) {
+        PLOG(WARNING) << "Failed to register PSI trigger \"" << kPsiTrigger << "\"";
+        trigger_fd_.reset();
+    }
+
+    apply();
+    LOG(INFO) << "event=start disks=" << disks_.size() << " dm=" << dm_read_ahead_.size() << " "
+              << Describe(tuner_);
+    return true;
+}
+
+bool Daemon::readSample(IoSample* sample) {
+    *sample = {};
+    for (const auto& disk : disks_) {
+        std::string buf;
+        DiskStat stat;
+        if (!disk.stat.read(&buf) || !ParseDiskStat(buf.data(), buf.size(), &stat)) {
+            LOG(ERROR) << "Malformed " << disk.stat.path();
+            return false;
+        }
+        sample->disk.readIos += stat.readIos;
+        sample->disk.readSectors += stat.readSectors;
+    }
+
+    std::string buf;
+    if (!psi_.read(&buf) || !ParseIoPressure(buf.data(), buf.size(), &sample->stallTotalUs)) {
+        LOG(ERROR) << "Malformed " << kPsiIoPath;
+        return false;
+    }
+    return true;
+}
+
+void Daemon::apply() {
+    const Tunables& t = tuner_.tunables();
+    for (const auto& disk : disks_) {
+        disk.readAhead.write(t.ufsReadAheadKb);
+        disk.nrRequests.write(t.ufsNrRequests);
+    }
+    for (const auto& node : dm_read_ahead_) {
+        node.write(t.dmReadAheadKb);
+    }
+}
+
+void Daemon::run() {
+    while (true) {
+        int timeout = tuner_.profile() == Profile::IDLE ? kIdlePollMs : kActivePollMs;
+        if (trigger_fd_ >= 0) {
+            struct pollfd pfd = {
+                    .fd = trigger_fd_,
+                    .events = POLLPRI,
+                    .revents = 0,
+            };
+            TEMP_FAILURE_RETRY(poll(&pfd, 1, timeout));
+        } else {
+            usleep(timeout * 1000);
+        }
+
+        if (tuner_.profile() == Profile::BOOT && GetBoolProperty("sys.boot_completed", false)) {
+            tuner_.bootCompleted();
+        }
+
+        IoSample sample;
+        if (!readSample(&sample)) {
+            continue;
+        }
+
+        if (tuner_.update(sample, NowMs())) {
+            apply();
+            LOG(INFO) << "event=profile_change " << Describe(tuner_);
+        }
+    }
+}
+
+// Replays a recorded trace, see ParseTrace, and prints the decisions.
+int Replay(const char* path) {
+    std::string trace;
+    if (!ReadFileToString(path, &trace)) {
+        PLOG(ERROR) << "Failed to read " << path;
+        return 1;
+    }
+
+    std::vector<TimedSample> samples;
+    if (!ParseTrace(trace, &samples)) {
+        LOG(ERROR) << "Malformed trace " << path;
+        return 1;
+    }
+
+    IoTuner tuner;
+    for (const auto& s : samples) {
+        if (s.bootCompleted) {
+            tuner.bootCompleted();
+        }
+        if (tuner.update(s.sample, s.ms)) {
+            std::cout << s.ms << " " << Describe(tuner) << std::endl;
+        }
+    }
+
+    return 0;
+}
+
+}  // anonymous namespace
+
+int main(int argc, char** argv) {
+    if (argc == 3 && strcmp(argv[1], "--replay") == 0) {
+        return Replay(argv[2]);
+    }
+
+    Daemon daemon;
+    if (!daemon.init()) {
+        return 1;
+    }
+
+    daemon.run();
+    return 1;  // should never get here
+}
@@ -0,0 +1,112 @@
+/*
+ * Copyright (C) 2021 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Replays recorded traces through IoTuner and checks the profile changes it
+// decides on.
+
+#include <string>
+#include <vector>
+
+#include <android-base/file.h>
+#include <gtest/gtest.h>
+
+#include "../IoTuner.h"
+
+namespace iotune {
+namespace {
+
+struct Change {
+    int64_t ms;
+    Profile profile;
+
+    bool operator==(const Change& other) const {
+        return ms == other.ms && profile == other.profile;
+    }
+};
+
+void PrintTo(const Change& change, std::ostream* os) {
+    *os << change.ms << ":" << ProfileToString(change.profile);
+}
+
+std::vector<TimedSample> LoadTrace(const std::string& name) {
+    std::string trace;
+    std::vector<TimedSample> samples;
+    std::string path = android::base::GetExecutableDirectory() + "/traces/" + name;
+    EXPECT_TRUE(android::base::ReadFileToString(path, &trace)) << path;
+    EXPECT_TRUE(ParseTrace(trace, &samples)) << path;
+    return samples;
+}
+
+std::vector<Change> Replay(const std::vector<TimedSample>& samples) {
+    IoTuner tuner;
+    std::vector<Change> changes;
+    for (const auto& s : samples) {
+        if (s.bootCompleted) {
+            tuner.bootCompleted();
+        }
+        if (tuner.update(s.sample, s.ms)) {
+            changes.push_back({s.ms, tuner.profile()});
+        }
+    }
+    return changes;
+}
+
+TEST(ParseTraceTest, SumsTheDisks) {
+    std::vector<TimedSample> samples;
+    ASSERT_TRUE(ParseTrace("@500\n"
+                           "sda 100 5 2000 0 0 0 0 0 0 0 0\n"
+                           "sde 10 0 80 0 0 0 0 0 0 0 0\n"
+                           "io some avg10=0.00 avg60=0.00 avg300=0.00 total=1234\n"
+                           "@1000\n"
+                           "boot_completed\n"
+                           "sda 120 5 2400 0 0 0 0 0 0 0 0\n"
+                           "io some avg10=0.00 avg60=0.00 avg300=0.00 total=2000\n",
+                           &samples));
+    ASSERT_EQ(samples.size(), 2u);
+    EXPECT_EQ(samples[0].ms, 500);
+    EXPECT_FALSE(samples[0].bootCompleted);
+    EXPECT_EQ(samples[0].sample.disk.readIos, 110u);
+    EXPECT_EQ(samples[0].sample.disk.readSectors, 2080u);
+    EXPECT_EQ(samples[0].sample.stallTotalUs, 1234u);
+    EXPECT_TRUE(samples[1].bootCompleted);
+    EXPECT_EQ(samples[1].sample.disk.readIos, 120u);
+}
+
+TEST(ParseTraceTest, RejectsMalformedInput) {
+    std::vector<TimedSample> samples;
+    EXPECT_FALSE(ParseTrace("@5s\nio some avg10=0 avg60=0 avg300=0 total=0\n", &samples));
+    EXPECT_FALSE(ParseTrace("@500\nio total=0\n", &samples));
+    EXPECT_FALSE(ParseTrace("@500\nsda x\n", &samples));
+}
+
+// The end of boot, an app launch, then video playback until the screen goes
+// off. Launches apply right away, everything else after kHoldMs.
+TEST(IoTunerReplayTest, LaunchThenVideo) {
+    std::vector<TimedSample> samples = LoadTrace("launch_then_video.trace");
+    ASSERT_EQ(samples.size(), 50u);
+
+    std::vector<Change> expected = {
+            {9187500, Profile::IDLE},
+            {9192500, Profile::LAUNCH},
+            {9197500, Profile::IDLE},
+            {9202500, Profile::STREAMING},
+            {9211000, Profile::IDLE},
+    };
+    EXPECT_EQ(Replay(samples), expected);
+}
+
+}  // namespace
+}  // namespace iotune
@@ -18,34 +18,18 @@
 #define LOG_TAG "android.hardware.lights-service_xiaomi.raphael"
 
 #include "Lights.h"
-#include <android-base/file.h>
 #include <android-base/logging.h>
 
 namespace {
 
-/* clang-format off */
-#define PPCAT_NX(A, B) A/B
-#define PPCAT(A, B) PPCAT_NX(A, B)
-#define STRINGIFY_INNER(x) #x
-#define STRINGIFY(x) STRINGIFY_INNER(x)
-
-#define LEDS(x) PPCAT(/sys/class/leds, x)
-#define GREEN_ATTR(x) STRINGIFY(PPCAT(LEDS(green), x))
-/* clang-format on */
-
-using ::android::base::ReadFileToString;
-using ::android::base::WriteStringToFile;
-
 // Default max brightness
 constexpr auto kDefaultMaxLedBrightness = 255;
 
 // Each step will stay on for 70ms by default.
 constexpr auto kRampStepDurationDefault = 70;
 
-// Write value to path and close file.
-bool WriteToFile(const std::string& path, uint32_t content) {
-    return WriteStringToFile(std::to_string(content), path);
-}
+// The popup camera animation runs twice as fast.
+constexpr auto kRampStepDurationPopupCamera = 35;
 
 uint32_t RgbaToBrightness(uint32_t color) {
     // Extract brightness from AARRGGBB.
@@ -74,6 +58,10 @@ inline bool IsLit(uint32_t color) {
     return color & 0x00ffffff;
 }
 
+std::string MakeLedPath(const std::string& led, const std::string& op) {
+    return "/sys/class/leds/" + led + "/" + op;
+}
+
 }  // anonymous namespace
 
 namespace aidl {
@@ -82,29 +70,30 @@ namespace hardware {
 namespace light {
 
 Lights::Lights() {
-    std::map<int, std::function<void(int id, const HwLightState&)>> lights_{
-            {(int)LightType::NOTIFICATIONS,
-             [this](auto&&... args) { setLightNotification(args...); }},
-            {(int)LightType::BATTERY, [this](auto&&... args) { setLightNotification(args...); }},
-            {(int)LightType::BACKLIGHT, {}}};
+    mLights = {
+            {(int)LightType::NOTIFICATIONS, LightType::NOTIFICATIONS},
+            {(int)LightType::BATTERY, LightType::BATTERY},
+            {(int)LightType::BACKLIGHT, LightType::BACKLIGHT},
+            {kPopupCameraLightId, kPopupCameraLightType},
+    };
 
     std::vector<HwLight> availableLights;
-    for (auto const& pair : lights_) {
-        int id = pair.first;
+    for (auto const& pair : mLights) {
         HwLight hwLight{};
-        hwLight.id = id;
+        hwLight.id = pair.first;
+        hwLight.type = pair.second;
         availableLights.emplace_back(hwLight);
     }
     mAvailableLights = availableLights;
-    mLights = lights_;
-
-    std::string buf;
 
-    if (ReadFileToString(GREEN_ATTR(max_brightness), &buf)) {
-        max_led_brightness_ = std::stoi(buf);
-    } else {
-        max_led_brightness_ = kDefaultMaxLedBrightness;
-        LOG(ERROR) << "Failed to read max LED brightness, fallback to " << kDefaultMaxLedBrightness;
+    leds_[0].name = "green";
+    leds_[1].name = "blue";
+    for (auto& led : leds_) {
+        if (!sysfs::ReadValue(MakeLedPath(led.name, "max_brightness"), &led.max_brightness)) {
+            led.max_brightness = kDefaultMaxLedBrightness;
+            LOG(ERROR) << "Failed to read max " << led.name << " LED brightness, fallback to "
+                       << kDefaultMaxLedBrightness;
+        }
     }
 }
 
@@ -115,8 +104,14 @@ ndk::ScopedAStatus Lights::setLightState(int id, const HwLightState& state) {
         return ndk::ScopedAStatus::fromExceptionCode(EX_UNSUPPORTED_OPERATION);
     }
 
-    if (it->second != nullptr)
-    	it->second(id, state);
+    std::lock_guard<std::mutex> lock(lock_);
+    for (auto&& [cur_id, cur_state] : states_) {
+        if (cur_id == id) {
+            cur_state = state;
+            update();
+            break;
+        }
+    }
 
     return ndk::ScopedAStatus::ok();
 }
@@ -128,47 +123,97 @@ ndk::ScopedAStatus Lights::getLights(std::vector<HwLight>* lights) {
     return ndk::ScopedAStatus::ok();
 }
 
-void Lights::setLightNotification(int id, const HwLightState& state) {
-    bool found = false;
-    for (auto&& [cur_id, cur_state] : notif_states_) {
-        if (cur_id == id) {
-            cur_state = state;
+// Picks the most important active source and recomputes every LED from it.
+void Lights::update() {
+    for (auto&& [id, state] : states_) {
+        if (id == kPopupCameraLightId) {
+            if (!IsLit(state.color)) {
+                continue;
+            }
+            LOG(DEBUG) << __func__ << ": id=" << id;
+            LedProgram program = popupCameraProgram(state);
+            for (auto& led : leds_) {
+                flush(led, program);
+            }
+            return;
         }
 
         // Fallback to battery light
-        if (!found && (cur_id == (int)LightType::BATTERY || IsLit(cur_state.color))) {
-            found = true;
+        if (id == (int)LightType::BATTERY || IsLit(state.color)) {
             LOG(DEBUG) << __func__ << ": id=" << id;
-            applyNotificationState(cur_state);
+            flush(leds_[0], notificationProgram(leds_[0], state));
+            flush(leds_[1], {{"breath", 0}, {"brightness", 0}});
+            return;
         }
     }
 }
 
-void Lights::applyNotificationState(const HwLightState& state) {
-    std::map<std::string, int> colorValues;
-    colorValues["green"] = RgbaToBrightness(state.color, max_led_brightness_);
+Lights::LedProgram Lights::notificationProgram(const LedChannel& led,
+                                               const HwLightState& state) const {
+    // Turn off the leds (initially)
+    LedProgram program = {{"breath", 0}};
+
+    if (state.flashMode == FlashMode::TIMED && state.flashOnMs > 0 && state.flashOffMs > 0) {
+        program.insert(program.end(), {
+                                              {"step_ms", kRampStepDurationDefault},
+                                              {"pause_lo_count", 30},
+                                              {"lo_idx", 0},
+                                              {"delay_on", state.flashOnMs},
+                                              {"delay_off", state.flashOffMs},
+                                              {"breath", 1},
+                                      });
+    } else {
+        program.emplace_back("brightness", RgbaToBrightness(state.color, led.max_brightness));
+    }
+
+    return program;
+}
 
-    auto makeLedPath = [](const std::string& led, const std::string& op) -> std::string {
-        return "/sys/class/leds/" + led + "/" + op;
+Lights::LedProgram Lights::popupCameraProgram(const HwLightState& state) const {
+    bool raise = (state.color & 0xFF00) != 0;
+    return {
+            {"breath", 0},
+            {"brightness", 0},
+            {"lo_idx", raise ? 0 : 22},
+            {"pause_lo_count", raise ? 5 : 0},
+            {"step_ms", kRampStepDurationPopupCamera},
+            {"lut_pattern", 1},
+            {"breath", 1},
     };
-    for (const auto& entry : colorValues) {
-        // Turn off the leds (initially)
-        WriteToFile(makeLedPath(entry.first, "breath"), 0);
-        if (state.flashMode == FlashMode::TIMED && state.flashOnMs > 0 && state.flashOffMs > 0) {
-            WriteToFile(makeLedPath(entry.first, "step_ms"),
-                        static_cast<uint32_t>(kRampStepDurationDefault)),
-                    WriteToFile(makeLedPath(entry.first, "pause_lo_count"), 30),
-                    WriteToFile(makeLedPath(entry.first, "lo_idx"), 0);
-            WriteToFile(makeLedPath(entry.first, "lux_pattern"), 0);
-            WriteToFile(makeLedPath(entry.first, "delay_on"),
-                        static_cast<uint32_t>(state.flashOnMs));
-            WriteToFile(makeLedPath(entry.first, "delay_off"),
-                        static_cast<uint32_t>(state.flashOffMs));
-            WriteToFile(makeLedPath(entry.first, "breath"), 1);
-        } else {
-            WriteToFile(makeLedPath(entry.first, "brightness"), entry.second);
+}
+
+// Writes a program to an LED, skipping attributes which already hold the
+// requested value. Programs start by stopping the breath effect, so a
+// changed program always ends up re-triggering it.
+void Lights::flush(LedChannel& led, LedProgram program) {
+    if (program == led.program) {
+        return;
+    }
+
+    for (const auto& [attr, value] : program) {
+        auto it = led.written.find(attr);
+        if (it != led.written.end() && it->second == value) {
+            continue;
+        }
+
+        auto node = led.nodes.find(attr);
+        if (node == led.nodes.end()) {
+            node = led.nodes.emplace(attr, sysfs::Node(MakeLedPath(led.name, attr), O_WRONLY))
+                           .first;
+        }
+        if (!node->second.write(value)) {
+            led.written.erase(attr);
+            continue;
+        }
+        led.written[attr] = value;
+
+        // The pattern engine owns the brightness while it runs.
+        if (attr == "breath") {
+            led.written.erase("brightness");
         }
     }
+
+    led.program = std::move(program);
 }
 
 }  // namespace light
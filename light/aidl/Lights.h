@@ -20,14 +20,23 @@
 #include <aidl/android/hardware/light/BnLights.h>
 #include <hardware/hardware.h>
 #include <hardware/lights.h>
+#include <array>
 #include <map>
+#include <mutex>
 #include <sstream>
+#include <sysfs/Node.h>
 
 namespace aidl {
 namespace android {
 namespace hardware {
 namespace light {
 
+// Drives both popup camera LEDs. Lit green requests the raise animation, lit
+// blue the retract animation. The type lies outside the system light range
+// so that the light is reachable through LightsManager.
+constexpr int kPopupCameraLightId = 100;
+constexpr LightType kPopupCameraLightType = static_cast<LightType>(100);
+
 class Lights : public BnLights {
   public:
     Lights();
@@ -35,16 +44,35 @@ class Lights : public BnLights {
     ndk::ScopedAStatus getLights(std::vector<HwLight>* types) override;
 
   private:
-    void setLightNotification(int id, const HwLightState& state);
-    void applyNotificationState(const HwLightState& state);
+    // Attribute writes for one LED, applied in order.
+    using LedProgram = std::vector<std::pair<std::string, uint32_t>>;
+
+    struct LedChannel {
+        std::string name;
+        uint32_t max_brightness;
+        LedProgram program;
+        // Last value written to each attribute.
+        std::map<std::string, uint32_t> written;
+        std::map<std::string, sysfs::Node> nodes;
+    };
 
-    uint32_t max_led_brightness_;
+    LedProgram notificationProgram(const LedChannel& led, const HwLightState& state) const;
+    LedProgram popupCameraProgram(const HwLightState& state) const;
+    void update();
+    void flush(LedChannel& led, LedProgram program);
 
-    std::map<int, std::function<void(int id, const HwLightState&)>> mLights;
+    std::mutex lock_;
+
+    std::map<int, LightType> mLights;
     std::vector<HwLight> mAvailableLights;
 
+    // The green LED also carries notifications, blue is only used by the
+    // popup camera animation.
+    std::array<LedChannel, 2> leds_;
+
     // Keep sorted in the order of importance.
-    std::array<std::pair<int, HwLightState>, 2> notif_states_ = {{
+    std::array<std::pair<int, HwLightState>, 3> states_ = {{
+            {kPopupCameraLightId, {}},
             {(int)LightType::NOTIFICATIONS, {}},
             {(int)LightType::BATTERY, {}},
     }};
@@ -0,0 +1,158 @@
+/*
+ * Copyright (C) 2021 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+#include <sysfs/testing/FakeSysfs.h>
+
+#include "../aidl/Lights.h"
+
+namespace aidl {
+namespace android {
+namespace hardware {
+namespace light {
+namespace {
+
+using sysfs::testing::FakeSysfs;
+using sysfs::testing::IoCounts;
+using Writes = std::vector<std::string>;
+
+constexpr const char* kAttrs[] = {"brightness",  "breath",   "delay_off",      "delay_on",
+                                  "lo_idx",      "lut_pattern", "pause_lo_count", "step_ms"};
+
+class LightsTest : public ::testing::Test {
+  protected:
+    void SetUp() override {
+        for (const char* led : {"green", "blue"}) {
+            fake_.add(std::string("/sys/class/leds/") + led + "/max_brightness", "255\n");
+            for (const char* attr : kAttrs) {
+                fake_.add(std::string("/sys/class/leds/") + led + "/" + attr, "0\n");
+            }
+        }
+        lights_ = ndk::SharedRefBase::make<Lights>();
+        fake_.resetCounts();
+    }
+
+    void set(int id, int32_t color, FlashMode flashMode = FlashMode::NONE, int32_t onMs = 0,
+             int32_t offMs = 0) {
+        HwLightState state;
+        state.color = color;
+        state.flashMode = flashMode;
+        state.flashOnMs = onMs;
+        state.flashOffMs = offMs;
+        ASSERT_TRUE(lights_->setLightState(id, state).isOk());
+    }
+
+    FakeSysfs fake_;
+    std::shared_ptr<Lights> lights_;
+};
+
+TEST_F(LightsTest, ListsThePopupCameraLight) {
+    std::vector<HwLight> lights;
+    ASSERT_TRUE(lights_->getLights(&lights).isOk());
+    EXPECT_EQ(lights.size(), 4u);
+    EXPECT_TRUE(std::any_of(lights.begin(), lights.end(), [](const HwLight& light) {
+        return light.id == kPopupCameraLightId && light.type == kPopupCameraLightType;
+    }));
+}
+
+TEST_F(LightsTest, RejectsUnknownLights) {
+    HwLightState state;
+    EXPECT_FALSE(lights_->setLightState(42, state).isOk());
+    EXPECT_EQ(fake_.counts(), IoCounts());
+}
+
+TEST_F(LightsTest, SolidNotification) {
+    set((int)LightType::NOTIFICATIONS, 0xff00ff00);
+    EXPECT_EQ(fake_.allWrites(), (Writes{
+                                         "/sys/class/leds/green/breath=0",
+                                         "/sys/class/leds/green/brightness=149",
+                                         "/sys/class/leds/blue/breath=0",
+                                         "/sys/class/leds/blue/brightness=0",
+                                 }));
+}
+
+TEST_F(LightsTest, FlashingNotification) {
+    set((int)LightType::NOTIFICATIONS, 0xff00ff00, FlashMode::TIMED, 1000, 3000);
+    EXPECT_EQ(fake_.writes("/sys/class/leds/green/delay_on"), Writes{"1000"});
+    EXPECT_EQ(fake_.writes("/sys/class/leds/green/delay_off"), Writes{"3000"});
+    EXPECT_EQ(fake_.writes("/sys/class/leds/green/step_ms"), Writes{"70"});
+    EXPECT_EQ(fake_.writes("/sys/class/leds/green/breath"), (Writes{"0", "1"}));
+    EXPECT_EQ(fake_.value("/sys/class/leds/green/breath"), "1");
+}
+
+TEST_F(LightsTest, RepeatedStatesAreNotWritten) {
+    set((int)LightType::NOTIFICATIONS, 0xff00ff00);
+    fake_.resetCounts();
+    for (int i = 0; i < 10; i++) {
+        set((int)LightType::NOTIFICATIONS, 0xff00ff00);
+    }
+    EXPECT_EQ(fake_.counts(), IoCounts());
+}
+
+TEST_F(LightsTest, NodesAreOpenedOnce) {
+    for (int i = 0; i < 10; i++) {
+        set((int)LightType::NOTIFICATIONS, i % 2 ? 0xff00ff00 : 0xff008000);
+    }
+    EXPECT_EQ(fake_.counts("/sys/class/leds/green/brightness"),
+              (IoCounts{.opens = 1, .writes = 10}));
+    // Only the first change has to stop the blue LED.
+    EXPECT_EQ(fake_.counts("/sys/class/leds/blue/brightness"), (IoCounts{.opens = 1, .writes = 1}));
+}
+
+TEST_F(LightsTest, PopupCameraOverridesNotifications) {
+    set((int)LightType::NOTIFICATIONS, 0xff00ff00);
+    fake_.resetCounts();
+
+    set(kPopupCameraLightId, 0xff00ff00);
+    for (const char* led : {"green", "blue"}) {
+        std::string base = std::string("/sys/class/leds/") + led + "/";
+        EXPECT_EQ(fake_.value(base + "lo_idx"), "0");
+        EXPECT_EQ(fake_.value(base + "pause_lo_count"), "5");
+        EXPECT_EQ(fake_.value(base + "step_ms"), "35");
+        EXPECT_EQ(fake_.value(base + "lut_pattern"), "1");
+        EXPECT_EQ(fake_.value(base + "breath"), "1");
+    }
+
+    // Retracting only rewrites what differs from the raise animation, and
+    // the brightness the pattern engine took over.
+    fake_.resetCounts();
+    set(kPopupCameraLightId, 0xff0000ff);
+    EXPECT_EQ(fake_.allWrites(), (Writes{
+                                         "/sys/class/leds/green/breath=0",
+                                         "/sys/class/leds/green/brightness=0",
+                                         "/sys/class/leds/green/lo_idx=22",
+                                         "/sys/class/leds/green/pause_lo_count=0",
+                                         "/sys/class/leds/green/breath=1",
+                                         "/sys/class/leds/blue/breath=0",
+                                         "/sys/class/leds/blue/brightness=0",
+                                         "/sys/class/leds/blue/lo_idx=22",
+                                         "/sys/class/leds/blue/pause_lo_count=0",
+                                         "/sys/class/leds/blue/breath=1",
+                                 }));
+
+    // Once the animation ends the notification comes back.
+    fake_.resetCounts();
+    set(kPopupCameraLightId, 0);
+    EXPECT_EQ(fake_.value("/sys/class/leds/green/breath"), "0");
+    EXPECT_EQ(fake_.value("/sys/class/leds/green/brightness"), "149");
+    EXPECT_EQ(fake_.value("/sys/class/leds/blue/brightness"), "0");
+}
+
+}  // namespace
+}  // namespace light
+}  // namespace hardware
+}  // namespace android
+}  // namespace aidl
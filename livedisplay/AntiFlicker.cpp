@@ -18,7 +18,6 @@
 
 #include "AntiFlicker.h"
 #include <android-base/logging.h>
-#include <fstream>
 
 namespace vendor {
 namespace lineage {
@@ -29,19 +28,17 @@ namespace implementation {
 static constexpr const char* kDcDimmingPath =
     "/sys/devices/platform/soc/soc:qcom,dsi-display-primary/msm_fb_ea_enable";
 
+AntiFlicker::AntiFlicker() : mDcDimming(kDcDimmingPath) {}
+
 Return<bool> AntiFlicker::isEnabled() {
-    std::ifstream file(kDcDimmingPath);
     int result = -1;
-    file >> result;
-    LOG(DEBUG) << "Got result " << result << " fail " << file.fail();
-    return !file.fail() && result > 0;
+    bool ok = mDcDimming.read(&result);
+    LOG(DEBUG) << "Got result " << result << " ok " << ok;
+    return ok && result > 0;
 }
 
 Return<bool> AntiFlicker::setEnabled(bool enabled) {
-    std::ofstream file(kDcDimmingPath);
-    file << (enabled ? "1" : "0");
-    LOG(DEBUG) << "setEnabled fail " << file.fail();
-    return !file.fail();
+    return mDcDimming.write(enabled);
 }
 
 }  // namespace implementation
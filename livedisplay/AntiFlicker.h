@@ -19,6 +19,7 @@
 
 #include <hidl/MQDescriptor.h>
 #include <hidl/Status.h>
+#include <sysfs/Node.h>
 #include <vendor/lineage/livedisplay/2.1/IAntiFlicker.h>
 
 namespace vendor {
@@ -33,9 +34,14 @@ using ::android::sp;
 
 class AntiFlicker : public IAntiFlicker {
   public:
+    AntiFlicker();
+
     // Methods from ::vendor::lineage::livedisplay::V2_1::IAntiFlicker follow.
     Return<bool> isEnabled() override;
     Return<bool> setEnabled(bool enabled) override;
+
+  private:
+    sysfs::Node mDcDimming;
 };
 
 }  // namespace implementation
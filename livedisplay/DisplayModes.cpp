@@ -0,0 +1,151 @@
+/*
+ * Copyright (C) 2021 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "DisplayModesService"
+
+#include "DisplayModes.h"
+
+#include <android-base/logging.h>
+
+#include <vector>
+
+namespace vendor {
+namespace lineage {
+namespace livedisplay {
+namespace V2_0 {
+namespace implementation {
+
+static const DisplayMode kInvalidMode = {-1, ""};
+
+DisplayModes::DisplayModes(std::shared_ptr<SDMController> controller,
+                           const std::string& calibrationPath)
+    : mController(std::move(controller)), mCurrentId(-1), mDefaultId(-1) {
+    if (!loadCalibrationModes(calibrationPath) && !loadSdmModes()) {
+        return;
+    }
+
+    if (mController->getActiveDisplayMode(&mCurrentId) != 0) {
+        mCurrentId = -1;
+    }
+    if (mController->getDefaultDisplayMode(&mDefaultId) != 0) {
+        mDefaultId = -1;
+    }
+    LOG(INFO) << mModes.size() << " display modes, current " << mCurrentId << " default "
+              << mDefaultId;
+}
+
+bool DisplayModes::loadCalibrationModes(const std::string& path) {
+    if (!mCalibration.open(path)) {
+        return false;
+    }
+
+    size_t count = 0;
+    for (size_t i = 0; i < mCalibration.numModes(); i++) {
+        if (mCalibration.mode(i).displayId == 0) {
+            count++;
+        }
+    }
+    if (count == 0) {
+        LOG(WARNING) << "No display modes in " << path;
+        return false;
+    }
+
+    // The names are NUL terminated inside the mapping, which outlives mModes.
+    mModes.resize(count);
+    size_t n = 0;
+    for (size_t i = 0; i < mCalibration.numModes(); i++) {
+        qdcm::Mode mode = mCalibration.mode(i);
+        if (mode.displayId == 0) {
+            mModes[n].id = mode.id;
+            mModes[n].name.setToExternal(mode.name.data(), mode.name.size());
+            n++;
+        }
+    }
+    return true;
+}
+
+bool DisplayModes::loadSdmModes() {
+    int32_t count = 0;
+    if (mController->getNumDisplayModes(&count) != 0 || count <= 0) {
+        LOG(WARNING) << "No display modes";
+        return false;
+    }
+
+    std::vector<SdmDispMode> modes(count);
+    if (mController->getDisplayModes(modes.data(), count) != 0) {
+        LOG(ERROR) << "Failed to get display modes";
+        return false;
+    }
+    mModes.resize(count);
+    for (int32_t i = 0; i < count; i++) {
+        mModes[i].id = modes[i].id;
+        mModes[i].name = modes[i].name;
+    }
+    return true;
+}
+
+const DisplayMode& DisplayModes::modeById(int32_t id) const {
+    for (const auto& mode : mModes) {
+        if (mode.id == id) {
+            return mode;
+        }
+    }
+    return kInvalidMode;
+}
+
+Return<void> DisplayModes::getDisplayModes(getDisplayModes_cb _hidl_cb) {
+    _hidl_cb(mModes);
+    return Void();
+}
+
+Return<void> DisplayModes::getCurrentDisplayMode(getCurrentDisplayMode_cb _hidl_cb) {
+    _hidl_cb(modeById(mCurrentId));
+    return Void();
+}
+
+Return<void> DisplayModes::getDefaultDisplayMode(getDefaultDisplayMode_cb _hidl_cb) {
+    _hidl_cb(modeById(mDefaultId));
+    return Void();
+}
+
+Return<bool> DisplayModes::setDisplayMode(int32_t modeID, bool makeDefault) {
+    if (modeById(modeID).id < 0) {
+        return false;
+    }
+
+    if (modeID != mCurrentId) {
+        if (mController->setActiveDisplayMode(modeID) != 0) {
+            LOG(ERROR) << "Failed to switch to display mode " << modeID;
+            return false;
+        }
+        mCurrentId = modeID;
+    }
+
+    if (makeDefault && modeID != mDefaultId) {
+        if (mController->setDefaultDisplayMode(modeID) != 0) {
+            LOG(ERROR) << "Failed to make display mode " << modeID << " the default";
+            return false;
+        }
+        mDefaultId = modeID;
+    }
+    return true;
+}
+
+}  // namespace implementation
+}  // namespace V2_0
+}  // namespace livedisplay
+}  // namespace lineage
+}  // namespace vendor
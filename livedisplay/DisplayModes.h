@@ -0,0 +1,78 @@
+/*
+ * Copyright (C) 2021 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef VENDOR_LINEAGE_LIVEDISPLAY_V2_0_DISPLAYMODES_H
+#define VENDOR_LINEAGE_LIVEDISPLAY_V2_0_DISPLAYMODES_H
+
+#include <hidl/MQDescriptor.h>
+#include <hidl/Status.h>
+#include <livedisplay/sdm/SDMController.h>
+#include <qdcm/Blob.h>
+#include <vendor/lineage/livedisplay/2.0/IDisplayModes.h>
+
+#include <memory>
+#include <string>
+
+namespace vendor {
+namespace lineage {
+namespace livedisplay {
+namespace V2_0 {
+namespace implementation {
+
+using ::android::hardware::hidl_vec;
+using ::android::hardware::Return;
+using ::android::hardware::Void;
+using ::android::sp;
+using ::vendor::lineage::livedisplay::V2_0::sdm::SDMController;
+
+// The mode list never changes at runtime and this service is the only one
+// switching modes, so everything SDM reports is read once and the cache is
+// only updated when a switch actually goes through. The list itself comes
+// from the compiled calibration blob, whose names are handed out in place,
+// and from SDM only when the blob can't be used.
+class DisplayModes : public IDisplayModes {
+  public:
+    explicit DisplayModes(std::shared_ptr<SDMController> controller,
+                          const std::string& calibrationPath = qdcm::kCalibrationPath);
+
+    bool isSupported() const { return mModes.size() > 0; }
+
+    // Methods from ::vendor::lineage::livedisplay::V2_0::IDisplayModes follow.
+    Return<void> getDisplayModes(getDisplayModes_cb _hidl_cb) override;
+    Return<void> getCurrentDisplayMode(getCurrentDisplayMode_cb _hidl_cb) override;
+    Return<void> getDefaultDisplayMode(getDefaultDisplayMode_cb _hidl_cb) override;
+    Return<bool> setDisplayMode(int32_t modeID, bool makeDefault) override;
+
+  private:
+    bool loadCalibrationModes(const std::string& path);
+    bool loadSdmModes();
+    const DisplayMode& modeById(int32_t id) const;
+
+    std::shared_ptr<SDMController> mController;
+    // Backs the mode names when they come from the blob.
+    qdcm::Blob mCalibration;
+    hidl_vec<DisplayMode> mModes;
+    int32_t mCurrentId;
+    int32_t mDefaultId;
+};
+
+}  // namespace implementation
+}  // namespace V2_0
+}  // namespace livedisplay
+}  // namespace lineage
+}  // namespace vendor
+
+#endif  // VENDOR_LINEAGE_LIVEDISPLAY_V2_0_DISPLAYMODES_H
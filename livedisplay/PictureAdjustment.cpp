@@ -0,0 +1,123 @@
+/*
+ * Copyright (C) 2021 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "PictureAdjustmentService"
+
+#include "PictureAdjustment.h"
+
+#include <android-base/logging.h>
+
+namespace vendor {
+namespace lineage {
+namespace livedisplay {
+namespace V2_0 {
+namespace implementation {
+
+static HSIC ToHSIC(const HsicData& data) {
+    return {
+            .hue = static_cast<float>(data.hue),
+            .saturation = data.saturation,
+            .intensity = data.intensity,
+            .contrast = data.contrast,
+            .saturationThreshold = data.saturationThreshold,
+    };
+}
+
+static bool operator==(const HSIC& a, const HSIC& b) {
+    return a.hue == b.hue && a.saturation == b.saturation && a.intensity == b.intensity &&
+           a.contrast == b.contrast && a.saturationThreshold == b.saturationThreshold;
+}
+
+PictureAdjustment::PictureAdjustment(std::shared_ptr<SDMController> controller)
+    : mController(std::move(controller)), mSupported(false), mRanges{}, mCurrent{}, mDefault{} {
+    HsicConfig config{};
+    if (mController->getGlobalPaRange(&mRanges) != 0 ||
+        mController->getGlobalPaConfig(&config) != 0) {
+        LOG(WARNING) << "Picture adjustment is not supported";
+        return;
+    }
+
+    mSupported = mRanges.hue.max > mRanges.hue.min;
+    // Whatever SDM applied at boot comes from the panel calibration.
+    mDefault = mCurrent = ToHSIC(config.data);
+}
+
+Return<void> PictureAdjustment::getHueRange(getHueRange_cb _hidl_cb) {
+    _hidl_cb({mRanges.hue.min, mRanges.hue.max, static_cast<int32_t>(mRanges.hue.step)});
+    return Void();
+}
+
+Return<void> PictureAdjustment::getSaturationRange(getSaturationRange_cb _hidl_cb) {
+    _hidl_cb({mRanges.saturation.min, mRanges.saturation.max, mRanges.saturation.step});
+    return Void();
+}
+
+Return<void> PictureAdjustment::getIntensityRange(getIntensityRange_cb _hidl_cb) {
+    _hidl_cb({mRanges.intensity.min, mRanges.intensity.max, mRanges.intensity.step});
+    return Void();
+}
+
+Return<void> PictureAdjustment::getContrastRange(getContrastRange_cb _hidl_cb) {
+    _hidl_cb({mRanges.contrast.min, mRanges.contrast.max, mRanges.contrast.step});
+    return Void();
+}
+
+Return<void> PictureAdjustment::getSaturationThresholdRange(
+        getSaturationThresholdRange_cb _hidl_cb) {
+    _hidl_cb({mRanges.saturationThreshold.min, mRanges.saturationThreshold.max,
+              mRanges.saturationThreshold.step});
+    return Void();
+}
+
+Return<void> PictureAdjustment::getPictureAdjustment(getPictureAdjustment_cb _hidl_cb) {
+    _hidl_cb(mCurrent);
+    return Void();
+}
+
+Return<void> PictureAdjustment::getDefaultPictureAdjustment(
+        getDefaultPictureAdjustment_cb _hidl_cb) {
+    _hidl_cb(mDefault);
+    return Void();
+}
+
+Return<bool> PictureAdjustment::setPictureAdjustment(const HSIC& hsic) {
+    if (hsic == mCurrent) {
+        return true;
+    }
+
+    HsicConfig config = {
+            .unused = 0,
+            .data = {
+                    .hue = static_cast<int32_t>(hsic.hue),
+                    .saturation = hsic.saturation,
+                    .intensity = hsic.intensity,
+                    .contrast = hsic.contrast,
+                    .saturationThreshold = hsic.saturationThreshold,
+            },
+    };
+    if (mController->setGlobalPaConfig(&config) != 0) {
+        LOG(ERROR) << "Failed to set picture adjustment";
+        return false;
+    }
+    mCurrent = hsic;
+    return true;
+}
+
+}  // namespace implementation
+}  // namespace V2_0
+}  // namespace livedisplay
+}  // namespace lineage
+}  // namespace vendor
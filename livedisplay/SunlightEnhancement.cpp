@@ -16,9 +16,7 @@
 
 #define LOG_TAG "SunlightEnhancementService"
 
-#include <android-base/file.h>
 #include <android-base/logging.h>
-#include <android-base/strings.h>
 
 #include "SunlightEnhancement.h"
 
@@ -31,21 +29,21 @@ namespace implementation {
 static constexpr const char* kHbmStatusPath =
         "/sys/devices/platform/soc/soc:qcom,dsi-display-primary/hbm";
 
+SunlightEnhancement::SunlightEnhancement() : mHbm(kHbmStatusPath) {}
+
 Return<bool> SunlightEnhancement::isEnabled() {
-    std::string buf;
-    if (!android::base::ReadFileToString(kHbmStatusPath, &buf)) {
-        LOG(ERROR) << "Failed to read " << kHbmStatusPath;
-        return false;
-    }
-    return std::stoi(android::base::Trim(buf)) == 1;
+    int result = 0;
+    return mHbm.read(&result) && result == 1;
 }
 
 Return<bool> SunlightEnhancement::setEnabled(bool enabled) {
-    if (!android::base::WriteStringToFile((enabled ? "1" : "0"), kHbmStatusPath)) {
-        LOG(ERROR) << "Failed to write " << kHbmStatusPath;
-        return false;
+    // Rewriting the current state still makes the panel redo the HBM
+    // transition, which shows up as a flash.
+    bool current = false;
+    if (mHbm.read(&current) && current == enabled) {
+        return true;
     }
-    return true;
+    return mHbm.write(enabled);
 }
 
 }  // namespace implementation
@@ -19,6 +19,7 @@
 
 #include <hidl/MQDescriptor.h>
 #include <hidl/Status.h>
+#include <sysfs/Node.h>
 #include <vendor/lineage/livedisplay/2.1/ISunlightEnhancement.h>
 
 namespace vendor {
@@ -33,9 +34,14 @@ using ::android::hardware::Void;
 
 class SunlightEnhancement : public ISunlightEnhancement {
   public:
+    SunlightEnhancement();
+
     // Methods from ::vendor::lineage::livedisplay::V2_1::ISunlightEnhancement follow.
     Return<bool> isEnabled() override;
     Return<bool> setEnabled(bool enabled) override;
+
+  private:
+    sysfs::Node mHbm;
 };
 
 }  // namespace implementation
@@ -21,6 +21,8 @@
 #include <hidl/HidlTransportSupport.h>
 
 #include "AntiFlicker.h"
+#include "DisplayModes.h"
+#include "PictureAdjustment.h"
 #include "SunlightEnhancement.h"
 #include "livedisplay/sdm/SDMController.h"
 
@@ -28,6 +30,10 @@ using android::OK;
 using android::sp;
 using android::status_t;
 
+using ::vendor::lineage::livedisplay::V2_0::IDisplayModes;
+using ::vendor::lineage::livedisplay::V2_0::IPictureAdjustment;
+using ::vendor::lineage::livedisplay::V2_0::implementation::DisplayModes;
+using ::vendor::lineage::livedisplay::V2_0::implementation::PictureAdjustment;
 using ::vendor::lineage::livedisplay::V2_0::sdm::SDMController;
 using ::vendor::lineage::livedisplay::V2_1::IAntiFlicker;
 using ::vendor::lineage::livedisplay::V2_1::ISunlightEnhancement;
@@ -38,6 +44,8 @@ int main() {
     status_t status = OK;
     std::shared_ptr<SDMController> controller = std::make_shared<SDMController>();
     sp<AntiFlicker> af = new AntiFlicker();
+    sp<DisplayModes> dm = new DisplayModes(controller);
+    sp<PictureAdjustment> pa = new PictureAdjustment(controller);
     sp<SunlightEnhancement> se = new SunlightEnhancement();
     android::hardware::configureRpcThreadpool(1, true /*callerWillJoin*/);
 
@@ -49,6 +57,26 @@ int main() {
         return 1;
     }
 
+    // DisplayModes service
+    if (dm->isSupported()) {
+        status = dm->registerAsService();
+        if (status != OK) {
+            LOG(ERROR) << "Could not register service for LiveDisplay HAL DisplayModes Iface ("
+                       << status << ")";
+            return 1;
+        }
+    }
+
+    // PictureAdjustment service
+    if (pa->isSupported()) {
+        status = pa->registerAsService();
+        if (status != OK) {
+            LOG(ERROR) << "Could not register service for LiveDisplay HAL PictureAdjustment Iface ("
+                       << status << ")";
+            return 1;
+        }
+    }
+
     // SunlightEnhancement service
     status = se->registerAsService();
     if (status != OK) {
@@ -0,0 +1,92 @@
+/*
+ * Copyright (C) 2021 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string>
+
+#include <android-base/file.h>
+#include <gtest/gtest.h>
+
+#include "../DisplayModes.h"
+#include "StubSDMController.h"
+
+namespace vendor {
+namespace lineage {
+namespace livedisplay {
+namespace V2_0 {
+namespace implementation {
+namespace {
+
+using sdm::testing::GetStubSdm;
+using sdm::testing::ResetStubSdm;
+
+std::string ShippedBlob() {
+    return android::base::GetExecutableDirectory() +
+           "/qdcm_calib_data_samsung_ea8076_fhd_cmd_dsi_panel.bin";
+}
+
+class DisplayModesTest : public ::testing::Test {
+  protected:
+    void SetUp() override { ResetStubSdm(); }
+
+    std::vector<DisplayMode> Modes(const sp<DisplayModes>& modes) {
+        std::vector<DisplayMode> result;
+        modes->getDisplayModes([&](const auto& list) {
+            for (const auto& mode : list) {
+                result.push_back(mode);
+            }
+        });
+        return result;
+    }
+};
+
+TEST_F(DisplayModesTest, ListsTheCalibratedModes) {
+    sp<DisplayModes> modes = new DisplayModes(std::make_shared<SDMController>(), ShippedBlob());
+    int before = GetStubSdm().calls;
+
+    std::vector<DisplayMode> list = Modes(modes);
+    ASSERT_EQ(list.size(), 4u);
+    EXPECT_EQ(list[0].id, 0);
+    EXPECT_EQ(std::string(list[0].name), "adaptive_srgb_V1_5_CR_0");
+    EXPECT_EQ(list[3].id, 3);
+    EXPECT_EQ(std::string(list[3].name), "smart_MC");
+    EXPECT_EQ(GetStubSdm().calls, before);
+}
+
+TEST_F(DisplayModesTest, FallsBackToSdm) {
+    sp<DisplayModes> modes = new DisplayModes(std::make_shared<SDMController>(), "/nonexistent");
+
+    std::vector<DisplayMode> list = Modes(modes);
+    ASSERT_EQ(list.size(), GetStubSdm().modes.size());
+    EXPECT_EQ(std::string(list[1].name), "Standard");
+}
+
+TEST_F(DisplayModesTest, OnlySwitchesToCalibratedModes) {
+    sp<DisplayModes> modes = new DisplayModes(std::make_shared<SDMController>(), ShippedBlob());
+
+    EXPECT_FALSE(modes->setDisplayMode(4, false));
+    EXPECT_TRUE(modes->setDisplayMode(2, true));
+    EXPECT_EQ(GetStubSdm().activeId, 2);
+    EXPECT_EQ(GetStubSdm().defaultId, 2);
+    modes->getCurrentDisplayMode(
+            [](const DisplayMode& mode) { EXPECT_EQ(std::string(mode.name), "native"); });
+}
+
+}  // namespace
+}  // namespace implementation
+}  // namespace V2_0
+}  // namespace livedisplay
+}  // namespace lineage
+}  // namespace vendor
@@ -0,0 +1,146 @@
+/*
+ * Copyright (C) 2021 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// LiveDisplay settings and the color mode tile query the current mode and
+// HSIC whenever they are shown. This compares answering from the cache with
+// going to SDM every time, against a stub SDM controller with a modelled
+// round trip to the display color service.
+
+#include <benchmark/benchmark.h>
+
+#include "../DisplayModes.h"
+#include "../PictureAdjustment.h"
+#include "StubSDMController.h"
+
+namespace vendor {
+namespace lineage {
+namespace livedisplay {
+namespace V2_0 {
+namespace implementation {
+namespace {
+
+using sdm::testing::GetStubSdm;
+using sdm::testing::ResetStubSdm;
+
+constexpr std::chrono::microseconds kSdmLatency{20};
+
+std::shared_ptr<SDMController> StubController() {
+    ResetStubSdm();
+    GetStubSdm().latency = kSdmLatency;
+    return std::make_shared<SDMController>();
+}
+
+void ReportSdmCalls(benchmark::State& state, int before) {
+    state.counters["sdm_calls"] = benchmark::Counter(GetStubSdm().calls - before,
+                                                     benchmark::Counter::kAvgIterations);
+}
+
+void BM_GetCurrentDisplayMode(benchmark::State& state) {
+    sp<DisplayModes> modes = new DisplayModes(StubController());
+    int before = GetStubSdm().calls;
+
+    for (auto _ : state) {
+        modes->getCurrentDisplayMode([](const DisplayMode& mode) {
+            benchmark::DoNotOptimize(mode.id);
+        });
+    }
+    ReportSdmCalls(state, before);
+}
+BENCHMARK(BM_GetCurrentDisplayMode);
+
+// What serving the same query straight from SDM costs.
+void BM_GetCurrentDisplayModeUncached(benchmark::State& state) {
+    std::shared_ptr<SDMController> controller = StubController();
+    int before = GetStubSdm().calls;
+
+    for (auto _ : state) {
+        int32_t count = 0;
+        controller->getNumDisplayModes(&count);
+        std::vector<SdmDispMode> sdmModes(count);
+        controller->getDisplayModes(sdmModes.data(), count);
+        int32_t id = -1;
+        controller->getActiveDisplayMode(&id);
+        for (const auto& mode : sdmModes) {
+            if (mode.id == id) {
+                DisplayMode current = {mode.id, mode.name};
+                benchmark::DoNotOptimize(current.id);
+            }
+        }
+    }
+    ReportSdmCalls(state, before);
+}
+BENCHMARK(BM_GetCurrentDisplayModeUncached);
+
+void BM_SetDisplayModeUnchanged(benchmark::State& state) {
+    sp<DisplayModes> modes = new DisplayModes(StubController());
+    int before = GetStubSdm().calls;
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(static_cast<bool>(modes->setDisplayMode(0, true)));
+    }
+    ReportSdmCalls(state, before);
+}
+BENCHMARK(BM_SetDisplayModeUnchanged);
+
+void BM_GetPictureAdjustment(benchmark::State& state) {
+    sp<PictureAdjustment> pa = new PictureAdjustment(StubController());
+    int before = GetStubSdm().calls;
+
+    for (auto _ : state) {
+        pa->getHueRange([](const Range& range) { benchmark::DoNotOptimize(range.max); });
+        pa->getPictureAdjustment([](const HSIC& hsic) { benchmark::DoNotOptimize(hsic.hue); });
+    }
+    ReportSdmCalls(state, before);
+}
+BENCHMARK(BM_GetPictureAdjustment);
+
+void BM_GetPictureAdjustmentUncached(benchmark::State& state) {
+    std::shared_ptr<SDMController> controller = StubController();
+    int before = GetStubSdm().calls;
+
+    for (auto _ : state) {
+        HsicRanges ranges{};
+        HsicConfig config{};
+        controller->getGlobalPaRange(&ranges);
+        controller->getGlobalPaConfig(&config);
+        benchmark::DoNotOptimize(ranges.hue.max);
+        benchmark::DoNotOptimize(config.data.hue);
+    }
+    ReportSdmCalls(state, before);
+}
+BENCHMARK(BM_GetPictureAdjustmentUncached);
+
+void BM_SetPictureAdjustmentUnchanged(benchmark::State& state) {
+    sp<PictureAdjustment> pa = new PictureAdjustment(StubController());
+    HSIC hsic{};
+    pa->getPictureAdjustment([&](const HSIC& current) { hsic = current; });
+    int before = GetStubSdm().calls;
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(static_cast<bool>(pa->setPictureAdjustment(hsic)));
+    }
+    ReportSdmCalls(state, before);
+}
+BENCHMARK(BM_SetPictureAdjustmentUnchanged);
+
+}  // namespace
+}  // namespace implementation
+}  // namespace V2_0
+}  // namespace livedisplay
+}  // namespace lineage
+}  // namespace vendor
+
+BENCHMARK_MAIN();
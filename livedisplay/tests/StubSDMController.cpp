@@ -0,0 +1,140 @@
+/*
+ * Copyright (C) 2021 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "StubSDMController.h"
+
+#include <string.h>
+
+namespace vendor {
+namespace lineage {
+namespace livedisplay {
+namespace V2_0 {
+namespace sdm {
+namespace testing {
+
+static StubSdm sStub;
+
+StubSdm& GetStubSdm() {
+    return sStub;
+}
+
+void ResetStubSdm() {
+    sStub = {};
+    sStub.modes = {"Vivid", "Standard", "Warm", "Cool", "sRGB", "DCI-P3"};
+    sStub.activeId = sStub.defaultId = 0;
+    sStub.ranges = {
+            .unused = 0,
+            .hue = {.max = 180, .min = -180, .step = 1},
+            .saturation = {.max = 127.0f, .min = -128.0f, .step = 1.0f},
+            .intensity = {.max = 127.0f, .min = -128.0f, .step = 1.0f},
+            .contrast = {.max = 127.0f, .min = -128.0f, .step = 1.0f},
+            .saturationThreshold = {.max = 31.0f, .min = 0.0f, .step = 1.0f},
+    };
+    sStub.config = {};
+}
+
+static void Call() {
+    sStub.calls++;
+    auto until = std::chrono::steady_clock::now() + sStub.latency;
+    while (std::chrono::steady_clock::now() < until) {
+    }
+}
+
+static bool ValidMode(int32_t id) {
+    return id >= 0 && id < static_cast<int32_t>(sStub.modes.size());
+}
+
+}  // namespace testing
+
+using testing::Call;
+using testing::sStub;
+using testing::ValidMode;
+
+SDMController::SDMController() {}
+
+SDMController::~SDMController() = default;
+
+int32_t SDMController::getNumDisplayModes(int32_t* mode_cnt) {
+    Call();
+    *mode_cnt = static_cast<int32_t>(sStub.modes.size());
+    return 0;
+}
+
+int32_t SDMController::getDisplayModes(SdmDispMode* modes, int32_t mode_cnt) {
+    Call();
+    if (mode_cnt != static_cast<int32_t>(sStub.modes.size())) {
+        return -1;
+    }
+    for (int32_t i = 0; i < mode_cnt; i++) {
+        modes[i].id = i;
+        strncpy(modes[i].name, sStub.modes[i].c_str(), modes[i].len - 1);
+    }
+    return 0;
+}
+
+int32_t SDMController::getActiveDisplayMode(int32_t* mode_id) {
+    Call();
+    *mode_id = sStub.activeId;
+    return 0;
+}
+
+int32_t SDMController::setActiveDisplayMode(int32_t mode_id) {
+    Call();
+    if (!ValidMode(mode_id)) {
+        return -1;
+    }
+    sStub.activeId = mode_id;
+    return 0;
+}
+
+int32_t SDMController::setDefaultDisplayMode(int32_t mode_id) {
+    Call();
+    if (!ValidMode(mode_id)) {
+        return -1;
+    }
+    sStub.defaultId = mode_id;
+    return 0;
+}
+
+int32_t SDMController::getDefaultDisplayMode(int32_t* mode_id) {
+    Call();
+    *mode_id = sStub.defaultId;
+    return 0;
+}
+
+int32_t SDMController::getGlobalPaRange(HsicRanges* range) {
+    Call();
+    *range = sStub.ranges;
+    return 0;
+}
+
+int32_t SDMController::getGlobalPaConfig(HsicConfig* cfg) {
+    Call();
+    *cfg = sStub.config;
+    return 0;
+}
+
+int32_t SDMController::setGlobalPaConfig(HsicConfig* cfg) {
+    Call();
+    sStub.config = *cfg;
+    return 0;
+}
+
+}  // namespace sdm
+}  // namespace V2_0
+}  // namespace livedisplay
+}  // namespace lineage
+}  // namespace vendor
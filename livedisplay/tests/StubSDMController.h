@@ -0,0 +1,59 @@
+/*
+ * Copyright (C) 2021 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef VENDOR_LINEAGE_LIVEDISPLAY_V2_0_STUBSDMCONTROLLER_H
+#define VENDOR_LINEAGE_LIVEDISPLAY_V2_0_STUBSDMCONTROLLER_H
+
+#include <livedisplay/sdm/SDMController.h>
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+namespace vendor {
+namespace lineage {
+namespace livedisplay {
+namespace V2_0 {
+namespace sdm {
+namespace testing {
+
+// Linking StubSDMController.cpp instead of the sdm-utils sources turns every
+// SDMController into a view of this state, so nothing is dlopen'ed and no
+// display service is needed.
+struct StubSdm {
+    std::vector<std::string> modes;
+    int32_t activeId = -1;
+    int32_t defaultId = -1;
+    HsicRanges ranges{};
+    HsicConfig config{};
+    // Busy-waited on every call to stand in for the round trip to the
+    // display color service behind the disp APIs.
+    std::chrono::nanoseconds latency{0};
+    int calls = 0;
+};
+
+// Resets the stub to a panel with a few modes and the usual HSIC ranges.
+void ResetStubSdm();
+StubSdm& GetStubSdm();
+
+}  // namespace testing
+}  // namespace sdm
+}  // namespace V2_0
+}  // namespace livedisplay
+}  // namespace lineage
+}  // namespace vendor
+
+#endif  // VENDOR_LINEAGE_LIVEDISPLAY_V2_0_STUBSDMCONTROLLER_H
@@ -0,0 +1,94 @@
+/*
+ * Copyright (C) 2021 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+#include <sysfs/testing/FakeSysfs.h>
+
+#include "../AntiFlicker.h"
+#include "../SunlightEnhancement.h"
+
+namespace vendor {
+namespace lineage {
+namespace livedisplay {
+namespace V2_1 {
+namespace implementation {
+namespace {
+
+using sysfs::testing::FakeSysfs;
+using sysfs::testing::IoCounts;
+using Writes = std::vector<std::string>;
+
+constexpr const char* kDcDimmingPath =
+        "/sys/devices/platform/soc/soc:qcom,dsi-display-primary/msm_fb_ea_enable";
+constexpr const char* kHbmPath = "/sys/devices/platform/soc/soc:qcom,dsi-display-primary/hbm";
+
+class SysfsFeaturesTest : public ::testing::Test {
+  protected:
+    void SetUp() override {
+        fake_.add(kDcDimmingPath, "0\n");
+        fake_.add(kHbmPath, "0\n");
+    }
+
+    FakeSysfs fake_;
+};
+
+TEST_F(SysfsFeaturesTest, AntiFlicker) {
+    sp<AntiFlicker> antiFlicker = new AntiFlicker();
+    EXPECT_FALSE(antiFlicker->isEnabled());
+    EXPECT_TRUE(antiFlicker->setEnabled(true));
+    EXPECT_TRUE(antiFlicker->isEnabled());
+    EXPECT_TRUE(antiFlicker->setEnabled(false));
+    EXPECT_FALSE(antiFlicker->isEnabled());
+
+    EXPECT_EQ(fake_.writes(kDcDimmingPath), (Writes{"1", "0"}));
+    EXPECT_EQ(fake_.counts(kDcDimmingPath), (IoCounts{.opens = 1, .reads = 3, .writes = 2}));
+}
+
+TEST_F(SysfsFeaturesTest, SunlightEnhancementFollowsTheKernel) {
+    sp<SunlightEnhancement> sunlight = new SunlightEnhancement();
+    EXPECT_FALSE(sunlight->isEnabled());
+    // The panel driver drops HBM on its own, e.g. when the screen turns off.
+    fake_.set(kHbmPath, "1\n");
+    EXPECT_TRUE(sunlight->isEnabled());
+}
+
+TEST_F(SysfsFeaturesTest, SunlightEnhancementSkipsRedundantWrites) {
+    sp<SunlightEnhancement> sunlight = new SunlightEnhancement();
+    EXPECT_TRUE(sunlight->setEnabled(true));
+    EXPECT_TRUE(sunlight->setEnabled(true));
+    EXPECT_TRUE(sunlight->setEnabled(false));
+    EXPECT_TRUE(sunlight->setEnabled(false));
+
+    EXPECT_EQ(fake_.writes(kHbmPath), (Writes{"1", "0"}));
+    EXPECT_EQ(fake_.counts(kHbmPath), (IoCounts{.opens = 1, .reads = 4, .writes = 2}));
+}
+
+TEST(SysfsFeaturesMissingTest, MissingNodesFail) {
+    FakeSysfs fake;
+    sp<AntiFlicker> antiFlicker = new AntiFlicker();
+    sp<SunlightEnhancement> sunlight = new SunlightEnhancement();
+    EXPECT_FALSE(antiFlicker->isEnabled());
+    EXPECT_FALSE(antiFlicker->setEnabled(true));
+    EXPECT_FALSE(sunlight->isEnabled());
+    EXPECT_FALSE(sunlight->setEnabled(true));
+}
+
+}  // namespace
+}  // namespace implementation
+}  // namespace V2_1
+}  // namespace livedisplay
+}  // namespace lineage
+}  // namespace vendor
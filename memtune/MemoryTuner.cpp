@@ -0,0 +1,250 @@
+/*
+ * Copyright (C) 2021 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "MemoryTuner.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <algorithm>
+
+#include <android-base/parseint.h>
+#include <android-base/strings.h>
+
+namespace memtune {
+
+namespace {
+
+// Stall thresholds in percent, checked from the most severe level down.
+struct Threshold {
+    Level level;
+    float some;
+    float full;
+};
+
+constexpr Threshold kThresholds[] = {
+        {Level::CRITICAL, 40.0f, 10.0f},
+        {Level::MEDIUM, 20.0f, 3.0f},
+        {Level::LOW, 5.0f, 1.0f},
+};
+
+// Indexed by Level. The 4.14 kernel caps swappiness at 100.
+constexpr Tunables kTunables[] = {
+        {60, WritebackPolicy::IDLE},
+        {80, WritebackPolicy::IDLE},
+        {100, WritebackPolicy::HUGE},
+        {100, WritebackPolicy::OFF},
+};
+
+bool ParsePsiLine(const char* line, const char* prefix, float* avg10, uint64_t* total) {
+    size_t prefix_len = strlen(prefix);
+    if (strncmp(line, prefix, prefix_len) != 0) {
+        return false;
+    }
+
+    float avg60, avg300;
+    return sscanf(line + prefix_len, " avg10=%f avg60=%f avg300=%f total=%" SCNu64, avg10,
+                  &avg60, &avg300, total) == 4;
+}
+
+}  // anonymous namespace
+
+const char* LevelToString(Level level) {
+    switch (level) {
+        case Level::NONE:
+            return "none";
+        case Level::LOW:
+            return "low";
+        case Level::MEDIUM:
+            return "medium";
+        case Level::CRITICAL:
+            return "critical";
+    }
+    return "unknown";
+}
+
+const char* WritebackPolicyToString(WritebackPolicy policy) {
+    switch (policy) {
+        case WritebackPolicy::OFF:
+            return "off";
+        case WritebackPolicy::HUGE:
+            return "huge";
+        case WritebackPolicy::IDLE:
+            return "idle";
+    }
+    return "unknown";
+}
+
+std::vector<std::string> ParseAlgorithms(const std::string& buf) {
+    std::vector<std::string> algorithms;
+    // The active one is bracketed, e.g. "lzo lzo-rle [lz4] zstd".
+    for (auto& name : android::base::Split(android::base::Trim(buf), " ")) {
+        if (name.size() > 2 && name.front() == '[' && name.back() == ']') {
+            name = name.substr(1, name.size() - 2);
+        }
+        if (!name.empty()) {
+            algorithms.push_back(name);
+        }
+    }
+    return algorithms;
+}
+
+bool ParseMmStat(const std::string& buf, uint64_t* origBytes, uint64_t* comprBytes) {
+    return sscanf(buf.c_str(), "%" SCNu64 " %" SCNu64, origBytes, comprBytes) == 2;
+}
+
+std::string ChooseAlgorithm(const std::vector<CompressionResult>& results) {
+    auto throughput = [](const CompressionResult& r) {
+        return static_cast<double>(r.origBytes) / std::max<int64_t>(r.writeUs + r.readUs, 1);
+    };
+
+    double fastest = 0;
+    for (const auto& r : results) {
+        fastest = std::max(fastest, throughput(r));
+    }
+
+    const CompressionResult* best = nullptr;
+    for (const auto& r : results) {
+        if (throughput(r) < fastest / 2) {
+            continue;
+        }
+        if (best == nullptr || r.comprBytes * best->origBytes < best->comprBytes * r.origBytes) {
+            best = &r;
+        }
+    }
+    return best ? best->algorithm : "";
+}
+
+bool ParsePsi(const char* buf, size_t len, PsiSample* out) {
+    bool have_some = false, have_full = false;
+    const char* end = buf + len;
+
+    for (const char* line = buf; line < end;) {
+        const char* eol = static_cast<const char*>(memchr(line, '\n', end - line));
+        if (!eol) eol = end;
+
+        char tmp[128];
+        size_t line_len = std::min(static_cast<size_t>(eol - line), sizeof(tmp) - 1);
+        memcpy(tmp, line, line_len);
+        tmp[line_len] = '\0';
+
+        if (ParsePsiLine(tmp, "some", &out->someAvg10, &out->someTotalUs)) {
+            have_some = true;
+        } else if (ParsePsiLine(tmp, "full", &out->fullAvg10, &out->fullTotalUs)) {
+            have_full = true;
+        }
+
+        line = eol + 1;
+    }
+
+    // Kernels without full memory stall accounting only report "some".
+    if (have_some && !have_full) {
+        out->fullAvg10 = 0;
+        out->fullTotalUs = 0;
+    }
+
+    return have_some;
+}
+
+bool ParseTrace(const std::string& trace, std::vector<TimedSample>* out) {
+    out->clear();
+    for (const auto& record : android::base::Split(trace, "@")) {
+        size_t eol = record.find('\n');
+        if (eol == std::string::npos) {
+            // Only the text before the first sample has no line break.
+            if (!android::base::Trim(record).empty()) {
+                return false;
+            }
+            continue;
+        }
+
+        TimedSample s;
+        if (!android::base::ParseInt(record.substr(0, eol), &s.ms) ||
+            !ParsePsi(record.data() + eol + 1, record.size() - eol - 1, &s.sample)) {
+            return false;
+        }
+        out->push_back(s);
+    }
+    return true;
+}
+
+MemoryTuner::MemoryTuner()
+    : level_(Level::NONE),
+      have_last_(false),
+      last_{},
+      last_ms_(0),
+      below_since_ms_(-1),
+      some_ratio_(0),
+      full_ratio_(0) {}
+
+const Tunables& MemoryTuner::tunables() const {
+    return kTunables[static_cast<int>(level_)];
+}
+
+Level MemoryTuner::classify(float some, float full) const {
+    for (const auto& threshold : kThresholds) {
+        if (some >= threshold.some || full >= threshold.full) {
+            return threshold.level;
+        }
+    }
+    return Level::NONE;
+}
+
+bool MemoryTuner::update(const PsiSample& sample, int64_t nowMs) {
+    // avg10 lags behind a sudden stall by several seconds, so also look at
+    // how much the totals moved since the previous sample.
+    float some = sample.someAvg10;
+    float full = sample.fullAvg10;
+    if (have_last_ && nowMs > last_ms_ && sample.someTotalUs >= last_.someTotalUs &&
+        sample.fullTotalUs >= last_.fullTotalUs) {
+        float window_us = (nowMs - last_ms_) * 1000.0f;
+        some = std::max(some, (sample.someTotalUs - last_.someTotalUs) * 100.0f / window_us);
+        full = std::max(full, (sample.fullTotalUs - last_.fullTotalUs) * 100.0f / window_us);
+    }
+    some_ratio_ = some;
+    full_ratio_ = full;
+    last_ = sample;
+    last_ms_ = nowMs;
+    have_last_ = true;
+
+    Level target = classify(some, full);
+    if (target > level_) {
+        level_ = target;
+        below_since_ms_ = -1;
+        return true;
+    }
+
+    if (target == level_) {
+        below_since_ms_ = -1;
+        return false;
+    }
+
+    if (below_since_ms_ < 0) {
+        below_since_ms_ = nowMs;
+        return false;
+    }
+
+    if (nowMs - below_since_ms_ < kDecayHoldMs) {
+        return false;
+    }
+
+    level_ = static_cast<Level>(static_cast<int>(level_) - 1);
+    below_since_ms_ = level_ > target ? nowMs : -1;
+    return true;
+}
+
+}  // namespace memtune
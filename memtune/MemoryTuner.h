@@ -0,0 +1,119 @@
+/*
+ * Copyright (C) 2021 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+namespace memtune {
+
+// One snapshot of /proc/pressure/memory.
+struct PsiSample {
+    float someAvg10;
+    float fullAvg10;
+    uint64_t someTotalUs;
+    uint64_t fullTotalUs;
+};
+
+enum class Level { NONE = 0, LOW, MEDIUM, CRITICAL };
+
+enum class WritebackPolicy {
+    // Leave zram alone, writeback I/O would only add to the stall.
+    OFF,
+    // Only write back incompressible pages.
+    HUGE,
+    // Write back pages which have not been touched since the last pass.
+    IDLE,
+};
+
+// watermark_scale_factor is left at the minimum post_boot sets, the headroom
+// comes from extra_free_kbytes.
+struct Tunables {
+    int swappiness;
+    WritebackPolicy writeback;
+};
+
+const char* LevelToString(Level level);
+const char* WritebackPolicyToString(WritebackPolicy policy);
+
+// Parse the contents of /proc/pressure/memory, returns false on malformed input.
+bool ParsePsi(const char* buf, size_t len, PsiSample* out);
+
+// A sample of a recorded trace, taken at the given monotonic time.
+struct TimedSample {
+    int64_t ms;
+    PsiSample sample;
+};
+
+// Parse a recorded trace, one "@<monotonic ms>" line followed by the contents
+// of /proc/pressure/memory per sample. Returns false on malformed input.
+bool ParseTrace(const std::string& trace, std::vector<TimedSample>* out);
+
+// The compression algorithms the zram driver offers, from comp_algorithm.
+std::vector<std::string> ParseAlgorithms(const std::string& buf);
+
+// Original and compressed size from /sys/block/zram0/mm_stat.
+bool ParseMmStat(const std::string& buf, uint64_t* origBytes, uint64_t* comprBytes);
+
+// One algorithm's run over the benchmark corpus.
+struct CompressionResult {
+    std::string algorithm;
+    uint64_t origBytes;
+    uint64_t comprBytes;
+    int64_t writeUs;
+    int64_t readUs;
+};
+
+// Picks the algorithm with the best ratio among those reaching at least half
+// the throughput of the fastest one. Returns an empty string if nothing ran.
+std::string ChooseAlgorithm(const std::vector<CompressionResult>& results);
+
+// Maps memory stall samples to a pressure level and the vm tunables for it.
+// Pressure rises immediately, but only decays one level at a time after it
+// stayed below the current level for kDecayHoldMs.
+class MemoryTuner {
+  public:
+    static constexpr int64_t kDecayHoldMs = 10000;
+
+    MemoryTuner();
+
+    // Feed a new sample taken at nowMs, returns true if the level changed.
+    bool update(const PsiSample& sample, int64_t nowMs);
+
+    Level level() const { return level_; }
+    const Tunables& tunables() const;
+
+    // Stall ratios of the last update, in percent of wall time.
+    float someRatio() const { return some_ratio_; }
+    float fullRatio() const { return full_ratio_; }
+
+  private:
+    Level classify(float some, float full) const;
+
+    Level level_;
+    bool have_last_;
+    PsiSample last_;
+    int64_t last_ms_;
+    int64_t below_since_ms_;
+    float some_ratio_;
+    float full_ratio_;
+};
+
+}  // namespace memtune
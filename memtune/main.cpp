@@ -0,0 +1,440 @@
+/*
+ * Copyright (C) 2021 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "memtuned"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <stdlib.h>
+#include <sys/epoll.h>
+#include <sys/utsname.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <android-base/file.h>
+#include <android-base/logging.h>
+#include <android-base/macros.h>
+#include <android-base/properties.h>
+#include <android-base/strings.h>
+#include <android-base/unique_fd.h>
+#include <sysfs/Node.h>
+
+#include "MemoryTuner.h"
+
+using ::android::base::ReadFileToString;
+using ::android::base::SetProperty;
+using ::android::base::unique_fd;
+using ::android::base::WriteStringToFile;
+
+using ::memtune::ChooseAlgorithm;
+using ::memtune::CompressionResult;
+using ::memtune::LevelToString;
+using ::memtune::MemoryTuner;
+using ::memtune::ParseAlgorithms;
+using ::memtune::ParseMmStat;
+using ::memtune::ParsePsi;
+using ::memtune::ParseTrace;
+using ::memtune::PsiSample;
+using ::memtune::TimedSample;
+using ::memtune::Tunables;
+using ::memtune::WritebackPolicy;
+using ::memtune::WritebackPolicyToString;
+
+namespace {
+
+constexpr const char* kPsiMemoryPath = "/proc/pressure/memory";
+constexpr const char* kSwappinessPath = "/proc/sys/vm/swappiness";
+constexpr const char* kZramAlgorithmPath = "/sys/block/zram0/comp_algorithm";
+constexpr const char* kZramBackingDevPath = "/sys/block/zram0/backing_dev";
+constexpr const char* kZramDevicePath = "/dev/block/zram0";
+constexpr const char* kZramDiskSizePath = "/sys/block/zram0/disksize";
+constexpr const char* kZramIdlePath = "/sys/block/zram0/idle";
+constexpr const char* kZramMmStatPath = "/sys/block/zram0/mm_stat";
+constexpr const char* kZramResetPath = "/sys/block/zram0/reset";
+constexpr const char* kZramWritebackPath = "/sys/block/zram0/writeback";
+
+// "<kernel release> <algorithm>", the benchmark only reruns on a new kernel.
+constexpr const char* kAlgorithmCachePath = "/data/vendor/memtune/zram_algorithm";
+
+constexpr size_t kBenchmarkBytes = 8 << 20;
+
+// Stall time in us within a 1s window which wakes us up.
+constexpr const char* kPsiTriggers[] = {
+        "some 70000 1000000",
+        "full 30000 1000000",
+};
+
+// While pressure is elevated, resample at this rate so the level can decay.
+constexpr int kElevatedPollMs = 1000;
+
+// Minimum time between two zram writeback passes.
+constexpr int64_t kWritebackIntervalMs = 30 * 60 * 1000;
+
+int64_t NowMs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000LL + ts.tv_nsec / 1000000;
+}
+
+int64_t NowUs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000LL + ts.tv_nsec / 1000;
+}
+
+std::string Describe(const MemoryTuner& tuner) {
+    const Tunables& t = tuner.tunables();
+    std::ostringstream out;
+    out << "level=" << LevelToString(tuner.level()) << " some=" << tuner.someRatio()
+        << " full=" << tuner.fullRatio() << " swappiness=" << t.swappiness
+        << " writeback=" << WritebackPolicyToString(t.writeback);
+    return out.str();
+}
+
+class Daemon {
+  public:
+    bool init();
+    void run();
+
+  private:
+    bool readSample(PsiSample* sample);
+    void apply();
+    void maybeWriteback(int64_t nowMs);
+    void publish();
+
+    sysfs::Node psi_;
+    sysfs::Node swappiness_;
+    sysfs::Node zram_writeback_;
+    sysfs::Node zram_idle_;
+    sysfs::Node zram_mm_stat_;
+    unique_fd epoll_fd_;
+    std::vector<unique_fd> trigger_fds_;
+    MemoryTuner tuner_;
+    bool have_backing_dev_ = false;
+    int64_t last_writeback_ms_ = 0;
+};
+
+bool Daemon::init() {
+    if (!psi_.open(kPsiMemoryPath, O_RDONLY)) {
+        return false;
+    }
+    swappiness_.open(kSwappinessPath, O_WRONLY);
+
+    epoll_fd_.reset(epoll_create1(EPOLL_CLOEXEC));
+    if (epoll_fd_ < 0) {
+        PLOG(ERROR) << "Failed to create epoll fd";
+        return false;
+    }
+
+    // Each PSI trigger needs its own fd.
+    for (const char* trigger : kPsiTriggers) {
+        unique_fd fd(open((sysfs::Root() + kPsiMemoryPath).c_str(),
+                          O_RDWR | O_NONBLOCK | O_CLOEXEC));
+        if (fd < 0 || write(fd, trigger, strlen(trigger) + 1) < 0) {
+            PLOG(ERROR) << "Failed to register PSI trigger \"" << trigger << "\"";
+            return false;
+        }
+
+        struct epoll_event ev = {};
+        ev.events = EPOLLPRI;
+        if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &ev) < 0) {
+            PLOG(ERROR) << "Failed to add PSI trigger to epoll";
+            return false;
+        }
+        trigger_fds_.push_back(std::move(fd));
+    }
+
+    std::string backing_dev;
+    if (sysfs::ReadValue(kZramBackingDevPath, &backing_dev)) {
+        have_backing_dev_ = !backing_dev.empty() && backing_dev != "none";
+    }
+    if (have_backing_dev_) {
+        zram_writeback_.open(kZramWritebackPath, O_WRONLY);
+        zram_idle_.open(kZramIdlePath, O_WRONLY);
+    }
+    zram_mm_stat_.open(kZramMmStatPath, O_RDONLY);
+
+    last_writeback_ms_ = NowMs();
+    apply();
+    publish();
+    LOG(INFO) << "event=start backing_dev=" << (have_backing_dev_ ? backing_dev : "none") << " "
+              << Describe(tuner_);
+    return true;
+}
+
+bool Daemon::readSample(PsiSample* sample) {
+    std::string buf;
+    if (!psi_.read(&buf)) {
+        return false;
+    }
+
+    if (!ParsePsi(buf.data(), buf.size(), sample)) {
+        LOG(ERROR) << "Malformed " << kPsiMemoryPath;
+        return false;
+    }
+
+    return true;
+}
+
+void Daemon::apply() {
+    const Tunables& t = tuner_.tunables();
+    swappiness_.write(t.swappiness);
+}
+
+void Daemon::maybeWriteback(int64_t nowMs) {
+    WritebackPolicy policy = tuner_.tunables().writeback;
+    if (!have_backing_dev_ || policy == WritebackPolicy::OFF ||
+        nowMs - last_writeback_ms_ < kWritebackIntervalMs) {
+        return;
+    }
+    last_writeback_ms_ = nowMs;
+
+    if (policy == WritebackPolicy::IDLE) {
+        // Write back what stayed idle since the previous pass, then mark
+        // everything idle again for the next one.
+        zram_writeback_.write("idle");
+        zram_idle_.write("all");
+    } else {
+        zram_writeback_.write("huge");
+    }
+
+    LOG(INFO) << "event=writeback mode=" << WritebackPolicyToString(policy)
+              << " duration_ms=" << NowMs() - nowMs;
+    publish();
+}
+
+// Exports the current state for dumpstate and the performance dashboards.
+void Daemon::publish() {
+    SetProperty("vendor.memtune.level", LevelToString(tuner_.level()));
+    SetProperty("vendor.memtune.stall.some", std::to_string(static_cast<int>(tuner_.someRatio())));
+    SetProperty("vendor.memtune.stall.full", std::to_string(static_cast<int>(tuner_.fullRatio())));
+
+    std::string buf;
+    uint64_t orig, compr;
+    if (zram_mm_stat_.valid() && zram_mm_stat_.read(&buf) && ParseMmStat(buf, &orig, &compr) &&
+        compr > 0) {
+        // In percent, 300 means zram holds three times what it uses.
+        SetProperty("vendor.memtune.zram.ratio", std::to_string(orig * 100 / compr));
+    }
+}
+
+void Daemon::run() {
+    struct epoll_event events[arraysize(kPsiTriggers)];
+
+    while (true) {
+        int timeout = tuner_.level() == memtune::Level::NONE ? -1 : kElevatedPollMs;
+        int nevents = TEMP_FAILURE_RETRY(
+                epoll_wait(epoll_fd_, events, arraysize(kPsiTriggers), timeout));
+        if (nevents < 0) {
+            PLOG(ERROR) << "epoll_wait failed";
+            continue;
+        }
+
+        PsiSample sample;
+        if (!readSample(&sample)) {
+            continue;
+        }
+
+        int64_t now = NowMs();
+        if (tuner_.update(sample, now)) {
+            apply();
+            publish();
+            LOG(INFO) << "event=level_change " << Describe(tuner_);
+        }
+        maybeWriteback(now);
+    }
+}
+
+// Anonymous memory is mostly small integers, pointers into a handful of
+// regions and bits of text, fill the corpus with a deterministic mix of those.
+void FillCorpus(uint8_t* buf, size_t size) {
+    static const char kText[] =
+            "android.app.ActivityThread$H.handleMessage com.android.internal.os.ZygoteInit";
+    static_assert(sizeof(kText) > 64);
+
+    uint32_t seed = 1;
+    auto next = [&seed] {
+        seed = seed * 1103515245 + 12345;
+        return seed >> 16;
+    };
+
+    for (size_t off = 0; off < size; off += sizeof(uint64_t)) {
+        uint64_t word = 0;
+        switch (next() % 4) {
+            case 0:
+                word = next() % 256;
+                break;
+            case 1:
+                word = 0x7f00000000ULL | ((next() % 4096) << 4);
+                break;
+            case 2:
+                memcpy(&word, kText + (off / 8 % 8) * 8, sizeof(word));
+                break;
+        }
+        memcpy(buf + off, &word, sizeof(word));
+    }
+}
+
+// Runs the corpus through zram with the given algorithm, the device has to
+// be unused. Measures the kernel's own compressor, block layer included.
+bool Benchmark(const std::string& algorithm, const uint8_t* corpus, uint8_t* scratch,
+               CompressionResult* out) {
+    if (!sysfs::WriteValue(kZramResetPath, "1") ||
+        !sysfs::WriteValue(kZramAlgorithmPath, algorithm) ||
+        !sysfs::WriteValue(kZramDiskSizePath, kBenchmarkBytes)) {
+        return false;
+    }
+
+    unique_fd fd(TEMP_FAILURE_RETRY(
+            open((sysfs::Root() + kZramDevicePath).c_str(), O_RDWR | O_DIRECT | O_CLOEXEC)));
+    if (fd < 0) {
+        PLOG(ERROR) << "Failed to open " << kZramDevicePath;
+        return false;
+    }
+
+    int64_t start = NowUs();
+    if (TEMP_FAILURE_RETRY(pwrite(fd, corpus, kBenchmarkBytes, 0)) !=
+        static_cast<ssize_t>(kBenchmarkBytes)) {
+        PLOG(ERROR) << "Failed to fill zram with " << algorithm;
+        return false;
+    }
+    int64_t written = NowUs();
+    if (TEMP_FAILURE_RETRY(pread(fd, scratch, kBenchmarkBytes, 0)) !=
+        static_cast<ssize_t>(kBenchmarkBytes)) {
+        PLOG(ERROR) << "Failed to read zram back with " << algorithm;
+        return false;
+    }
+    int64_t read = NowUs();
+
+    std::string mmStat;
+    out->algorithm = algorithm;
+    out->writeUs = written - start;
+    out->readUs = read - written;
+    return sysfs::ReadValue(kZramMmStatPath, &mmStat) &&
+           ParseMmStat(mmStat, &out->origBytes, &out->comprBytes);
+}
+
+// Picks the zram compression algorithm, benchmarking the ones the kernel
+// offers the first time a kernel boots. Has to run before swapon_all sizes
+// the device, the algorithm is fixed from then on.
+int SetupZram() {
+    std::string available;
+    if (!sysfs::ReadValue(kZramAlgorithmPath, &available)) {
+        return 1;
+    }
+
+    struct utsname uts;
+    uname(&uts);
+
+    std::string algorithm;
+    std::string cache;
+    if (ReadFileToString(kAlgorithmCachePath, &cache)) {
+        auto fields = android::base::Split(android::base::Trim(cache), " ");
+        if (fields.size() == 2 && fields[0] == uts.release) {
+            algorithm = fields[1];
+        }
+    }
+
+    if (algorithm.empty()) {
+        // O_DIRECT needs page aligned buffers.
+        std::unique_ptr<uint8_t, decltype(&free)> corpus(
+                static_cast<uint8_t*>(aligned_alloc(4096, kBenchmarkBytes)), free);
+        std::unique_ptr<uint8_t, decltype(&free)> scratch(
+                static_cast<uint8_t*>(aligned_alloc(4096, kBenchmarkBytes)), free);
+        if (!corpus || !scratch) {
+            LOG(ERROR) << "Failed to allocate the benchmark buffers";
+            return 1;
+        }
+        FillCorpus(corpus.get(), kBenchmarkBytes);
+
+        std::vector<CompressionResult> results;
+        for (const auto& name : ParseAlgorithms(available)) {
+            CompressionResult result;
+            if (!Benchmark(name, corpus.get(), scratch.get(), &result)) {
+                continue;
+            }
+            LOG(INFO) << "event=benchmark algorithm=" << name << " orig=" << result.origBytes
+                      << " compr=" << result.comprBytes << " write_us=" << result.writeUs
+                      << " read_us=" << result.readUs;
+            results.push_back(result);
+        }
+        sysfs::WriteValue(kZramResetPath, "1");
+
+        algorithm = ChooseAlgorithm(results);
+        if (algorithm.empty()) {
+            LOG(ERROR) << "No usable zram compression algorithm";
+            return 1;
+        }
+        WriteStringToFile(std::string(uts.release) + " " + algorithm + "\n",
+                          kAlgorithmCachePath);
+    }
+
+    if (!sysfs::WriteValue(kZramAlgorithmPath, algorithm)) {
+        return 1;
+    }
+    LOG(INFO) << "event=zram_setup algorithm=" << algorithm;
+    return 0;
+}
+
+// Replays a recorded trace, see ParseTrace, and prints the decisions.
+int Replay(const char* path) {
+    std::string trace;
+    if (!ReadFileToString(path, &trace)) {
+        PLOG(ERROR) << "Failed to read " << path;
+        return 1;
+    }
+
+    std::vector<TimedSample> samples;
+    if (!ParseTrace(trace, &samples)) {
+        LOG(ERROR) << "Malformed trace " << path;
+        return 1;
+    }
+
+    MemoryTuner tuner;
+    for (const auto& s : samples) {
+        if (tuner.update(s.sample, s.ms)) {
+            std::cout << s.ms << " " << Describe(tuner) << std::endl;
+        }
+    }
+
+    return 0;
+}
+
+}  // anonymous namespace
+
+int main(int argc, char** argv) {
+    if (argc == 3 && strcmp(argv[1], "--replay") == 0) {
+        return Replay(argv[2]);
+    }
+    if (argc == 2 && strcmp(argv[1], "--setup-zram") == 0) {
+        return SetupZram();
+    }
+
+    Daemon daemon;
+    if (!daemon.init()) {
+        return 1;
+    }
+
+    daemon.run();
+    return 1;  // should never get here
+}
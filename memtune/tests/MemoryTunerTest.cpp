@@ -0,0 +1,109 @@
+/*
+ * Copyright (C) 2021 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Replays recorded /proc/pressure/memory traces through MemoryTuner and
+// checks the level changes it decides on.
+
+#include <string>
+#include <vector>
+
+#include <android-base/file.h>
+#include <gtest/gtest.h>
+
+#include "../MemoryTuner.h"
+
+namespace memtune {
+namespace {
+
+struct Change {
+    int64_t ms;
+    Level level;
+
+    bool operator==(const Change& other) const {
+        return ms == other.ms && level == other.level;
+    }
+};
+
+void PrintTo(const Change& change, std::ostream* os) {
+    *os << change.ms << ":" << LevelToString(change.level);
+}
+
+std::vector<TimedSample> LoadTrace(const std::string& name) {
+    std::string trace;
+    std::vector<TimedSample> samples;
+    std::string path = android::base::GetExecutableDirectory() + "/traces/" + name;
+    EXPECT_TRUE(android::base::ReadFileToString(path, &trace)) << path;
+    EXPECT_TRUE(ParseTrace(trace, &samples)) << path;
+    return samples;
+}
+
+std::vector<Change> Replay(const std::vector<TimedSample>& samples) {
+    MemoryTuner tuner;
+    std::vector<Change> changes;
+    for (const auto& s : samples) {
+        if (tuner.update(s.sample, s.ms)) {
+            changes.push_back({s.ms, tuner.level()});
+        }
+    }
+    return changes;
+}
+
+TEST(ParseTraceTest, ParsesSamples) {
+    std::vector<TimedSample> samples;
+    ASSERT_TRUE(ParseTrace("@1000\n"
+                           "some avg10=1.50 avg60=0.50 avg300=0.10 total=1500\n"
+                           "full avg10=0.25 avg60=0.10 avg300=0.00 total=250\n"
+                           "@2000\n"
+                           "some avg10=2.00 avg60=0.70 avg300=0.20 total=3000\n",
+                           &samples));
+    ASSERT_EQ(samples.size(), 2u);
+    EXPECT_EQ(samples[0].ms, 1000);
+    EXPECT_FLOAT_EQ(samples[0].sample.someAvg10, 1.5f);
+    EXPECT_EQ(samples[0].sample.fullTotalUs, 250u);
+    // Kernels without full accounting.
+    EXPECT_EQ(samples[1].ms, 2000);
+    EXPECT_EQ(samples[1].sample.someTotalUs, 3000u);
+    EXPECT_EQ(samples[1].sample.fullTotalUs, 0u);
+}
+
+TEST(ParseTraceTest, RejectsMalformedInput) {
+    std::vector<TimedSample> samples;
+    EXPECT_FALSE(ParseTrace("@12x\nsome avg10=0 avg60=0 avg300=0 total=0\n", &samples));
+    EXPECT_FALSE(ParseTrace("@99999999999999999999\nsome avg10=0 avg60=0 avg300=0 total=0\n",
+                            &samples));
+    EXPECT_FALSE(ParseTrace("@1000\nfull avg10=0 avg60=0 avg300=0 total=0\n", &samples));
+    EXPECT_FALSE(ParseTrace("garbage@1000\nsome avg10=0 avg60=0 avg300=0 total=0\n", &samples));
+}
+
+// Several apps launched back to back on a device with little free memory.
+// The stall totals react within a second while avg10 trails behind, and the
+// level then decays one step per hold period.
+TEST(MemoryTunerReplayTest, LaunchStorm) {
+    std::vector<TimedSample> samples = LoadTrace("launch_storm.trace");
+    ASSERT_EQ(samples.size(), 42u);
+
+    std::vector<Change> expected = {
+            {5318000, Level::MEDIUM},
+            {5319000, Level::CRITICAL},
+            {5332000, Level::MEDIUM},
+            {5342000, Level::LOW},
+            {5352000, Level::NONE},
+    };
+    EXPECT_EQ(Replay(samples), expected);
+}
+
+}  // namespace
+}  // namespace memtune
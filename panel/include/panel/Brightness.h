@@ -0,0 +1,107 @@
+/*
+ * Copyright (C) 2021 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <math.h>
+#include <stdint.h>
+
+#include <algorithm>
+#include <iterator>
+#include <vector>
+
+#include <sysfs/Node.h>
+
+namespace panel {
+
+constexpr const char* kBacklightPath = "/sys/class/backlight/panel0-backlight/brightness";
+constexpr const char* kMaxBacklightPath = "/sys/class/backlight/panel0-backlight/max_brightness";
+constexpr const char* kHbmPath = "/sys/devices/platform/soc/soc:qcom,dsi-display-primary/hbm";
+
+// Luminance of the ea8076 over the framework backlight range, from
+// config_screenBrightnessBacklight and config_screenBrightnessNits in the
+// frameworks/base overlay. Keep them in sync.
+constexpr uint32_t kCalibrationBacklight[] = {1, 255};
+constexpr float kCalibrationNits[] = {5.0f, 445.0f};
+static_assert(std::size(kCalibrationBacklight) == std::size(kCalibrationNits));
+constexpr uint32_t kFrameworkMaxBacklight = 255;
+
+// Luminance in HBM.
+constexpr uint16_t kHbmNits = 600;
+
+constexpr uint32_t kDefaultMaxLevel = 2047;
+
+// Per backlight level luminance, computed once when the service starts so
+// that finger down only costs a table lookup.
+class Brightness {
+  public:
+    Brightness() : backlight_(kBacklightPath, O_RDONLY), hbm_(kHbmPath, O_RDONLY) {
+        uint32_t maxLevel = 0;
+        if (!sysfs::ReadValue(kMaxBacklightPath, &maxLevel) || maxLevel == 0) {
+            maxLevel = kDefaultMaxLevel;
+        }
+
+        table_.resize(maxLevel + 1);
+        for (uint32_t level = 0; level <= maxLevel; level++) {
+            table_[level] = static_cast<uint16_t>(
+                    lroundf(Interpolate(static_cast<float>(level) * kFrameworkMaxBacklight /
+                                        maxLevel)));
+        }
+        // Only an off panel shows nothing, the lowest levels still glow.
+        table_[0] = 0;
+    }
+
+    uint32_t maxLevel() const { return table_.size() - 1; }
+
+    uint16_t nitsAt(uint32_t level) const { return table_[std::min(level, maxLevel())]; }
+
+    // Current backlight level, or 0 if it can't be read.
+    uint32_t level() const {
+        uint32_t level = 0;
+        return backlight_.read(&level) ? level : 0;
+    }
+
+    bool hbm() const {
+        bool enabled = false;
+        return hbm_.read(&enabled) && enabled;
+    }
+
+    // Luminance the panel is showing right now.
+    uint16_t nits() const { return hbm() ? kHbmNits : nitsAt(level()); }
+
+  private:
+    // Piecewise linear over the calibration points, clamped at both ends.
+    static float Interpolate(float backlight) {
+        if (backlight <= kCalibrationBacklight[0]) {
+            return kCalibrationNits[0];
+        }
+        for (size_t i = 1; i < std::size(kCalibrationBacklight); i++) {
+            if (backlight <= kCalibrationBacklight[i]) {
+                float t = (backlight - kCalibrationBacklight[i - 1]) /
+                          (kCalibrationBacklight[i] - kCalibrationBacklight[i - 1]);
+                return kCalibrationNits[i - 1] +
+                       t * (kCalibrationNits[i] - kCalibrationNits[i - 1]);
+            }
+        }
+        return kCalibrationNits[std::size(kCalibrationNits) - 1];
+    }
+
+    sysfs::Node backlight_;
+    sysfs::Node hbm_;
+    std::vector<uint16_t> table_;
+};
+
+}  // namespace panel
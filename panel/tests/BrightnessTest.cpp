@@ -0,0 +1,56 @@
+/*
+ * Copyright (C) 2021 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+#include <panel/Brightness.h>
+#include <sysfs/testing/FakeSysfs.h>
+
+namespace panel {
+namespace {
+
+using sysfs::testing::FakeSysfs;
+
+class BrightnessTest : public ::testing::Test {
+  protected:
+    void SetUp() override {
+        fake_.add(kBacklightPath, "100\n");
+        fake_.add(kMaxBacklightPath, "2047\n");
+        fake_.add(kHbmPath, "0\n");
+    }
+
+    FakeSysfs fake_;
+};
+
+// The table follows config_screenBrightnessNits over the kernel range.
+TEST_F(BrightnessTest, LuminanceFollowsTheCalibration) {
+    Brightness brightness;
+    EXPECT_EQ(brightness.maxLevel(), 2047u);
+    EXPECT_EQ(brightness.nitsAt(0), 0);
+    EXPECT_EQ(brightness.nitsAt(1), 5);
+    EXPECT_EQ(brightness.nitsAt(1024), 224);
+    EXPECT_EQ(brightness.nitsAt(2047), 445);
+    EXPECT_EQ(brightness.nitsAt(4095), 445);
+    EXPECT_EQ(brightness.nits(), 25);
+}
+
+TEST_F(BrightnessTest, HbmOverridesTheBacklight) {
+    fake_.set(kHbmPath, "1\n");
+    Brightness brightness;
+    EXPECT_EQ(brightness.nits(), kHbmNits);
+}
+
+}  // namespace
+}  // namespace panel
@@ -17,9 +17,6 @@
 package org.lineageos.settings.popupcamera;
 
 public class Constants {
-    public static final int FREE_FALL_SENSOR_ID = 33171042;
-
-    public static final int CAMERA_EVENT_DELAY_TIME = 100; // ms
     public static final int MSG_CAMERA_CLOSED = 1001;
     public static final int MSG_CAMERA_OPEN = 1002;
 
@@ -36,9 +33,5 @@ public class Constants {
     public static final String OPEN_CAMERA_STATE = "1";
 
     public static final String FRONT_CAMERA_ID = "1";
-    public static final String LEFT_LED_BREATH_PATH = "/sys/class/leds/green/breath";
-    public static final String LEFT_LED_BRIGHTNESS_PATH = "/sys/class/leds/green/brightness";
-    public static final String LEFT_LED_PATH = "/sys/class/leds/green/";
-    public static final String RIGHT_LED_PATH = "/sys/class/leds/blue/";
     public static final String POPUP_SOUND_PATH = "/system/media/audio/ui/";
 }
@@ -0,0 +1,161 @@
+/*
+ * Copyright (C) 2021 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+package org.lineageos.settings.popupcamera;
+
+import android.net.LocalSocket;
+import android.net.LocalSocketAddress;
+import android.os.Handler;
+import android.os.HandlerThread;
+import android.util.Log;
+
+import java.io.BufferedReader;
+import java.io.IOException;
+import java.io.InputStreamReader;
+import java.io.OutputStream;
+import java.nio.charset.StandardCharsets;
+
+/**
+ * Connection to popupcamerad, which owns the camera motor. Events are read on
+ * a thread of its own and requests are written on another, so neither blocks
+ * the caller.
+ */
+public class MotorClient {
+    private static final String TAG = "PopupCameraMotorClient";
+    private static final boolean DEBUG = false;
+    private static final String SOCKET_NAME = "popupcamera";
+    private static final long RECONNECT_DELAY_MS = 1000;
+
+    public interface Listener {
+        void onEvent(String event);
+    }
+
+    private final Listener mListener;
+    private final Object mLock = new Object();
+    private final Thread mReader;
+    private final HandlerThread mWriterThread;
+    private final Handler mWriter;
+    private LocalSocket mSocket;
+    private OutputStream mOutput;
+    private boolean mClosed;
+
+    public MotorClient(Listener listener) {
+        mListener = listener;
+        mWriterThread = new HandlerThread(TAG + "Writer");
+        mWriterThread.start();
+        mWriter = new Handler(mWriterThread.getLooper());
+        mReader = new Thread(this::run, TAG);
+        mReader.start();
+    }
+
+    public void send(String request) {
+        mWriter.post(() -> write(request));
+    }
+
+    /**
+     * Disconnects and stops both threads. Requests which are still queued
+     * are dropped.
+     */
+    public void close() {
+        synchronized (mLock) {
+            mClosed = true;
+            if (mSocket != null) {
+                try {
+                    // Wakes up the reader, which closes the socket on its way out
+                    mSocket.shutdownInput();
+                    mSocket.shutdownOutput();
+                } catch (IOException e) {
+                    Log.e(TAG, "Failed to shut down the connection", e);
+                }
+            }
+        }
+        mReader.interrupt();
+        mWriterThread.quit();
+    }
+
+    private void write(String request) {
+        synchronized (mLock) {
+            if (mOutput == null) {
+                Log.w(TAG, "Not connected, dropping " + request);
+                return;
+            }
+            try {
+                mOutput.write((request + "\n").getBytes(StandardCharsets.UTF_8));
+            } catch (IOException e) {
+                Log.e(TAG, "Failed to send " + request, e);
+            }
+        }
+    }
+
+    /**
+     * Sends a single request from a short lived thread, without listening
+     * for events.
+     */
+    public static void sendOnce(String request) {
+        new Thread(() -> {
+            try (LocalSocket socket = connect()) {
+                socket.getOutputStream().write(
+                        (request + "\n").getBytes(StandardCharsets.UTF_8));
+            } catch (IOException e) {
+                Log.e(TAG, "Failed to send " + request, e);
+            }
+        }, TAG + "Once").start();
+    }
+
+    private static LocalSocket connect() throws IOException {
+        LocalSocket socket = new LocalSocket();
+        socket.connect(new LocalSocketAddress(SOCKET_NAME,
+                LocalSocketAddress.Namespace.RESERVED));
+        return socket;
+    }
+
+    private void run() {
+        while (true) {
+            try (LocalSocket socket = connect()) {
+                synchronized (mLock) {
+                    if (mClosed) {
+                        return;
+                    }
+                    mSocket = socket;
+                    mOutput = socket.getOutputStream();
+                }
+                BufferedReader reader = new BufferedReader(new InputStreamReader(
+                        socket.getInputStream(), StandardCharsets.UTF_8));
+                String line;
+                while ((line = reader.readLine()) != null) {
+                    if (DEBUG)
+                        Log.d(TAG, "event: " + line);
+                    mListener.onEvent(line);
+                }
+            } catch (IOException e) {
+                Log.e(TAG, "Connection to popupcamerad lost", e);
+            }
+
+            synchronized (mLock) {
+                mSocket = null;
+                mOutput = null;
+                if (mClosed) {
+                    return;
+                }
+            }
+            try {
+                Thread.sleep(RECONNECT_DELAY_MS);
+            } catch (InterruptedException e) {
+                return;
+            }
+        }
+    }
+}
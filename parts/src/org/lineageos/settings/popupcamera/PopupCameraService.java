@@ -17,8 +17,11 @@
 package org.lineageos.settings.popupcamera;
 
 import android.annotation.NonNull;
+import android.app.ActivityManager.RunningTaskInfo;
+import android.app.ActivityTaskManager;
 import android.app.AlertDialog;
 import android.app.Service;
+import android.app.TaskStackListener;
 import android.content.BroadcastReceiver;
 import android.content.Context;
 import android.content.DialogInterface;
@@ -26,10 +29,6 @@ import android.content.Intent;
 import android.content.IntentFilter;
 import android.content.res.Configuration;
 import android.content.res.Resources;
-import android.hardware.Sensor;
-import android.hardware.SensorEvent;
-import android.hardware.SensorEventListener;
-import android.hardware.SensorManager;
 import android.hardware.camera2.CameraManager;
 import android.media.AudioAttributes;
 import android.media.AudioManager;
@@ -38,17 +37,15 @@ import android.os.Handler;
 import android.os.IBinder;
 import android.os.Message;
 import android.os.RemoteException;
-import android.os.SystemClock;
 import android.os.UserHandle;
 import android.provider.Settings;
 import android.util.Log;
 import android.view.KeyEvent;
 import android.view.WindowManager;
 import org.lineageos.settings.R;
-import org.lineageos.settings.utils.FileUtils;
-import vendor.xiaomi.hardware.motor.V1_0.IMotor;
-import vendor.xiaomi.hardware.motor.V1_0.IMotorCallback;
-import vendor.xiaomi.hardware.motor.V1_0.MotorEvent;
+
+import java.util.HashSet;
+import java.util.Set;
 
 public class PopupCameraService extends Service implements Handler.Callback {
     private static final String TAG = "PopupCameraService";
@@ -56,28 +53,19 @@ public class PopupCameraService extends Service implements Handler.Callback {
     private static final String alwaysOnDialogKey = "always_on_camera_dialog";
 
     private int[] mSounds;
-    private boolean mMotorBusy = false;
-    private long mClosedEvent;
-    private long mOpenEvent;
     private boolean mScreenOn = true;
     private int mDialogThemeResID;
 
     private AlertDialog mAlertDialog;
     private Handler mHandler = new Handler(this);
-    private IMotor mMotor = null;
-    private IMotorCallback mMotorStatusCallback;
-    private boolean mMotorCalibrating = false;
+    private MotorClient mMotor;
     private boolean mErrorDialogShowing;
-    private final Object mLock = new Object();
-    private SensorManager mSensorManager;
-    private Sensor mFreeFallSensor;
     private PopupCameraPreferences mPopupCameraPreferences;
     private SoundPool mSoundPool;
     Context mContext;
 
-    private boolean mLedBusy = false;
-    private boolean mLedBreathing = false;
-    private String mLedBrightness = "0";
+    // Packages which used the front camera the last time they opened one.
+    private final Set<String> mFrontCameraPackages = new HashSet<>();
 
     private BroadcastReceiver mIntentReceiver = new BroadcastReceiver() {
         @Override
@@ -98,14 +86,7 @@ public class PopupCameraService extends Service implements Handler.Callback {
                 public void onCameraClosed(@NonNull String cameraId) {
                     super.onCameraClosed(cameraId);
                     if (cameraId.equals(Constants.FRONT_CAMERA_ID)) {
-                        mClosedEvent = SystemClock.elapsedRealtime();
-                        if (SystemClock.elapsedRealtime() - mOpenEvent
-                                        < Constants.CAMERA_EVENT_DELAY_TIME
-                                && mHandler.hasMessages(Constants.MSG_CAMERA_OPEN)) {
-                            mHandler.removeMessages(Constants.MSG_CAMERA_OPEN);
-                        }
-                        mHandler.sendEmptyMessageDelayed(
-                                Constants.MSG_CAMERA_CLOSED, Constants.CAMERA_EVENT_DELAY_TIME);
+                        mHandler.sendEmptyMessage(Constants.MSG_CAMERA_CLOSED);
                     }
                 }
 
@@ -113,34 +94,32 @@ public class PopupCameraService extends Service implements Handler.Callback {
                 public void onCameraOpened(@NonNull String cameraId, @NonNull String packageId) {
                     super.onCameraOpened(cameraId, packageId);
                     if (cameraId.equals(Constants.FRONT_CAMERA_ID)) {
-                        mOpenEvent = SystemClock.elapsedRealtime();
-                        if (SystemClock.elapsedRealtime() - mClosedEvent
-                                        < Constants.CAMERA_EVENT_DELAY_TIME
-                                && mHandler.hasMessages(Constants.MSG_CAMERA_CLOSED)) {
-                            mHandler.removeMessages(Constants.MSG_CAMERA_CLOSED);
-                        }
-                        mHandler.sendEmptyMessageDelayed(
-                                Constants.MSG_CAMERA_OPEN, Constants.CAMERA_EVENT_DELAY_TIME);
+                        mFrontCameraPackages.add(packageId);
+                        mHandler.sendEmptyMessage(Constants.MSG_CAMERA_OPEN);
+                    } else {
+                        mFrontCameraPackages.remove(packageId);
                     }
                 }
             };
 
-    private SensorEventListener mFreeFallListener = new SensorEventListener() {
+    // Start raising the camera as soon as an app which is likely to open the
+    // front camera comes to the foreground, the motor is much slower than the
+    // camera pipeline.
+    private final TaskStackListener mTaskStackListener = new TaskStackListener() {
         @Override
-        public void onSensorChanged(SensorEvent event) {
-            if (event.values[0] == 2.0f) {
-                try {
-                    mMotor.takebackMotorShortly();
-                    mSensorManager.unregisterListener(mFreeFallListener, mFreeFallSensor);
-                } catch (RemoteException e) {
-                    // Do nothing
-                }
-                goBackHome();
+        public void onTaskMovedToFront(RunningTaskInfo taskInfo) {
+            if (taskInfo.topActivity == null) {
+                return;
             }
+            String packageName = taskInfo.topActivity.getPackageName();
+            mHandler.post(() -> {
+                if (mFrontCameraPackages.contains(packageName) && !needsConfirmation()) {
+                    if (DEBUG)
+                        Log.d(TAG, "Pre-raising for " + packageName);
+                    mMotor.send("preraise " + (mPopupCameraPreferences.isLedAllowed() ? 1 : 0));
+                }
+            });
         }
-
-        @Override
-        public void onAccuracyChanged(Sensor sensor, int accuracy) {}
     };
 
     @Override
@@ -152,8 +131,6 @@ public class PopupCameraService extends Service implements Handler.Callback {
         CameraManager cameraManager = getSystemService(CameraManager.class);
         cameraManager.registerAvailabilityCallback(availabilityCallback, null);
         mDialogThemeResID = android.R.style.Theme_DeviceDefault_Light_Dialog_Alert;
-        mSensorManager = getSystemService(SensorManager.class);
-        mFreeFallSensor = mSensorManager.getDefaultSensor(Constants.FREE_FALL_SENSOR_ID);
         mPopupCameraPreferences = new PopupCameraPreferences(this);
         mSoundPool =
                 new SoundPool.Builder()
@@ -172,66 +149,41 @@ public class PopupCameraService extends Service implements Handler.Callback {
             mSounds[i] = mSoundPool.load(Constants.POPUP_SOUND_PATH + soundNames[i], 1);
         }
 
+        mMotor = new MotorClient(event -> mHandler.post(() -> onMotorEvent(event)));
+
         try {
-            mMotor = IMotor.getService();
-            int status = mMotor.getMotorStatus();
-            if (status == Constants.MOTOR_STATUS_POPUP_OK
-                    || status == Constants.MOTOR_STATUS_TAKEBACK_JAMMED) {
-                mMotor.takebackMotor(1);
-                Thread.sleep(1200);
-            }
-            mMotorStatusCallback = new MotorStatusCallback();
-            mMotor.setMotorCallback(mMotorStatusCallback);
-        } catch (InterruptedException | RemoteException e) {
-            // Do nothing
+            ActivityTaskManager.getService().registerTaskStackListener(mTaskStackListener);
+        } catch (RemoteException | SecurityException e) {
+            Log.e(TAG, "Failed to register task stack listener", e);
         }
     }
 
-    private final class MotorStatusCallback extends IMotorCallback.Stub {
-        public MotorStatusCallback() {}
-
-        @Override
-        public void onNotify(MotorEvent event) {
-            int status = event.vaalue;
-            int cookie = event.cookie;
-            if (DEBUG)
-                Log.d(TAG, "onNotify: cookie=" + cookie + ", status=" + status);
-            synchronized (mLock) {
-                if (status == Constants.MOTOR_STATUS_CALIB_OK
-                        || status == Constants.MOTOR_STATUS_CALIB_ERROR) {
-                    showCalibrationResult(status);
-                } else if (status == Constants.MOTOR_STATUS_PRESSED) {
-                    updateMotor(Constants.CLOSE_CAMERA_STATE);
-                    goBackHome();
-                } else if (status == Constants.MOTOR_STATUS_POPUP_JAMMED
-                        || status == Constants.MOTOR_STATUS_TAKEBACK_JAMMED) {
-                    showErrorDialog();
-                }
+    private void onMotorEvent(String event) {
+        if (event.startsWith("moving ")) {
+            boolean open = event.equals("moving open");
+            playSoundEffect(open ? Constants.OPEN_CAMERA_STATE : Constants.CLOSE_CAMERA_STATE);
+        } else if (event.equals("dropped")) {
+            // popupcamerad watches for free falls and already took the camera back
+            goBackHome();
+        } else if (event.startsWith("status ")) {
+            int status = Integer.parseInt(event.substring("status ".length()));
+            if (status == Constants.MOTOR_STATUS_CALIB_OK
+                    || status == Constants.MOTOR_STATUS_CALIB_ERROR) {
+                showCalibrationResult(status);
+            } else if (status == Constants.MOTOR_STATUS_PRESSED) {
+                goBackHome();
+            } else if (status == Constants.MOTOR_STATUS_POPUP_JAMMED
+                    || status == Constants.MOTOR_STATUS_TAKEBACK_JAMMED
+                    || status == Constants.MOTOR_STATUS_REQUEST_CALIB) {
+                showErrorDialog();
             }
         }
     }
 
     protected void calibrateMotor() {
-        synchronized (mLock) {
-            if (mMotorCalibrating)
-                return;
-            if (mMotor == null) {
-                try {
-                    mMotor = IMotor.getService();
-                } catch (RemoteException e) {
-                    // Do nothing
-                }
-                if (mMotor == null)
-                    return;
-            }
-            try {
-                mMotorCalibrating = true;
-                mMotor.calibration();
-            } catch (RemoteException e) {
-                // Do nothing
-            }
-            mHandler.postDelayed(() -> mMotorCalibrating = false, 7000);
-        }
+        // Settings talks to a fresh instance of this class, the result is
+        // reported to the running service.
+        MotorClient.sendOnce("calibrate");
     }
 
     @Override
@@ -246,6 +198,12 @@ public class PopupCameraService extends Service implements Handler.Callback {
         if (DEBUG)
             Log.d(TAG, "Destroying service");
         unregisterReceiver(mIntentReceiver);
+        try {
+            ActivityTaskManager.getService().unregisterTaskStackListener(mTaskStackListener);
+        } catch (RemoteException | SecurityException e) {
+            // Do nothing
+        }
+        mMotor.close();
         super.onDestroy();
     }
 
@@ -255,108 +213,11 @@ public class PopupCameraService extends Service implements Handler.Callback {
     }
 
     private void updateMotor(String cameraState) {
-        if (mMotor == null) {
-            return;
-        }
-        final Runnable r = () -> {
-            mMotorBusy = true;
-            try {
-                int status = mMotor.getMotorStatus();
-                if (DEBUG)
-                    Log.d(TAG, "updateMotor: status=" + status + ", cameraState=" + cameraState);
-                if (cameraState.equals(Constants.OPEN_CAMERA_STATE)
-                        && (status == Constants.MOTOR_STATUS_TAKEBACK_OK
-                                || status == Constants.MOTOR_STATUS_CALIB_OK)) {
-                    lightUp(true);
-                    playSoundEffect(Constants.OPEN_CAMERA_STATE);
-                    mMotor.popupMotor(1);
-                    mSensorManager.registerListener(
-                            mFreeFallListener, mFreeFallSensor, SensorManager.SENSOR_DELAY_NORMAL);
-                } else if (cameraState.equals(Constants.CLOSE_CAMERA_STATE)
-                        && status == Constants.MOTOR_STATUS_POPUP_OK) {
-                    lightUp(false);
-                    playSoundEffect(Constants.CLOSE_CAMERA_STATE);
-                    mMotor.takebackMotor(1);
-                    mSensorManager.unregisterListener(mFreeFallListener, mFreeFallSensor);
-                } else {
-                    mMotorBusy = false;
-                    if (status == Constants.MOTOR_STATUS_POPUP_JAMMED
-                            || status == Constants.MOTOR_STATUS_TAKEBACK_JAMMED
-                            || status == Constants.MOTOR_STATUS_CALIB_ERROR
-                            || status == Constants.MOTOR_STATUS_REQUEST_CALIB) {
-                        showErrorDialog();
-                    }
-                    return;
-                }
-            } catch (RemoteException e) {
-                // Do nothing
-            }
-            mHandler.postDelayed(() -> mMotorBusy = false, 1200);
-        };
-
-        if (mMotorBusy) {
-            mHandler.postDelayed(new Runnable() {
-                @Override
-                public void run() {
-                    if (mMotorBusy) {
-                        mHandler.postDelayed(this, 100);
-                    } else {
-                        mHandler.post(r);
-                    }
-                }
-            }, 100);
-        } else {
-            mHandler.post(r);
-        }
-    }
-
-    private void setLed(String mode, String value) {
-        FileUtils.writeLine(Constants.LEFT_LED_PATH + mode, value);
-        FileUtils.writeLine(Constants.RIGHT_LED_PATH + mode, value);
-    }
-
-    private void lightUp(boolean open) {
-        if (mPopupCameraPreferences.isLedAllowed()) {
-            // Save the active LED effects if it's not our effect and mark the LED as busy
-            if (!mLedBusy) {
-                mLedBreathing = FileUtils.readOneLine(Constants.LEFT_LED_BREATH_PATH).equals("1");
-                mLedBrightness = FileUtils.readOneLine(Constants.LEFT_LED_BRIGHTNESS_PATH);
-            }
-            mLedBusy = true;
-
-            // Reset the active LED effects
-            setLed("breath", "0");
-            setLed("brightness", "0");
-
-            // Tune the breath parameters for popup
-            setLed("lo_idx", open ? "0" : "22");
-            setLed("pause_lo_count", open ? "5" : "0");
-            setLed("step_ms", "35");
-            setLed("lut_pattern", "1");
-
-            // Enable the breath effect
-            setLed("breath", "1");
-
-            mHandler.postDelayed(() -> {
-                // Disable the breath effect
-                setLed("brightness", "0");
-
-                // Restore default breath parameters
-                setLed("lo_idx", "0");
-                setLed("pause_lo_count", "30");
-                setLed("step_ms", "70");
-
-                // Restore the previous LED effects
-                if (mLedBreathing) {
-                    FileUtils.writeLine(Constants.LEFT_LED_BREATH_PATH, "1");
-                } else {
-                    FileUtils.writeLine(Constants.LEFT_LED_BRIGHTNESS_PATH, mLedBrightness);
-                }
-
-                // Unmark the LED as busy since our effect is done
-                mLedBusy = false;
-            }, 1400);
-        }
+        boolean open = cameraState.equals(Constants.OPEN_CAMERA_STATE);
+        if (DEBUG)
+            Log.d(TAG, "updateMotor: cameraState=" + cameraState);
+        mMotor.send((open ? "raise " : "retract ")
+                + (mPopupCameraPreferences.isLedAllowed() ? 1 : 0));
     }
 
     private void showCalibrationResult(int status) {
@@ -366,11 +227,9 @@ public class PopupCameraService extends Service implements Handler.Callback {
         mErrorDialogShowing = true;
         mHandler.post(() -> {
             Resources res = getResources();
-            int dialogMessageResId = mMotorCalibrating
-                    ? R.string.popup_camera_calibrate_running
-                    : (status == Constants.MOTOR_STATUS_CALIB_OK
-                                    ? R.string.popup_camera_calibrate_success
-                                    : R.string.popup_camera_calibrate_failed);
+            int dialogMessageResId = status == Constants.MOTOR_STATUS_CALIB_OK
+                    ? R.string.popup_camera_calibrate_success
+                    : R.string.popup_camera_calibrate_failed;
             AlertDialog.Builder alertDialogBuilder =
                     new AlertDialog.Builder(this, R.style.SystemAlertDialogTheme);
             alertDialogBuilder.setMessage(res.getString(dialogMessageResId));
@@ -453,9 +312,7 @@ public class PopupCameraService extends Service implements Handler.Callback {
                 updateMotor(Constants.CLOSE_CAMERA_STATE);
             } break;
             case Constants.MSG_CAMERA_OPEN: {
-            boolean alwaysOnDialog = Settings.System.getInt(getContentResolver(),
-                        alwaysOnDialogKey, 0) == 1;
-            if (alwaysOnDialog || !mScreenOn) {
+            if (needsConfirmation()) {
                 updateDialogTheme();
                 if (mAlertDialog == null) {
                     mAlertDialog = new AlertDialog.Builder(this, mDialogThemeResID)
@@ -478,6 +335,12 @@ public class PopupCameraService extends Service implements Handler.Callback {
         return true;
     }
 
+    private boolean needsConfirmation() {
+        boolean alwaysOnDialog = Settings.System.getInt(getContentResolver(),
+                alwaysOnDialogKey, 0) == 1;
+        return alwaysOnDialog || !mScreenOn;
+    }
+
     private void updateDialogTheme() {
         int nightModeFlags = getResources().getConfiguration().uiMode
                 & Configuration.UI_MODE_NIGHT_MASK;
@@ -0,0 +1,70 @@
+/*
+ * Copyright (C) 2021 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "popupcamerad"
+
+#include "FreeFall.h"
+
+#include <android-base/logging.h>
+
+namespace popupcamera {
+
+void FreeFallWatcher::start() {
+    std::lock_guard<std::mutex> lock(lock_);
+    if (armed_) {
+        return;
+    }
+    if (!source_.enable()) {
+        LOG(ERROR) << "Failed to enable the free fall sensor";
+        return;
+    }
+    armed_ = true;
+}
+
+void FreeFallWatcher::stop() {
+    std::lock_guard<std::mutex> lock(lock_);
+    if (armed_.exchange(false)) {
+        source_.disable();
+    }
+}
+
+void FreeFallWatcher::poll(const std::function<void(int64_t)>& onFall) {
+    SensorSample samples[kMaxSamples];
+    bool fell = false;
+
+    // Drains everything, a stale event must not trigger the next start().
+    size_t count;
+    while ((count = source_.read(samples, kMaxSamples)) > 0) {
+        for (size_t i = 0; i < count; i++) {
+            if (samples[i].type == kFreeFallSensorType &&
+                samples[i].value == kFreeFallDetected && armed_.exchange(false)) {
+                fell = true;
+                onFall(samples[i].timestampNs);
+            }
+        }
+    }
+
+    // Turning the sensor off is a round trip to the sensor service, so it
+    // only happens once the camera is on its way back.
+    if (fell) {
+        std::lock_guard<std::mutex> lock(lock_);
+        if (!armed_) {
+            source_.disable();
+        }
+    }
+}
+
+}  // namespace popupcamera
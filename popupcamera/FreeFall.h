@@ -0,0 +1,74 @@
+/*
+ * Copyright (C) 2021 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <functional>
+#include <mutex>
+
+namespace popupcamera {
+
+// Xiaomi's free fall sensor, it reports 2 once the device is falling.
+constexpr int32_t kFreeFallSensorType = 33171042;
+constexpr float kFreeFallDetected = 2.0f;
+
+struct SensorSample {
+    int32_t type;
+    int64_t timestampNs;
+    float value;
+};
+
+// Where the free fall events come from, the sensor service on the device.
+class SensorSource {
+  public:
+    virtual ~SensorSource() = default;
+
+    virtual bool enable() = 0;
+    virtual void disable() = 0;
+
+    // Fills out with up to max pending events and returns how many.
+    virtual size_t read(SensorSample* out, size_t max) = 0;
+};
+
+// Watches the free fall sensor while the camera is out. Only the first free
+// fall after start() is reported, the sensor is turned off right after.
+// start() and stop() come from the main loop while poll() runs on the
+// thread the source delivers events on.
+class FreeFallWatcher {
+  public:
+    static constexpr size_t kMaxSamples = 8;
+
+    explicit FreeFallWatcher(SensorSource& source) : source_(source), armed_(false) {}
+
+    void start();
+    void stop();
+
+    // Drains the source. A free fall is handed to onFall, with its
+    // timestamp, before the sensor gets turned off.
+    void poll(const std::function<void(int64_t)>& onFall);
+
+  private:
+    SensorSource& source_;
+    std::atomic<bool> armed_;
+    // Keeps a stop() racing with the detection from leaving the sensor on.
+    std::mutex lock_;
+};
+
+}  // namespace popupcamera
@@ -0,0 +1,66 @@
+/*
+ * Copyright (C) 2021 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#include <array>
+#include <sstream>
+#include <string>
+
+namespace popupcamera {
+
+// Power of two buckets from 1ms to 128ms, the last one catches the rest.
+class LatencyHistogram {
+  public:
+    static constexpr size_t kBuckets = 9;
+
+    void record(int64_t latencyUs) {
+        size_t bucket = 0;
+        int64_t limitUs = 1000;
+        while (bucket < kBuckets - 1 && latencyUs >= limitUs) {
+            bucket++;
+            limitUs *= 2;
+        }
+        counts_[bucket]++;
+        if (latencyUs > maxUs_) {
+            maxUs_ = latencyUs;
+        }
+    }
+
+    // "<1ms:3 <2ms:1 ... >=128ms:0 max=1234us"
+    std::string toString() const {
+        std::ostringstream out;
+        int64_t limitMs = 1;
+        for (size_t i = 0; i < kBuckets; i++) {
+            if (i < kBuckets - 1) {
+                out << "<" << limitMs << "ms:" << counts_[i] << " ";
+                limitMs *= 2;
+            } else {
+                out << ">=" << limitMs / 2 << "ms:" << counts_[i];
+            }
+        }
+        out << " max=" << maxUs_ << "us";
+        return out.str();
+    }
+
+  private:
+    std::array<uint32_t, kBuckets> counts_ = {};
+    int64_t maxUs_ = 0;
+};
+
+}  // namespace popupcamera
@@ -0,0 +1,299 @@
+/*
+ * Copyright (C) 2021 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "popupcamerad"
+
+#include "Orchestrator.h"
+
+#include <android-base/logging.h>
+
+namespace popupcamera {
+
+namespace {
+
+// The lights HAL plays the raise animation for green and the retract one
+// for blue.
+constexpr uint32_t kLedRaise = 0xff00ff00;
+constexpr uint32_t kLedRetract = 0xff0000ff;
+
+int64_t EarliestDeadline(int64_t a, int64_t b) {
+    if (a < 0) return b;
+    if (b < 0) return a;
+    return a < b ? a : b;
+}
+
+}  // anonymous namespace
+
+const char* PositionToString(Position position) {
+    switch (position) {
+        case Position::UNKNOWN:
+            return "unknown";
+        case Position::CLOSED:
+            return "closed";
+        case Position::RAISING:
+            return "raising";
+        case Position::OPEN:
+            return "open";
+        case Position::RETRACTING:
+            return "retracting";
+        case Position::CALIBRATING:
+            return "calibrating";
+        case Position::ERROR:
+            return "error";
+    }
+    return "?";
+}
+
+bool ParseRequest(const std::string& str, Request* out) {
+    if (str == "raise") {
+        *out = Request::RAISE;
+    } else if (str == "preraise") {
+        *out = Request::PRERAISE;
+    } else if (str == "retract") {
+        *out = Request::RETRACT;
+    } else if (str == "calibrate") {
+        *out = Request::CALIBRATE;
+    } else if (str == "drop") {
+        *out = Request::DROP;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+Orchestrator::Orchestrator(Motor& motor, Effects& effects)
+    : motor_(motor),
+      effects_(effects),
+      position_(Position::UNKNOWN),
+      target_(Position::CLOSED),
+      led_(false),
+      led_on_(false),
+      motion_deadline_ms_(-1),
+      preraise_deadline_ms_(-1),
+      retract_at_ms_(-1) {}
+
+void Orchestrator::start(int64_t nowMs) {
+    int32_t status = motor_.status();
+    if (status == POPUP_OK || status == TAKEBACK_JAMMED) {
+        position_ = Position::OPEN;
+        step(nowMs);
+    } else {
+        resync();
+    }
+    LOG(INFO) << "started, status=" << status << " position=" << PositionToString(position_);
+}
+
+void Orchestrator::request(Request req, bool led, int64_t nowMs) {
+    // Trust the cached position when dropping, the status query would cost
+    // a binder round trip.
+    if (!busy() && req != Request::DROP) {
+        resync();
+    }
+
+    switch (req) {
+        case Request::RAISE:
+            led_ = led;
+            target_ = Position::OPEN;
+            preraise_deadline_ms_ = -1;
+            retract_at_ms_ = -1;
+            if (position_ == Position::ERROR) {
+                effects_.notify("status " + std::to_string(motor_.status()));
+            }
+            break;
+        case Request::PRERAISE:
+            if (target_ == Position::OPEN || position_ == Position::ERROR) {
+                return;
+            }
+            led_ = led;
+            target_ = Position::OPEN;
+            preraise_deadline_ms_ = nowMs + kPreRaiseHoldMs;
+            retract_at_ms_ = -1;
+            break;
+        case Request::RETRACT:
+            led_ = led;
+            target_ = Position::CLOSED;
+            preraise_deadline_ms_ = -1;
+            retract_at_ms_ = nowMs + kRetractSettleMs;
+            break;
+        case Request::CALIBRATE:
+            if (position_ == Position::CALIBRATING) {
+                return;
+            }
+            target_ = Position::CLOSED;
+            preraise_deadline_ms_ = -1;
+            retract_at_ms_ = -1;
+            position_ = Position::CALIBRATING;
+            motion_deadline_ms_ = nowMs + kCalibrationTimeoutMs;
+            motor_.calibrate();
+            break;
+        case Request::DROP:
+            // Skip the effects, every millisecond counts here. Clients only
+            // hear about it once the motor is on its way.
+            target_ = Position::CLOSED;
+            preraise_deadline_ms_ = -1;
+            retract_at_ms_ = -1;
+            if (position_ == Position::CLOSED) {
+                return;
+            }
+            position_ = Position::RETRACTING;
+            motion_deadline_ms_ = nowMs + kMotionTimeoutMs;
+            motor_.takebackShortly();
+            effects_.notify("dropped");
+            break;
+    }
+
+    step(nowMs);
+}
+
+void Orchestrator::onMotorStatus(int32_t status, int64_t nowMs) {
+    LOG(DEBUG) << "motor status=" << status << " position=" << PositionToString(position_);
+
+    switch (status) {
+        case POPUP_OK:
+            finishMotion(Position::OPEN);
+            break;
+        case TAKEBACK_OK:
+            finishMotion(Position::CLOSED);
+            break;
+        case CALIB_OK:
+            finishMotion(Position::CLOSED);
+            effects_.notify("status " + std::to_string(status));
+            break;
+        case POPUP_JAMMED:
+        case TAKEBACK_JAMMED:
+        case CALIB_ERROR:
+        case REQUEST_CALIB:
+            finishMotion(Position::ERROR);
+            target_ = Position::CLOSED;
+            preraise_deadline_ms_ = -1;
+            effects_.notify("status " + std::to_string(status));
+            break;
+        case PRESSED:
+            // Someone pushed the camera down, take it back right away.
+            target_ = Position::CLOSED;
+            preraise_deadline_ms_ = -1;
+            retract_at_ms_ = -1;
+            effects_.notify("status " + std::to_string(status));
+            break;
+        default:
+            return;
+    }
+
+    step(nowMs);
+}
+
+void Orchestrator::onTimeout(int64_t nowMs) {
+    if (motion_deadline_ms_ >= 0 && nowMs >= motion_deadline_ms_) {
+        LOG(WARNING) << "no completion for " << PositionToString(position_) << ", resyncing";
+        finishMotion(Position::UNKNOWN);
+        resync();
+        if (position_ == Position::ERROR) {
+            effects_.notify("status " + std::to_string(motor_.status()));
+        }
+    }
+
+    if (preraise_deadline_ms_ >= 0 && nowMs >= preraise_deadline_ms_) {
+        LOG(INFO) << "camera was not opened after pre-raise";
+        preraise_deadline_ms_ = -1;
+        target_ = Position::CLOSED;
+    }
+
+    step(nowMs);
+}
+
+int64_t Orchestrator::nextDeadlineMs() const {
+    int64_t deadline = EarliestDeadline(motion_deadline_ms_, preraise_deadline_ms_);
+    if (!busy()) {
+        deadline = EarliestDeadline(deadline, retract_at_ms_);
+    }
+    return deadline;
+}
+
+bool Orchestrator::busy() const {
+    return position_ == Position::RAISING || position_ == Position::RETRACTING ||
+           position_ == Position::CALIBRATING;
+}
+
+void Orchestrator::resync() {
+    switch (motor_.status()) {
+        case POPUP_OK:
+            position_ = Position::OPEN;
+            break;
+        case TAKEBACK_OK:
+        case CALIB_OK:
+            position_ = Position::CLOSED;
+            break;
+        case POPUP_JAMMED:
+        case TAKEBACK_JAMMED:
+        case CALIB_ERROR:
+        case REQUEST_CALIB:
+            position_ = Position::ERROR;
+            break;
+        default:
+            position_ = Position::UNKNOWN;
+            break;
+    }
+}
+
+void Orchestrator::step(int64_t nowMs) {
+    if (busy()) {
+        return;
+    }
+
+    if (target_ == Position::OPEN && position_ == Position::CLOSED) {
+        startMotion(Position::RAISING, nowMs);
+    } else if (target_ == Position::CLOSED && position_ == Position::OPEN) {
+        if (retract_at_ms_ > nowMs) {
+            return;
+        }
+        retract_at_ms_ = -1;
+        startMotion(Position::RETRACTING, nowMs);
+    }
+}
+
+void Orchestrator::startMotion(Position motion, int64_t nowMs) {
+    bool raise = motion == Position::RAISING;
+
+    LOG(INFO) << (raise ? "raising" : "retracting") << " camera";
+
+    // Kick off the effects first, they are asynchronous and the motor call
+    // only returns once the motion has been queued.
+    if (led_) {
+        effects_.setLed(raise ? kLedRaise : kLedRetract);
+        led_on_ = true;
+    }
+    effects_.notify(raise ? "moving open" : "moving close");
+    effects_.watchFreeFall(raise);
+
+    position_ = motion;
+    motion_deadline_ms_ = nowMs + kMotionTimeoutMs;
+    if (raise) {
+        motor_.popup();
+    } else {
+        motor_.takeback();
+    }
+}
+
+void Orchestrator::finishMotion(Position position) {
+    position_ = position;
+    motion_deadline_ms_ = -1;
+    if (led_on_) {
+        effects_.setLed(0);
+        led_on_ = false;
+    }
+}
+
+}  // namespace popupcamera
@@ -0,0 +1,136 @@
+/*
+ * Copyright (C) 2021 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#include <string>
+
+namespace popupcamera {
+
+// Status codes reported by the motor HAL.
+enum MotorStatus : int32_t {
+    POPUP_OK = 11,
+    POPUP_JAMMED = 12,
+    TAKEBACK_OK = 13,
+    TAKEBACK_JAMMED = 14,
+    PRESSED = 15,
+    CALIB_OK = 17,
+    CALIB_ERROR = 18,
+    REQUEST_CALIB = 19,
+};
+
+enum class Position { UNKNOWN = 0, CLOSED, RAISING, OPEN, RETRACTING, CALIBRATING, ERROR };
+
+enum class Request {
+    // The front camera was opened.
+    RAISE,
+    // The front camera is likely about to be opened.
+    PRERAISE,
+    // The front camera was closed.
+    RETRACT,
+    CALIBRATE,
+    // The device is falling, pull the camera in as fast as possible.
+    DROP,
+};
+
+const char* PositionToString(Position position);
+
+// Parses "raise", "preraise", "retract", "calibrate" and "drop".
+bool ParseRequest(const std::string& str, Request* out);
+
+class Motor {
+  public:
+    virtual ~Motor() = default;
+
+    // Returns the last MotorStatus, or -1 if the HAL is unreachable.
+    virtual int32_t status() = 0;
+    virtual void popup() = 0;
+    virtual void takeback() = 0;
+    virtual void takebackShortly() = 0;
+    virtual void calibrate() = 0;
+};
+
+class Effects {
+  public:
+    virtual ~Effects() = default;
+
+    // Sets the popup camera light, 0 turns it off.
+    virtual void setLed(uint32_t color) = 0;
+
+    // Forwards an event line to the connected clients.
+    virtual void notify(const std::string& event) = 0;
+
+    // Falls only matter while the camera is out.
+    virtual void watchFreeFall(bool enable) = 0;
+};
+
+// Owns the camera motor. Clients only state where the camera should be,
+// motion starts as soon as the motor is idle and is considered done when the
+// HAL reports it, not after a fixed delay. Requests which arrive during a
+// motion are coalesced into the target position.
+//
+// Events sent to clients:
+//   "moving open" / "moving close"  a motion has just been started
+//   "status <code>"                 a MotorStatus the user has to know about
+//   "dropped"                       the camera was pulled in after a free fall
+class Orchestrator {
+  public:
+    // Fallback in case the HAL never reports the end of a motion.
+    static constexpr int64_t kMotionTimeoutMs = 2000;
+    static constexpr int64_t kCalibrationTimeoutMs = 10000;
+    // How long a pre-raised camera waits for the camera to actually open.
+    static constexpr int64_t kPreRaiseHoldMs = 3000;
+    // Camera apps close and reopen the device when switching modes.
+    static constexpr int64_t kRetractSettleMs = 100;
+
+    Orchestrator(Motor& motor, Effects& effects);
+
+    // Syncs with the motor and takes the camera back if it was left out.
+    void start(int64_t nowMs);
+
+    void request(Request req, bool led, int64_t nowMs);
+    void onMotorStatus(int32_t status, int64_t nowMs);
+    void onTimeout(int64_t nowMs);
+
+    // Next time onTimeout() has to be called, -1 if nothing is pending.
+    int64_t nextDeadlineMs() const;
+
+    Position position() const { return position_; }
+    Position target() const { return target_; }
+
+  private:
+    bool busy() const;
+    void resync();
+    void step(int64_t nowMs);
+    void startMotion(Position motion, int64_t nowMs);
+    void finishMotion(Position position);
+
+    Motor& motor_;
+    Effects& effects_;
+
+    Position position_;
+    Position target_;
+    bool led_;
+    bool led_on_;
+
+    int64_t motion_deadline_ms_;
+    int64_t preraise_deadline_ms_;
+    int64_t retract_at_ms_;
+};
+
+}  // namespace popupcamera
@@ -0,0 +1,537 @@
+/*
+ * Copyright (C) 2021 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "popupcamerad"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <deque>
+#include <future>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <aidl/android/hardware/light/ILights.h>
+#include <android-base/logging.h>
+#include <android-base/parseint.h>
+#include <android-base/strings.h>
+#include <android-base/unique_fd.h>
+#include <android/binder_manager.h>
+#include <android/looper.h>
+#include <android/sensor.h>
+#include <cutils/sockets.h>
+#include <hidl/HidlTransportSupport.h>
+#include <vendor/xiaomi/hardware/motor/1.0/IMotor.h>
+
+#include "FreeFall.h"
+#include "LatencyHistogram.h"
+#include "Orchestrator.h"
+
+using ::aidl::android::hardware::light::HwLightState;
+using ::aidl::android::hardware::light::ILights;
+using ::android::sp;
+using ::android::base::ParseInt;
+using ::android::base::Split;
+using ::android::base::unique_fd;
+using ::android::hardware::configureRpcThreadpool;
+using ::android::hardware::joinRpcThreadpool;
+using ::android::hardware::Return;
+using ::android::hardware::Void;
+using ::vendor::xiaomi::hardware::motor::V1_0::IMotor;
+using ::vendor::xiaomi::hardware::motor::V1_0::IMotorCallback;
+using ::vendor::xiaomi::hardware::motor::V1_0::MotorEvent;
+
+using ::popupcamera::Effects;
+using ::popupcamera::FreeFallWatcher;
+using ::popupcamera::kFreeFallSensorType;
+using ::popupcamera::LatencyHistogram;
+using ::popupcamera::Motor;
+using ::popupcamera::Orchestrator;
+using ::popupcamera::ParseRequest;
+using ::popupcamera::Request;
+using ::popupcamera::SensorSample;
+using ::popupcamera::SensorSource;
+
+namespace {
+
+constexpr const char* kSocketName = "popupcamera";
+constexpr const char* kLightsInstance = "android.hardware.light.ILights/default";
+
+// Matches kPopupCameraLightId in the lights HAL.
+constexpr int kPopupCameraLightId = 100;
+
+// The HAL only uses the cookie to tag its callbacks.
+constexpr int32_t kMotorCookie = 1;
+
+// Keep the drop path ahead of everything else running on the little cores.
+constexpr int kSchedFifoPriority = 2;
+
+constexpr int kMaxEvents = 8;
+constexpr size_t kMaxRequestLength = 64;
+
+int64_t NowMs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000LL + ts.tv_nsec / 1000000;
+}
+
+// Sensor event timestamps are in the CLOCK_BOOTTIME base.
+int64_t BootTimeNs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_BOOTTIME, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+class HidlMotor : public Motor {
+  public:
+    explicit HidlMotor(sp<IMotor> hal) : hal_(std::move(hal)) {}
+
+    int32_t status() override {
+        Return<int32_t> ret = hal_->getMotorStatus();
+        return ret.isOk() ? static_cast<int32_t>(ret) : -1;
+    }
+
+    void popup() override { check(hal_->popupMotor(kMotorCookie), "popupMotor"); }
+    void takeback() override { check(hal_->takebackMotor(kMotorCookie), "takebackMotor"); }
+    void takebackShortly() override {
+        check(hal_->takebackMotorShortly(), "takebackMotorShortly");
+    }
+    void calibrate() override { check(hal_->calibration(), "calibration"); }
+
+  private:
+    void check(const Return<void>& ret, const char* what) {
+        if (!ret.isOk()) {
+            LOG(ERROR) << what << " failed: " << ret.description();
+        }
+    }
+
+    sp<IMotor> hal_;
+};
+
+// The free fall sensor through the sensor service, libsensorndkbridge runs
+// the callbacks on the thread which polls the looper.
+class NdkSensorSource : public SensorSource {
+  public:
+    bool init(ALooper* looper, ALooper_callbackFunc callback, void* data) {
+        ASensorManager* manager = ASensorManager_getInstanceForPackage(kSocketName);
+        if (manager == nullptr) {
+            return false;
+        }
+        sensor_ = ASensorManager_getDefaultSensor(manager, kFreeFallSensorType);
+        if (sensor_ == nullptr) {
+            return false;
+        }
+        queue_ = ASensorManager_createEventQueue(manager, looper, 0, callback, data);
+        return queue_ != nullptr;
+    }
+
+    bool enable() override {
+        // No batching, a fall is only worth reporting right away.
+        return ASensorEventQueue_registerSensor(queue_, sensor_, ASensor_getMinDelay(sensor_),
+                                                0) >= 0;
+    }
+
+    void disable() override { ASensorEventQueue_disableSensor(queue_, sensor_); }
+
+    size_t read(SensorSample* out, size_t max) override {
+        ASensorEvent events[FreeFallWatcher::kMaxSamples];
+        ssize_t count = ASensorEventQueue_getEvents(
+                queue_, events, std::min(max, FreeFallWatcher::kMaxSamples));
+        for (ssize_t i = 0; i < count; i++) {
+            out[i] = {events[i].type, events[i].timestamp, events[i].data[0]};
+        }
+        return std::max<ssize_t>(count, 0);
+    }
+
+  private:
+    ASensorRef sensor_ = nullptr;
+    ASensorEventQueue* queue_ = nullptr;
+};
+
+// Callbacks arrive on a hwbinder thread, hand them over to the main loop.
+class MotorCallback : public IMotorCallback {
+  public:
+    explicit MotorCallback(int event_fd) : event_fd_(event_fd) {}
+
+    Return<void> onNotify(const MotorEvent& event) override {
+        {
+            std::lock_guard<std::mutex> lock(lock_);
+            pending_.push_back(event.vaalue);
+        }
+        uint64_t one = 1;
+        TEMP_FAILURE_RETRY(write(event_fd_, &one, sizeof(one)));
+        return Void();
+    }
+
+    std::deque<int32_t> drain() {
+        std::lock_guard<std::mutex> lock(lock_);
+        std::deque<int32_t> out;
+        out.swap(pending_);
+        return out;
+    }
+
+  private:
+    int event_fd_;
+    std::mutex lock_;
+    std::deque<int32_t> pending_;
+};
+
+class Daemon : public Effects {
+  public:
+    bool init();
+    void run();
+
+    void setLed(uint32_t color) override;
+    void notify(const std::string& event) override;
+    void watchFreeFall(bool enable) override;
+
+  private:
+    struct Client {
+        unique_fd fd;
+        std::string buffer;
+        // Shut down because it stopped reading, waiting for the hangup.
+        bool dead = false;
+    };
+
+    bool initFreeFall();
+    static int onSensorEvents(int fd, int events, void* data);
+    void handleDrop(int64_t eventNs);
+
+    void acceptClient();
+    void readClient(int fd);
+    void handleLine(const std::string& line);
+    void dropClient(int fd);
+
+    unique_fd epoll_fd_;
+    unique_fd event_fd_;
+    unique_fd fall_fd_;
+    int listen_fd_ = -1;
+    std::map<int, Client> clients_;
+
+    sp<MotorCallback> callback_;
+    std::unique_ptr<HidlMotor> motor_;
+    std::unique_ptr<Orchestrator> orchestrator_;
+    std::shared_ptr<ILights> lights_;
+
+    NdkSensorSource sensor_;
+    FreeFallWatcher free_fall_{sensor_};
+    bool has_free_fall_ = false;
+    std::mutex falls_lock_;
+    std::deque<int64_t> falls_;
+
+    // Free fall detection to takeback issued.
+    LatencyHistogram drop_latency_;
+};
+
+bool Daemon::init() {
+    sp<IMotor> hal = IMotor::getService();
+    if (hal == nullptr) {
+        LOG(ERROR) << "Motor HAL is not available";
+        return false;
+    }
+
+    epoll_fd_.reset(epoll_create1(EPOLL_CLOEXEC));
+    event_fd_.reset(eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK));
+    fall_fd_.reset(eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK));
+    if (epoll_fd_ < 0 || event_fd_ < 0 || fall_fd_ < 0) {
+        PLOG(ERROR) << "Failed to create epoll/event fd";
+        return false;
+    }
+
+    listen_fd_ = android_get_control_socket(kSocketName);
+    if (listen_fd_ < 0 || listen(listen_fd_, 4) < 0) {
+        PLOG(ERROR) << "Failed to listen on " << kSocketName;
+        return false;
+    }
+
+    for (int fd : {event_fd_.get(), fall_fd_.get(), listen_fd_}) {
+        struct epoll_event ev = {};
+        ev.events = EPOLLIN;
+        ev.data.fd = fd;
+        if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &ev) < 0) {
+            PLOG(ERROR) << "Failed to add fd to epoll";
+            return false;
+        }
+    }
+
+    callback_ = new MotorCallback(event_fd_);
+    Return<void> ret = hal->setMotorCallback(callback_);
+    if (!ret.isOk()) {
+        LOG(ERROR) << "Failed to register motor callback: " << ret.description();
+        return false;
+    }
+
+    // The camera still works without it, it just isn't protected.
+    has_free_fall_ = initFreeFall();
+    if (!has_free_fall_) {
+        LOG(ERROR) << "Free fall sensor is not available";
+    }
+
+    motor_ = std::make_unique<HidlMotor>(hal);
+    orchestrator_ = std::make_unique<Orchestrator>(*motor_, *this);
+    orchestrator_->start(NowMs());
+    return true;
+}
+
+// The sensor queue is served by its own thread, which inherits SCHED_FIFO
+// and only hands the fall over to the main loop.
+bool Daemon::initFreeFall() {
+    std::promise<bool> ready;
+    std::future<bool> initialized = ready.get_future();
+
+    std::thread([this, &ready] {
+        ALooper* looper = ALooper_prepare(0);
+        if (!sensor_.init(looper, &Daemon::onSensorEvents, this)) {
+            ready.set_value(false);
+            return;
+        }
+        ready.set_value(true);
+        while (true) {
+            ALooper_pollOnce(-1, nullptr, nullptr, nullptr);
+        }
+    }).detach();
+
+    return initialized.get();
+}
+
+int Daemon::onSensorEvents(int /* fd */, int /* events */, void* data) {
+    Daemon* daemon = static_cast<Daemon*>(data);
+    daemon->free_fall_.poll([daemon](int64_t fallNs) {
+        {
+            std::lock_guard<std::mutex> lock(daemon->falls_lock_);
+            daemon->falls_.push_back(fallNs);
+        }
+        uint64_t one = 1;
+        TEMP_FAILURE_RETRY(write(daemon->fall_fd_, &one, sizeof(one)));
+    });
+    return 1;
+}
+
+void Daemon::run() {
+    struct epoll_event events[kMaxEvents];
+
+    while (true) {
+        int timeout = -1;
+        int64_t deadline = orchestrator_->nextDeadlineMs();
+        if (deadline >= 0) {
+            timeout = std::max<int64_t>(0, deadline - NowMs());
+        }
+
+        int nevents = TEMP_FAILURE_RETRY(epoll_wait(epoll_fd_, events, kMaxEvents, timeout));
+        if (nevents < 0) {
+            PLOG(ERROR) << "epoll_wait failed";
+            continue;
+        }
+
+        for (int i = 0; i < nevents; i++) {
+            int fd = events[i].data.fd;
+            if (fd == event_fd_) {
+                uint64_t count;
+                TEMP_FAILURE_RETRY(read(event_fd_, &count, sizeof(count)));
+                for (int32_t status : callback_->drain()) {
+                    orchestrator_->onMotorStatus(status, NowMs());
+                }
+            } else if (fd == fall_fd_) {
+                uint64_t count;
+                TEMP_FAILURE_RETRY(read(fall_fd_, &count, sizeof(count)));
+                std::deque<int64_t> falls;
+                {
+                    std::lock_guard<std::mutex> lock(falls_lock_);
+                    falls.swap(falls_);
+                }
+                for (int64_t fallNs : falls) {
+                    handleDrop(fallNs);
+                }
+            } else if (fd == listen_fd_) {
+                acceptClient();
+            } else {
+                readClient(fd);
+            }
+        }
+
+        deadline = orchestrator_->nextDeadlineMs();
+        if (deadline >= 0 && NowMs() >= deadline) {
+            orchestrator_->onTimeout(NowMs());
+        }
+    }
+}
+
+void Daemon::setLed(uint32_t color) {
+    if (lights_ == nullptr) {
+        ndk::SpAIBinder binder(AServiceManager_checkService(kLightsInstance));
+        lights_ = ILights::fromBinder(binder);
+        if (lights_ == nullptr) {
+            LOG(WARNING) << "Lights HAL is not available";
+            return;
+        }
+    }
+
+    HwLightState state;
+    state.color = color;
+    if (!lights_->setLightState(kPopupCameraLightId, state).isOk()) {
+        LOG(ERROR) << "Failed to set popup camera light";
+        lights_ = nullptr;
+    }
+}
+
+// Never blocks, this runs on the SCHED_FIFO main loop. A client whose
+// socket buffer is full has stopped reading and is dropped.
+void Daemon::notify(const std::string& event) {
+    std::string line = event + "\n";
+    for (auto& [fd, client] : clients_) {
+        if (client.dead) {
+            continue;
+        }
+        ssize_t sent = TEMP_FAILURE_RETRY(
+                send(fd, line.data(), line.size(), MSG_NOSIGNAL | MSG_DONTWAIT));
+        if (sent != static_cast<ssize_t>(line.size())) {
+            LOG(WARNING) << "Dropping client which is not keeping up";
+            // A request in flight may still reference the client, let the
+            // main loop drop it once it sees the hangup.
+            client.dead = true;
+            shutdown(fd, SHUT_RDWR);
+        }
+    }
+}
+
+void Daemon::watchFreeFall(bool enable) {
+    if (!has_free_fall_) {
+        return;
+    }
+    if (enable) {
+        free_fall_.start();
+    } else {
+        free_fall_.stop();
+    }
+}
+
+void Daemon::acceptClient() {
+    unique_fd fd(TEMP_FAILURE_RETRY(accept4(listen_fd_, nullptr, nullptr, SOCK_CLOEXEC)));
+    if (fd < 0) {
+        PLOG(ERROR) << "accept failed";
+        return;
+    }
+
+    struct epoll_event ev = {};
+    ev.events = EPOLLIN;
+    ev.data.fd = fd;
+    if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &ev) < 0) {
+        PLOG(ERROR) << "Failed to add client to epoll";
+        return;
+    }
+
+    int raw = fd.get();
+    clients_[raw].fd = std::move(fd);
+}
+
+void Daemon::readClient(int fd) {
+    auto it = clients_.find(fd);
+    if (it == clients_.end()) {
+        return;
+    }
+
+    char buf[128];
+    ssize_t len = TEMP_FAILURE_RETRY(read(fd, buf, sizeof(buf)));
+    if (len <= 0) {
+        dropClient(fd);
+        return;
+    }
+
+    std::string& buffer = it->second.buffer;
+    buffer.append(buf, len);
+
+    size_t eol;
+    while ((eol = buffer.find('\n')) != std::string::npos) {
+        std::string line = buffer.substr(0, eol);
+        buffer.erase(0, eol + 1);
+        handleLine(line);
+    }
+
+    if (buffer.size() > kMaxRequestLength) {
+        LOG(ERROR) << "Dropping client with oversized request";
+        dropClient(fd);
+    }
+}
+
+// Requests are "<request> [led]", led being 1 when the client wants the
+// light effect to go along with the motion. "drop" may carry the sensor event
+// timestamp instead.
+void Daemon::handleLine(const std::string& line) {
+    std::vector<std::string> args = Split(line, " ");
+    Request req;
+    if (!ParseRequest(args[0], &req)) {
+        LOG(ERROR) << "Unknown request: " << line;
+        return;
+    }
+
+    if (req == Request::DROP) {
+        int64_t eventNs;
+        handleDrop(args.size() > 1 && ParseInt(args[1], &eventNs) ? eventNs : -1);
+        return;
+    }
+
+    bool led = args.size() > 1 && args[1] == "1";
+    orchestrator_->request(req, led, NowMs());
+}
+
+// eventNs is the sensor event timestamp, -1 if unknown.
+void Daemon::handleDrop(int64_t eventNs) {
+    orchestrator_->request(Request::DROP, false, NowMs());
+
+    if (eventNs >= 0) {
+        int64_t latencyUs = (BootTimeNs() - eventNs) / 1000;
+        drop_latency_.record(latencyUs);
+        LOG(INFO) << "free fall takeback latency=" << latencyUs
+                  << "us histogram: " << drop_latency_.toString();
+    }
+}
+
+void Daemon::dropClient(int fd) {
+    epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, fd, nullptr);
+    clients_.erase(fd);
+}
+
+}  // anonymous namespace
+
+int main() {
+    configureRpcThreadpool(1, true /* callerWillJoin */);
+    std::thread([] { joinRpcThreadpool(); }).detach();
+
+    // The binder thread only queues callbacks, the drop request is handled
+    // straight from the main loop.
+    struct sched_param param = {.sched_priority = kSchedFifoPriority};
+    if (sched_setscheduler(0, SCHED_FIFO, &param) < 0) {
+        PLOG(WARNING) << "Failed to switch to SCHED_FIFO";
+    }
+
+    Daemon daemon;
+    if (!daemon.init()) {
+        return 1;
+    }
+
+    daemon.run();
+    return 1;  // should never get here
+}
@@ -0,0 +1,145 @@
+/*
+ * Copyright (C) 2021 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <deque>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "FreeFall.h"
+
+namespace popupcamera {
+namespace {
+
+constexpr int32_t kAccelerometer = 1;
+
+// Stands in for the sensor service. Like the real queue, events keep
+// arriving until the sensor is turned off.
+class FakeSensorSource : public SensorSource {
+  public:
+    bool enable() override {
+        enables++;
+        enabled = true;
+        return true;
+    }
+    void disable() override {
+        disables++;
+        enabled = false;
+    }
+    size_t read(SensorSample* out, size_t max) override {
+        size_t count = 0;
+        while (count < max && !pending.empty()) {
+            out[count++] = pending.front();
+            pending.pop_front();
+        }
+        return count;
+    }
+
+    bool enabled = false;
+    int enables = 0;
+    int disables = 0;
+    std::deque<SensorSample> pending;
+};
+
+class FreeFallTest : public ::testing::Test {
+  protected:
+    FreeFallTest() : watcher_(source_) {}
+
+    // What the looper callback does once events are queued.
+    void deliver(std::vector<SensorSample> samples) {
+        source_.pending.insert(source_.pending.end(), samples.begin(), samples.end());
+        watcher_.poll([this](int64_t fallNs) {
+            // The sensor has to be left alone until the camera is told.
+            EXPECT_TRUE(source_.enabled);
+            falls_.push_back(fallNs);
+        });
+    }
+
+    FakeSensorSource source_;
+    FreeFallWatcher watcher_;
+    std::vector<int64_t> falls_;
+};
+
+TEST_F(FreeFallTest, OnlyAFallIsReported) {
+    watcher_.start();
+    deliver({{kFreeFallSensorType, 100, 0.0f},
+             {kFreeFallSensorType, 200, 1.0f},
+             {kAccelerometer, 300, kFreeFallDetected}});
+
+    EXPECT_TRUE(falls_.empty());
+    EXPECT_TRUE(source_.enabled);
+}
+
+TEST_F(FreeFallTest, FirstFallTurnsTheSensorOff) {
+    watcher_.start();
+    deliver({{kFreeFallSensorType, 100, 0.0f},
+             {kFreeFallSensorType, 200, kFreeFallDetected},
+             {kFreeFallSensorType, 300, kFreeFallDetected}});
+    deliver({{kFreeFallSensorType, 400, kFreeFallDetected}});
+
+    EXPECT_EQ(falls_, std::vector<int64_t>({200}));
+    EXPECT_FALSE(source_.enabled);
+    EXPECT_EQ(source_.disables, 1);
+    EXPECT_TRUE(source_.pending.empty());
+}
+
+TEST_F(FreeFallTest, FallsAreIgnoredOnceStopped) {
+    watcher_.start();
+    watcher_.stop();
+    deliver({{kFreeFallSensorType, 100, kFreeFallDetected}});
+
+    EXPECT_TRUE(falls_.empty());
+    EXPECT_EQ(source_.disables, 1);
+}
+
+TEST_F(FreeFallTest, StaleFallDoesNotTriggerTheNextStart) {
+    // Queued before the stop, read only once the camera is out again.
+    source_.pending.push_back({kFreeFallSensorType, 100, kFreeFallDetected});
+    watcher_.start();
+    watcher_.stop();
+    deliver({});
+    watcher_.start();
+    deliver({{kFreeFallSensorType, 500, 0.0f}});
+
+    EXPECT_TRUE(falls_.empty());
+    EXPECT_TRUE(source_.enabled);
+}
+
+TEST_F(FreeFallTest, LongBurstIsFullyDrained) {
+    watcher_.start();
+    std::vector<SensorSample> burst;
+    for (int64_t ts = 0; ts < 3 * static_cast<int64_t>(FreeFallWatcher::kMaxSamples); ts++) {
+        burst.push_back({kFreeFallSensorType, ts, 0.0f});
+    }
+    burst.push_back({kFreeFallSensorType, 1000, kFreeFallDetected});
+    deliver(burst);
+
+    EXPECT_EQ(falls_, std::vector<int64_t>({1000}));
+    EXPECT_TRUE(source_.pending.empty());
+}
+
+TEST_F(FreeFallTest, RestartWatchesAgain) {
+    watcher_.start();
+    deliver({{kFreeFallSensorType, 100, kFreeFallDetected}});
+    watcher_.start();
+    deliver({{kFreeFallSensorType, 900, kFreeFallDetected}});
+
+    EXPECT_EQ(falls_, std::vector<int64_t>({100, 900}));
+    EXPECT_EQ(source_.enables, 2);
+}
+
+}  // namespace
+}  // namespace popupcamera
@@ -0,0 +1,217 @@
+/*
+ * Copyright (C) 2021 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "Orchestrator.h"
+
+namespace popupcamera {
+namespace {
+
+// Stands in for the vendor motor HAL. Motions only complete when the test
+// reports them, like the HAL callback would.
+class FakeMotor : public Motor {
+  public:
+    int32_t status() override { return status_; }
+    void popup() override { calls.push_back("popup"); }
+    void takeback() override { calls.push_back("takeback"); }
+    void takebackShortly() override { calls.push_back("takebackShortly"); }
+    void calibrate() override { calls.push_back("calibrate"); }
+
+    int32_t status_ = TAKEBACK_OK;
+    std::vector<std::string> calls;
+};
+
+class FakeEffects : public Effects {
+  public:
+    void setLed(uint32_t color) override { leds.push_back(color); }
+    void notify(const std::string& event) override { events.push_back(event); }
+    void watchFreeFall(bool enable) override { watching = enable; }
+
+    std::vector<uint32_t> leds;
+    std::vector<std::string> events;
+    bool watching = false;
+};
+
+class OrchestratorTest : public ::testing::Test {
+  protected:
+    OrchestratorTest() : orchestrator_(motor_, effects_) {}
+
+    // The HAL reached |status| and called back.
+    void report(int32_t status, int64_t nowMs) {
+        motor_.status_ = status;
+        orchestrator_.onMotorStatus(status, nowMs);
+    }
+
+    void raise(int64_t nowMs) {
+        orchestrator_.request(Request::RAISE, false, nowMs);
+        report(POPUP_OK, nowMs + 500);
+    }
+
+    FakeMotor motor_;
+    FakeEffects effects_;
+    Orchestrator orchestrator_;
+};
+
+using Calls = std::vector<std::string>;
+
+TEST_F(OrchestratorTest, RaiseRunsUntilTheHalReportsIt) {
+    orchestrator_.start(0);
+    orchestrator_.request(Request::RAISE, true, 10);
+
+    EXPECT_EQ(orchestrator_.position(), Position::RAISING);
+    EXPECT_EQ(motor_.calls, Calls({"popup"}));
+    EXPECT_EQ(effects_.events, Calls({"moving open"}));
+    EXPECT_TRUE(effects_.watching);
+    EXPECT_EQ(orchestrator_.nextDeadlineMs(), 10 + Orchestrator::kMotionTimeoutMs);
+
+    report(POPUP_OK, 400);
+
+    EXPECT_EQ(orchestrator_.position(), Position::OPEN);
+    EXPECT_EQ(effects_.leds, std::vector<uint32_t>({0xff00ff00, 0}));
+    EXPECT_EQ(orchestrator_.nextDeadlineMs(), -1);
+}
+
+TEST_F(OrchestratorTest, StartTakesBackALeftOutCamera) {
+    motor_.status_ = POPUP_OK;
+    orchestrator_.start(0);
+
+    EXPECT_EQ(orchestrator_.position(), Position::RETRACTING);
+    EXPECT_EQ(motor_.calls, Calls({"takeback"}));
+}
+
+TEST_F(OrchestratorTest, RequestsDuringAMotionAreCoalesced) {
+    orchestrator_.start(0);
+    orchestrator_.request(Request::RAISE, false, 0);
+    orchestrator_.request(Request::RETRACT, false, 100);
+    orchestrator_.request(Request::RAISE, false, 150);
+    orchestrator_.request(Request::RETRACT, false, 200);
+    report(POPUP_OK, 400);
+
+    EXPECT_EQ(orchestrator_.position(), Position::RETRACTING);
+    EXPECT_EQ(motor_.calls, Calls({"popup", "takeback"}));
+}
+
+TEST_F(OrchestratorTest, ReopenWhileSettlingKeepsTheCameraOut) {
+    orchestrator_.start(0);
+    raise(0);
+    orchestrator_.request(Request::RETRACT, false, 1000);
+
+    EXPECT_EQ(orchestrator_.nextDeadlineMs(), 1000 + Orchestrator::kRetractSettleMs);
+
+    orchestrator_.request(Request::RAISE, false, 1050);
+    orchestrator_.onTimeout(1000 + Orchestrator::kRetractSettleMs);
+
+    EXPECT_EQ(orchestrator_.position(), Position::OPEN);
+    EXPECT_EQ(motor_.calls, Calls({"popup"}));
+}
+
+TEST_F(OrchestratorTest, RetractWaitsForTheSettleDelay) {
+    orchestrator_.start(0);
+    raise(0);
+    orchestrator_.request(Request::RETRACT, false, 1000);
+    orchestrator_.onTimeout(1000 + Orchestrator::kRetractSettleMs);
+
+    EXPECT_EQ(motor_.calls, Calls({"popup", "takeback"}));
+    EXPECT_FALSE(effects_.watching);
+
+    report(TAKEBACK_OK, 1600);
+
+    EXPECT_EQ(orchestrator_.position(), Position::CLOSED);
+}
+
+TEST_F(OrchestratorTest, UnusedPreRaiseIsTakenBack) {
+    orchestrator_.start(0);
+    orchestrator_.request(Request::PRERAISE, false, 0);
+    report(POPUP_OK, 500);
+
+    EXPECT_EQ(orchestrator_.nextDeadlineMs(), Orchestrator::kPreRaiseHoldMs);
+
+    orchestrator_.onTimeout(Orchestrator::kPreRaiseHoldMs);
+
+    EXPECT_EQ(motor_.calls, Calls({"popup", "takeback"}));
+}
+
+TEST_F(OrchestratorTest, MissedCompletionResyncsWithTheHal) {
+    orchestrator_.start(0);
+    orchestrator_.request(Request::RAISE, false, 0);
+    // The motion finished but the callback got lost.
+    motor_.status_ = POPUP_OK;
+    orchestrator_.onTimeout(Orchestrator::kMotionTimeoutMs);
+
+    EXPECT_EQ(orchestrator_.position(), Position::OPEN);
+    EXPECT_EQ(orchestrator_.nextDeadlineMs(), -1);
+}
+
+TEST_F(OrchestratorTest, DropSkipsTheEffects) {
+    orchestrator_.start(0);
+    orchestrator_.request(Request::RAISE, true, 0);
+    report(POPUP_OK, 500);
+    size_t leds = effects_.leds.size();
+
+    orchestrator_.request(Request::DROP, true, 1000);
+
+    EXPECT_EQ(orchestrator_.position(), Position::RETRACTING);
+    EXPECT_EQ(motor_.calls, Calls({"popup", "takebackShortly"}));
+    EXPECT_EQ(effects_.leds.size(), leds);
+    EXPECT_EQ(effects_.events, Calls({"moving open", "dropped"}));
+}
+
+TEST_F(OrchestratorTest, DropOfAClosedCameraIsIgnored) {
+    orchestrator_.start(0);
+    orchestrator_.request(Request::DROP, false, 0);
+
+    EXPECT_TRUE(motor_.calls.empty());
+    EXPECT_TRUE(effects_.events.empty());
+}
+
+TEST_F(OrchestratorTest, JammedCameraStaysPut) {
+    orchestrator_.start(0);
+    orchestrator_.request(Request::RAISE, false, 0);
+    report(POPUP_JAMMED, 800);
+
+    EXPECT_EQ(orchestrator_.position(), Position::ERROR);
+    EXPECT_EQ(effects_.events, Calls({"moving open", "status 12"}));
+
+    orchestrator_.request(Request::RAISE, false, 2000);
+
+    EXPECT_EQ(motor_.calls, Calls({"popup"}));
+    EXPECT_EQ(effects_.events, Calls({"moving open", "status 12", "status 12"}));
+}
+
+TEST_F(OrchestratorTest, PressedCameraIsTakenBack) {
+    orchestrator_.start(0);
+    raise(0);
+    orchestrator_.onMotorStatus(PRESSED, 1000);
+
+    EXPECT_EQ(motor_.calls, Calls({"popup", "takeback"}));
+    EXPECT_EQ(effects_.events.back(), "moving close");
+}
+
+TEST_F(OrchestratorTest, UnreachableHalDoesNotMove) {
+    motor_.status_ = -1;
+    orchestrator_.start(0);
+    orchestrator_.request(Request::RAISE, false, 0);
+
+    EXPECT_EQ(orchestrator_.position(), Position::UNKNOWN);
+    EXPECT_TRUE(motor_.calls.empty());
+}
+
+}  // namespace
+}  // namespace popupcamera
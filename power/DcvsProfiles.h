@@ -0,0 +1,207 @@
+/*
+ * Copyright (C) 2021 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <fcntl.h>
+
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <android-base/logging.h>
+#include <android-base/strings.h>
+
+#include "Sysfs.h"
+
+namespace aidl {
+namespace android {
+namespace hardware {
+namespace power {
+namespace impl {
+
+// Switches the memory latency and bandwidth governors set up by
+// init.qti.dcvs.sh and init.qcom.post_boot.sh between named profiles.
+class DcvsProfiles {
+  public:
+    // Ordered by priority, the highest active one is applied.
+    enum Profile { IDLE = 0, INTERACTIVE, SUSTAINED, GAMING, PROFILE_MAX };
+
+    static DcvsProfiles& getInstance() {
+        static DcvsProfiles* sInstance = new DcvsProfiles();
+        return *sInstance;
+    }
+
+    void setActive(Profile profile, bool active) {
+        std::lock_guard<std::mutex> lock(lock_);
+        if (active) {
+            active_ |= 1 << profile;
+        } else {
+            active_ &= ~(1 << profile);
+        }
+
+        Profile target = IDLE;
+        for (int p = PROFILE_MAX - 1; p > IDLE; p--) {
+            if (active_ & (1 << p)) {
+                target = static_cast<Profile>(p);
+                break;
+            }
+        }
+
+        if (target != current_) {
+            apply(target);
+        }
+    }
+
+  private:
+    struct Values {
+        // mem_latency devfreq nodes
+        int memlatPollingMs;
+        // ratio_ceil relative to the per node baseline, in percent
+        int memlatRatioPercent;
+        // bw_hwmon devfreq nodes, shared by the CPU to LLCC and the LLCC
+        // to DDR votes
+        int bwPollingMs;
+        int bwSampleMs;
+        // io_percent of the CPU to LLCC and of the LLCC to DDR vote, lower
+        // votes more bandwidth for the same traffic
+        int llccIoPercent;
+        int ddrIoPercent;
+    };
+
+    // INTERACTIVE matches the values written at boot.
+    static constexpr Values kProfiles[PROFILE_MAX] = {
+            {50, 50, 100, 10, 80, 90},  // IDLE
+            {10, 100, 40, 4, 50, 80},   // INTERACTIVE
+            {10, 100, 40, 8, 50, 80},   // SUSTAINED
+            {10, 150, 20, 4, 34, 54},   // GAMING
+    };
+
+    struct Attr {
+        ::sysfs::Node node;
+        int last = -1;
+    };
+
+    struct Node {
+        Attr polling;
+        Attr ratioCeil;
+        int ratioBase = 0;
+        Attr sampleMs;
+        Attr ioPercent;
+    };
+
+    // Starts from the value in place, so the first switch only writes what
+    // it changes.
+    void openAttr(Attr* attr, const std::string& path) {
+        if (attr->node.open(path, O_RDWR) && !attr->node.read(&attr->last)) {
+            attr->last = -1;
+        }
+    }
+
+    // Nodes are only looked up once, on the first profile switch, so that
+    // init.qti.dcvs.sh has already set up the governors.
+    void discover() {
+        discovered_ = true;
+
+        for (auto& path : ::sysfs::Glob("/sys/devices/platform/soc/*cpu*-lat/devfreq/*cpu*-lat")) {
+            Node node;
+            openAttr(&node.polling, path + "/polling_interval");
+            openAttr(&node.ratioCeil, path + "/mem_latency/ratio_ceil");
+            // Mirrors the per node ratio_ceil overrides in init.qti.dcvs.sh.
+            if (::android::base::EndsWith(path, "cpu4-cpu-l3-lat")) {
+                node.ratioBase = 4000;
+            } else if (::android::base::EndsWith(path, "cpu7-cpu-l3-lat")) {
+                node.ratioBase = 20000;
+            } else {
+                node.ratioBase = 400;
+            }
+            memlat_.push_back(std::move(node));
+        }
+
+        discoverBw("*cpu-cpu-llcc-bw", &llcc_bw_);
+        discoverBw("*cpu-llcc-ddr-bw", &ddr_bw_);
+
+        LOG(INFO) << "DCVS: found " << memlat_.size() << " memlat, " << llcc_bw_.size()
+                  << " LLCC and " << ddr_bw_.size() << " DDR bw_hwmon nodes";
+    }
+
+    void discoverBw(const std::string& name, std::vector<Node>* nodes) {
+        for (auto& path :
+             ::sysfs::Glob("/sys/devices/platform/soc/" + name + "/devfreq/" + name)) {
+            Node node;
+            openAttr(&node.polling, path + "/polling_interval");
+            openAttr(&node.sampleMs, path + "/bw_hwmon/sample_ms");
+            openAttr(&node.ioPercent, path + "/bw_hwmon/io_percent");
+            nodes->push_back(std::move(node));
+        }
+    }
+
+    void queue(Attr* attr, int value) {
+        if (attr->node.valid() && attr->last != value) {
+            pending_.emplace_back(attr, value);
+        }
+    }
+
+    void apply(Profile profile) {
+        if (!discovered_) {
+            discover();
+        }
+
+        const Values& v = kProfiles[profile];
+        for (auto& node : memlat_) {
+            queue(&node.polling, v.memlatPollingMs);
+            queue(&node.ratioCeil, node.ratioBase * v.memlatRatioPercent / 100);
+        }
+        for (auto& node : llcc_bw_) {
+            queue(&node.sampleMs, v.bwSampleMs);
+            queue(&node.ioPercent, v.llccIoPercent);
+            queue(&node.polling, v.bwPollingMs);
+        }
+        for (auto& node : ddr_bw_) {
+            queue(&node.sampleMs, v.bwSampleMs);
+            queue(&node.ioPercent, v.ddrIoPercent);
+            queue(&node.polling, v.bwPollingMs);
+        }
+
+        // Flush the whole switch in one go, skipping values already in place.
+        for (auto& [attr, value] : pending_) {
+            if (!attr->node.write(value)) {
+                continue;
+            }
+            attr->last = value;
+        }
+
+        LOG(DEBUG) << "DCVS: profile " << current_ << " -> " << profile << ", "
+                   << pending_.size() << " writes";
+        pending_.clear();
+        current_ = profile;
+    }
+
+    std::mutex lock_;
+    bool discovered_ = false;
+    unsigned int active_ = 1 << INTERACTIVE;
+    Profile current_ = INTERACTIVE;
+    std::vector<Node> memlat_;
+    std::vector<Node> llcc_bw_;
+    std::vector<Node> ddr_bw_;
+    std::vector<std::pair<Attr*, int>> pending_;
+};
+
+}  // namespace impl
+}  // namespace power
+}  // namespace hardware
+}  // namespace android
+}  // namespace aidl
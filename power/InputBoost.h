@@ -0,0 +1,351 @@
+/*
+ * Copyright (C) 2021 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <fcntl.h>
+#include <linux/input.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/ioctl.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include <android-base/logging.h>
+#include <android-base/macros.h>
+#include <android-base/unique_fd.h>
+
+#include "Sysfs.h"
+
+namespace aidl {
+namespace android {
+namespace hardware {
+namespace power {
+namespace impl {
+
+static constexpr const char* kTouchscreenPath = "/dev/input/event3";
+
+// Sized and timed per touch gesture, replaces the fixed cpu_boost input boost.
+class InputBoost {
+  public:
+    enum Gesture { TAP = 0, SCROLL, FLING, GESTURE_MAX };
+
+    static InputBoost& getInstance() {
+        static InputBoost* sInstance = new InputBoost();
+        return *sInstance;
+    }
+
+    // Starts the controller thread, only the first call does anything.
+    void start() {
+        std::call_once(started_, [this] { std::thread([this] { loop(); }).detach(); });
+    }
+
+    void setInteractive(bool interactive) { interactive_ = interactive; }
+
+  private:
+    static constexpr const char* kDisplayIdlePath = "/sys/class/drm/card0/device/idle_state";
+    static constexpr const char* kPolicyPaths[] = {
+            "/sys/devices/system/cpu/cpufreq/policy0",
+            "/sys/devices/system/cpu/cpufreq/policy4",
+            "/sys/devices/system/cpu/cpufreq/policy7",
+    };
+    static constexpr int kNumPolicies = arraysize(kPolicyPaths);
+
+    // Minimum frequency in kHz each policy goes back to after a boost, the
+    // one init.qcom.post_boot.sh sets, or 0 for the cpuinfo minimum. It is
+    // never read back from scaling_min_freq, which includes whatever the
+    // perf HAL is holding at that moment.
+    static constexpr unsigned int kBaseFreqs[kNumPolicies] = {576000, 0, 0};
+
+    struct Profile {
+        // Minimum frequency in kHz per policy, 0 leaves the policy at its
+        // base frequency.
+        unsigned int freq[kNumPolicies];
+        // How long the boost is held once the finger is lifted, unless the
+        // display goes idle first.
+        int tailMs;
+    };
+
+    static constexpr Profile kProfiles[GESTURE_MAX] = {
+            {{1324800, 0, 0}, 100},        // TAP
+            {{1324800, 1286400, 0}, 200},  // SCROLL
+            {{1574400, 1612800, 0}, 1000}, // FLING
+    };
+
+    // Movement beyond this fraction of the axis range turns a tap into a scroll.
+    static constexpr float kTouchSlop = 0.02f;
+    // Release velocity, in axis ranges per second, above which a scroll is a fling.
+    static constexpr float kFlingVelocity = 0.75f;
+    // Window over which the release velocity is measured.
+    static constexpr int64_t kVelocityWindowUs = 50000;
+
+    InputBoost() = default;
+
+    static int64_t toUs(const struct timeval& tv) { return tv.tv_sec * 1000000LL + tv.tv_usec; }
+
+    bool init() {
+        touch_fd_.reset(open((::sysfs::Root() + kTouchscreenPath).c_str(),
+                             O_RDONLY | O_NONBLOCK | O_CLOEXEC));
+        if (touch_fd_ < 0) {
+            PLOG(ERROR) << "Failed to open " << kTouchscreenPath;
+            return false;
+        }
+
+        struct input_absinfo absinfo;
+        for (int axis = 0; axis < 2; axis++) {
+            if (ioctl(touch_fd_, EVIOCGABS(ABS_MT_POSITION_X + axis), &absinfo) == 0 &&
+                absinfo.maximum > absinfo.minimum) {
+                range_[axis] = absinfo.maximum - absinfo.minimum;
+            }
+        }
+
+        for (int i = 0; i < kNumPolicies; i++) {
+            std::string dir = kPolicyPaths[i];
+            base_freq_[i] = kBaseFreqs[i];
+            if (!min_freq_[i].open(dir + "/scaling_min_freq", O_WRONLY) ||
+                (base_freq_[i] == 0 &&
+                 !::sysfs::ReadValue(dir + "/cpuinfo_min_freq", &base_freq_[i]))) {
+                min_freq_[i] = ::sysfs::Node();
+                continue;
+            }
+            cur_freq_[i] = base_freq_[i];
+        }
+
+        timer_fd_.reset(timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC));
+        epoll_fd_.reset(epoll_create1(EPOLL_CLOEXEC));
+        if (timer_fd_ < 0 || epoll_fd_ < 0) {
+            PLOG(ERROR) << "Failed to create timer or epoll fd";
+            return false;
+        }
+
+        addToEpoll(touch_fd_, EPOLLIN);
+        addToEpoll(timer_fd_, EPOLLIN);
+
+        // Display idle notifications are optional, without them boosts run
+        // for their full duration.
+        if (idle_.openOptional(kDisplayIdlePath, O_RDONLY)) {
+            displayIdle();
+            addToEpoll(idle_.fd(), EPOLLPRI);
+        }
+
+        return true;
+    }
+
+    void addToEpoll(int fd, uint32_t events) {
+        struct epoll_event ev = {};
+        ev.events = events;
+        ev.data.fd = fd;
+        if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &ev) < 0) {
+            PLOG(ERROR) << "Failed to add fd to epoll";
+        }
+    }
+
+    void loop() {
+        if (!init()) {
+            return;
+        }
+
+        struct epoll_event events[3];
+        while (true) {
+            int nevents = TEMP_FAILURE_RETRY(epoll_wait(epoll_fd_, events, 3, -1));
+            for (int i = 0; i < nevents; i++) {
+                if (events[i].data.fd == touch_fd_) {
+                    readTouch();
+                } else if (events[i].data.fd == timer_fd_) {
+                    uint64_t expirations;
+                    read(timer_fd_, &expirations, sizeof(expirations));
+                    endBoost();
+                } else if (events[i].data.fd == idle_.fd()) {
+                    if (displayIdle() && !down_ && boosting_) {
+                        endBoost();
+                    }
+                }
+            }
+        }
+    }
+
+    bool displayIdle() {
+        std::string state;
+        return idle_.read(&state) && state == "idle";
+    }
+
+    void readTouch() {
+        struct input_event evs[64];
+        ssize_t len;
+        while ((len = read(touch_fd_, evs, sizeof(evs))) > 0) {
+            for (size_t i = 0; i < len / sizeof(evs[0]); i++) {
+                handleEvent(evs[i]);
+            }
+        }
+    }
+
+    void handleEvent(const struct input_event& ev) {
+        if (ev.type == EV_KEY && ev.code == BTN_TOUCH) {
+            if (ev.value) {
+                onDown(toUs(ev.time));
+            } else {
+                onUp(toUs(ev.time));
+            }
+        } else if (ev.type == EV_ABS &&
+                   (ev.code == ABS_MT_POSITION_X || ev.code == ABS_MT_POSITION_Y)) {
+            pos_[ev.code - ABS_MT_POSITION_X] = ev.value;
+        } else if (ev.type == EV_SYN && ev.code == SYN_REPORT && down_) {
+            onFrame(toUs(ev.time));
+        }
+    }
+
+    void onDown(int64_t timeUs) {
+        down_ = true;
+        have_origin_ = false;
+        window_start_us_ = timeUs;
+        if (interactive_) {
+            startBoost(TAP, 0);
+        }
+    }
+
+    void onFrame(int64_t timeUs) {
+        last_frame_us_ = timeUs;
+        if (!have_origin_) {
+            // First report after touch down carries the initial position.
+            for (int axis = 0; axis < 2; axis++) {
+                origin_[axis] = window_pos_[axis] = pos_[axis];
+            }
+            window_start_us_ = timeUs;
+            have_origin_ = true;
+            return;
+        }
+
+        if (timeUs - window_start_us_ > kVelocityWindowUs) {
+            for (int axis = 0; axis < 2; axis++) {
+                velocity_[axis] = (pos_[axis] - window_pos_[axis]) * 1e6f /
+                                  (range_[axis] * (timeUs - window_start_us_));
+                window_pos_[axis] = pos_[axis];
+            }
+            window_start_us_ = timeUs;
+        }
+
+        if (gesture_ == TAP && boosting_ && movedBeyondSlop()) {
+            startBoost(SCROLL, 0);
+        }
+    }
+
+    void onUp(int64_t timeUs) {
+        down_ = false;
+        if (!boosting_) {
+            return;
+        }
+
+        // The controller stops reporting while the finger rests, a velocity
+        // measured before that is stale.
+        if (timeUs - last_frame_us_ > kVelocityWindowUs) {
+            velocity_[0] = velocity_[1] = 0;
+        }
+
+        if (gesture_ == SCROLL && (fabsf(velocity_[0]) > kFlingVelocity ||
+                                   fabsf(velocity_[1]) > kFlingVelocity)) {
+            startBoost(FLING, kProfiles[FLING].tailMs);
+        } else {
+            armTimer(kProfiles[gesture_].tailMs);
+        }
+        velocity_[0] = velocity_[1] = 0;
+    }
+
+    bool movedBeyondSlop() const {
+        for (int axis = 0; axis < 2; axis++) {
+            if (abs(pos_[axis] - origin_[axis]) > kTouchSlop * range_[axis]) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Boosts are held while the finger is down, durationMs of 0 waits for touch up.
+    void startBoost(Gesture gesture, int durationMs) {
+        gesture_ = gesture;
+        boosting_ = true;
+        for (int i = 0; i < kNumPolicies; i++) {
+            writeMinFreq(i, std::max(kProfiles[gesture].freq[i], base_freq_[i]));
+        }
+        armTimer(durationMs);
+    }
+
+    void endBoost() {
+        if (!boosting_) {
+            return;
+        }
+        boosting_ = false;
+        armTimer(0);
+        for (int i = 0; i < kNumPolicies; i++) {
+            writeMinFreq(i, base_freq_[i]);
+        }
+    }
+
+    void armTimer(int ms) {
+        struct itimerspec spec = {};
+        spec.it_value.tv_sec = ms / 1000;
+        spec.it_value.tv_nsec = (ms % 1000) * 1000000L;
+        timerfd_settime(timer_fd_, 0, &spec, nullptr);
+    }
+
+    void writeMinFreq(int policy, unsigned int freq) {
+        if (!min_freq_[policy].valid() || cur_freq_[policy] == freq) {
+            return;
+        }
+
+        if (!min_freq_[policy].write(freq)) {
+            return;
+        }
+        cur_freq_[policy] = freq;
+    }
+
+    std::once_flag started_;
+    std::atomic<bool> interactive_{true};
+
+    ::android::base::unique_fd touch_fd_;
+    ::sysfs::Node idle_;
+    ::android::base::unique_fd timer_fd_;
+    ::android::base::unique_fd epoll_fd_;
+    ::sysfs::Node min_freq_[kNumPolicies];
+    unsigned int cur_freq_[kNumPolicies] = {};
+    // Minimum frequency of each policy outside of boosts.
+    unsigned int base_freq_[kNumPolicies] = {};
+
+    bool down_ = false;
+    bool boosting_ = false;
+    Gesture gesture_ = TAP;
+    bool have_origin_ = false;
+    int range_[2] = {1, 1};
+    int pos_[2] = {};
+    int origin_[2] = {};
+    int window_pos_[2] = {};
+    int64_t window_start_us_ = 0;
+    int64_t last_frame_us_ = 0;
+    float velocity_[2] = {};
+};
+
+}  // namespace impl
+}  // namespace power
+}  // namespace hardware
+}  // namespace android
+}  // namespace aidl
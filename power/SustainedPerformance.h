@@ -0,0 +1,280 @@
+/*
+ * Copyright (C) 2021 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <fcntl.h>
+#include <limits.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <android-base/logging.h>
+#include <android-base/macros.h>
+#include <android-base/strings.h>
+
+#include "Sysfs.h"
+
+namespace aidl {
+namespace android {
+namespace hardware {
+namespace power {
+namespace impl {
+
+// Proportional-integral controller turning the skin temperature into a
+// power budget between 0 (every cluster at its floor) and 1 (uncapped).
+class SkinPi {
+  public:
+    // Settles within a few minutes on the first order model of the
+    // chassis, without overshooting the target by more than a degree.
+    static constexpr float kKp = 0.08f;
+    static constexpr float kKi = 0.004f;
+
+    explicit SkinPi(float targetC) : target_c_(targetC) {}
+
+    // Starts uncapped, the integral winds down as the device heats up.
+    void reset() { integral_ = 1.0f; }
+
+    float update(float tempC, float dtS) {
+        float error = target_c_ - tempC;
+        float p = kKp * error;
+        float out = p + integral_;
+
+        // Only integrate while that doesn't push further into saturation,
+        // so a cool device doesn't bank a budget it can't spend.
+        if ((out < 1.0f || error < 0) && (out > 0.0f || error > 0)) {
+            integral_ = std::clamp(integral_ + kKi * error * dtS, 0.0f, 1.0f);
+        }
+        return std::clamp(p + integral_, 0.0f, 1.0f);
+    }
+
+  private:
+    float target_c_;
+    float integral_ = 1.0f;
+};
+
+// Caps the CPU clusters so the skin settles at a sustainable temperature
+// while SUSTAINED_PERFORMANCE is set, instead of running into the hard
+// thermal mitigation and bouncing off it.
+class SustainedPerformance {
+  public:
+    static SustainedPerformance& getInstance() {
+        static SustainedPerformance* sInstance = new SustainedPerformance();
+        return *sInstance;
+    }
+
+    void setActive(bool active) {
+        std::lock_guard<std::mutex> lock(lock_);
+        if (active == active_) {
+            return;
+        }
+        active_ = active;
+        if (active && !thread_started_) {
+            thread_started_ = true;
+            std::thread([this] { loop(); }).detach();
+        }
+        cv_.notify_all();
+    }
+
+  private:
+    static constexpr float kTargetC = 40.0f;
+    static constexpr int kPeriodMs = 1000;
+
+    // Skin thermistors in order of preference, by thermal zone type.
+    static constexpr const char* kSkinZones[] = {"quiet_therm", "skin-therm-usr",
+                                                 "xo-therm-usr", "xo-therm"};
+
+    // Caps set here are combined with the ones of thermal mitigation, the
+    // lowest wins, so neither has to know what the other one set.
+    static constexpr const char* kCpuMaxFreqPath =
+            "/sys/module/msm_performance/parameters/cpu_max_freq";
+    // What msm_performance reads as no cap.
+    static constexpr unsigned int kUncapped = UINT_MAX;
+
+    struct ClusterConfig {
+        const char* policy;
+        // First CPU of the policy, msm_performance caps whole policies by it.
+        int cpu;
+        // The cap never goes below this.
+        unsigned int floorKhz;
+        // The part of the budget over which the cluster goes from its floor
+        // to its maximum. The prime core is the first to give up clock, the
+        // silver cluster the last.
+        float budgetLow;
+        float budgetHigh;
+    };
+
+    static constexpr ClusterConfig kClusters[] = {
+            {"policy0", 0, 1209600, 0.0f, 0.3f},
+            {"policy4", 4, 1286400, 0.1f, 0.7f},
+            {"policy7", 7, 1286400, 0.4f, 1.0f},
+    };
+
+    struct Cluster {
+        const ClusterConfig* config;
+        std::vector<unsigned int> freqs;
+        unsigned int lastKhz = kUncapped;
+    };
+
+    SustainedPerformance() : pi_(kTargetC) {}
+
+    bool init() {
+        for (const auto& path : ::sysfs::Glob("/sys/class/thermal/thermal_zone*")) {
+            std::string type;
+            if (!::sysfs::ReadValue(path + "/type", &type)) {
+                continue;
+            }
+            for (size_t i = 0; i < arraysize(kSkinZones); i++) {
+                if (type == kSkinZones[i] && i < skin_rank_) {
+                    skin_rank_ = i;
+                    skin_.open(path + "/temp", O_RDONLY);
+                }
+            }
+        }
+        if (!skin_.valid()) {
+            LOG(ERROR) << "Sustained: no skin thermal zone";
+            return false;
+        }
+
+        if (!max_freq_.open(kCpuMaxFreqPath, O_WRONLY)) {
+            return false;
+        }
+
+        for (const auto& config : kClusters) {
+            std::string dir = std::string("/sys/devices/system/cpu/cpufreq/") + config.policy;
+            std::string freqs;
+            Cluster cluster;
+            cluster.config = &config;
+            if (!::sysfs::ReadValue(dir + "/scaling_available_frequencies", &freqs)) {
+                continue;
+            }
+            for (const auto& f : ::android::base::Split(freqs, " ")) {
+                if (!f.empty()) {
+                    cluster.freqs.push_back(strtoul(f.c_str(), nullptr, 10));
+                }
+            }
+            std::sort(cluster.freqs.begin(), cluster.freqs.end());
+            if (!cluster.freqs.empty()) {
+                clusters_.push_back(std::move(cluster));
+            }
+        }
+
+        LOG(INFO) << "Sustained: skin zone " << kSkinZones[skin_rank_] << ", "
+                  << clusters_.size() << " clusters";
+        return !clusters_.empty();
+    }
+
+    // Highest available frequency at or below the cluster's share of the budget.
+    static unsigned int capFor(const Cluster& cluster, float budget) {
+        const ClusterConfig& c = *cluster.config;
+        float share = std::clamp((budget - c.budgetLow) / (c.budgetHigh - c.budgetLow), 0.0f, 1.0f);
+        unsigned int floor = std::max(c.floorKhz, cluster.freqs.front());
+        unsigned int target = floor + share * (cluster.freqs.back() - floor);
+
+        auto it = std::upper_bound(cluster.freqs.begin(), cluster.freqs.end(), target);
+        return it == cluster.freqs.begin() ? cluster.freqs.front() : *(it - 1);
+    }
+
+    // Writes the caps of the clusters which changed, in one go.
+    void writeCaps(const std::vector<unsigned int>& caps) {
+        std::string value;
+        for (size_t i = 0; i < clusters_.size(); i++) {
+            if (caps[i] != clusters_[i].lastKhz) {
+                // msm_performance rejects a trailing separator.
+                value += (value.empty() ? "" : " ") + std::to_string(clusters_[i].config->cpu) +
+                         ":" + std::to_string(caps[i]);
+            }
+        }
+        if (value.empty() || !max_freq_.write(value)) {
+            return;
+        }
+        for (size_t i = 0; i < clusters_.size(); i++) {
+            clusters_[i].lastKhz = caps[i];
+        }
+    }
+
+    void apply(float budget) {
+        std::vector<unsigned int> caps;
+        for (const auto& cluster : clusters_) {
+            // A cluster with its full share isn't capped at all.
+            unsigned int khz = capFor(cluster, budget);
+            caps.push_back(khz == cluster.freqs.back() ? kUncapped : khz);
+        }
+        writeCaps(caps);
+    }
+
+    void restore() { writeCaps(std::vector<unsigned int>(clusters_.size(), kUncapped)); }
+
+    void waitActive() {
+        std::unique_lock<std::mutex> lock(lock_);
+        cv_.wait(lock, [this] { return active_; });
+    }
+
+    // Returns false once sustained mode ended.
+    bool sleepWhileActive() {
+        std::unique_lock<std::mutex> lock(lock_);
+        return !cv_.wait_for(lock, std::chrono::milliseconds(kPeriodMs),
+                             [this] { return !active_; });
+    }
+
+    // The lock only guards active_, none of the sysfs I/O is done under it
+    // so setActive() never waits for it.
+    void loop() {
+        if (!init()) {
+            return;
+        }
+
+        while (true) {
+            waitActive();
+            pi_.reset();
+            LOG(INFO) << "Sustained: start";
+
+            do {
+                int milliC;
+                if (skin_.read(&milliC)) {
+                    float budget = pi_.update(milliC / 1000.0f, kPeriodMs / 1000.0f);
+                    apply(budget);
+                    LOG(DEBUG) << "Sustained: skin " << milliC << " budget " << budget;
+                }
+            } while (sleepWhileActive());
+
+            restore();
+            LOG(INFO) << "Sustained: stop";
+        }
+    }
+
+    std::mutex lock_;
+    std::condition_variable cv_;
+    bool active_ = false;
+    bool thread_started_ = false;
+    SkinPi pi_;
+    ::sysfs::Node skin_;
+    ::sysfs::Node max_freq_;
+    size_t skin_rank_ = arraysize(kSkinZones);
+    std::vector<Cluster> clusters_;
+};
+
+}  // namespace impl
+}  // namespace power
+}  // namespace hardware
+}  // namespace android
+}  // namespace aidl
@@ -0,0 +1,22 @@
+/*
+ * Copyright (C) 2021 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+// power-mode.cpp is built by the power HAL's own Android.mk through
+// TARGET_POWERHAL_MODE_EXT, which has no way to add header_libs, so
+// libsysfs.raphael is included by its path in the tree.
+#include "../sysfs/include/sysfs/Node.h"
@@ -0,0 +1,130 @@
+/*
+ * Copyright (C) 2021 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <fcntl.h>
+#include <sys/ioctl.h>
+
+#include <mutex>
+#include <thread>
+
+#include <android-base/logging.h>
+#include <android-base/properties.h>
+#include <android-base/unique_fd.h>
+
+#include "Sysfs.h"
+
+namespace aidl {
+namespace android {
+namespace hardware {
+namespace power {
+namespace impl {
+
+// Raises the touch report rate while a game is on top, through the
+// xiaomi_touch control device.
+class TouchModes {
+  public:
+    // What asks for game mode, each holds one reference while set. Hardly
+    // any game sets the performance modes, apptuned tells us about the games
+    // it has a profile for.
+    enum Source { FIXED_PERFORMANCE = 0, SUSTAINED_PERFORMANCE, GAME_ON_TOP, SOURCE_MAX };
+
+    static TouchModes& getInstance() {
+        static TouchModes* sInstance = new TouchModes();
+        return *sInstance;
+    }
+
+    void setActive(Source source, bool active) {
+        std::lock_guard<std::mutex> lock(lock_);
+        // The framework repeats modes, only a change moves the count.
+        if (held_[source] == active) {
+            return;
+        }
+        held_[source] = active;
+        refs_ += active ? 1 : -1;
+        update();
+    }
+
+    // The panel drops back to normal mode when it is powered off, game mode
+    // is restored once it is back on.
+    void setInteractive(bool interactive) {
+        std::lock_guard<std::mutex> lock(lock_);
+        interactive_ = interactive;
+        if (!interactive) {
+            applied_ = false;
+        }
+        update();
+    }
+
+  private:
+    static constexpr const char* kTouchDevicePath = "/dev/xiaomi-touch";
+    static constexpr const char* kGameProperty = "vendor.apptune.game";
+
+    TouchModes() { std::thread(&TouchModes::followGame, this).detach(); }
+
+    void followGame() {
+        while (true) {
+            ::android::base::WaitForProperty(kGameProperty, "1");
+            setActive(GAME_ON_TOP, true);
+            ::android::base::WaitForProperty(kGameProperty, "0");
+            setActive(GAME_ON_TOP, false);
+        }
+    }
+
+    // From the xiaomi_touch driver.
+    static constexpr unsigned long kSetCurValue = _IO('T', 0);
+    static constexpr int kTouchGameMode = 0;
+
+    void update() {
+        bool game = interactive_ && refs_ > 0;
+        if (game == applied_) {
+            return;
+        }
+
+        if (fd_ < 0) {
+            fd_.reset(open((::sysfs::Root() + kTouchDevicePath).c_str(), O_RDWR | O_CLOEXEC));
+            if (fd_ < 0) {
+                PLOG(ERROR) << "Failed to open " << kTouchDevicePath;
+                return;
+            }
+        }
+
+        int arg[2] = {kTouchGameMode, game ? 1 : 0};
+        if (ioctl(fd_, kSetCurValue, &arg) < 0) {
+            PLOG(ERROR) << "Failed to " << (game ? "enter" : "leave") << " touch game mode";
+            // Reopened on the next change, in case the driver went away.
+            fd_.reset();
+            return;
+        }
+
+        LOG(DEBUG) << "Touch: game mode " << (game ? "on" : "off") << ", " << refs_ << " refs";
+        applied_ = game;
+    }
+
+    std::mutex lock_;
+    ::android::base::unique_fd fd_;
+    bool held_[SOURCE_MAX] = {};
+    int refs_ = 0;
+    bool interactive_ = true;
+    bool applied_ = false;
+};
+
+}  // namespace impl
+}  // namespace power
+}  // namespace hardware
+}  // namespace android
+}  // namespace aidl
@@ -16,8 +16,15 @@
 
 #include <aidl/android/hardware/power/BnPower.h>
 #include <android-base/file.h>
+#include <android-base/logging.h>
+#include <android-base/unique_fd.h>
 #include <linux/input.h>
 
+#include "DcvsProfiles.h"
+#include "InputBoost.h"
+#include "SustainedPerformance.h"
+#include "TouchModes.h"
+
 namespace aidl {
 namespace android {
 namespace hardware {
@@ -29,6 +36,13 @@ static constexpr int kInputEventWakeupModeOn = 5;
 
 using ::aidl::android::hardware::power::Mode;
 
+// The mode extension has no init hook of its own, so the touch boost
+// controller starts as the HAL service loads. Tests start it themselves once
+// their fake tree is in place.
+#ifndef POWER_MODE_NO_AUTOSTART
+static const bool sInputBoostStarted = (InputBoost::getInstance().start(), true);
+#endif
+
 bool isDeviceSpecificModeSupported(Mode type, bool* _aidl_return) {
     switch (type) {
         case Mode::DOUBLE_TAP_TO_WAKE:
@@ -42,15 +56,38 @@ bool isDeviceSpecificModeSupported(Mode type, bool* _aidl_return) {
 bool setDeviceSpecificMode(Mode type, bool enabled) {
     switch (type) {
         case Mode::DOUBLE_TAP_TO_WAKE: {
-            int fd = open("/dev/input/event3", O_RDWR);
-            struct input_event ev;
+            // Not a sysfs node, evdev does not support pwrite.
+            ::android::base::unique_fd fd(
+                    open((::sysfs::Root() + kTouchscreenPath).c_str(), O_RDWR | O_CLOEXEC));
+            if (fd < 0) {
+                PLOG(ERROR) << "Failed to open " << kTouchscreenPath;
+                return true;
+            }
+            struct input_event ev = {};
             ev.type = EV_SYN;
             ev.code = SYN_CONFIG;
             ev.value = enabled ? kInputEventWakeupModeOn : kInputEventWakeupModeOff;
-            write(fd, &ev, sizeof(ev));
-            close(fd);
-	    return true;
+            if (TEMP_FAILURE_RETRY(write(fd, &ev, sizeof(ev))) < 0) {
+                PLOG(ERROR) << "Failed to set double tap to wake";
+            }
+            return true;
         }
+        // The modes below are only observed, let the default implementation
+        // handle them as well.
+        case Mode::INTERACTIVE:
+            InputBoost::getInstance().setInteractive(enabled);
+            DcvsProfiles::getInstance().setActive(DcvsProfiles::INTERACTIVE, enabled);
+            TouchModes::getInstance().setInteractive(enabled);
+            return false;
+        case Mode::SUSTAINED_PERFORMANCE:
+            DcvsProfiles::getInstance().setActive(DcvsProfiles::SUSTAINED, enabled);
+            TouchModes::getInstance().setActive(TouchModes::SUSTAINED_PERFORMANCE, enabled);
+            SustainedPerformance::getInstance().setActive(enabled);
+            return false;
+        case Mode::FIXED_PERFORMANCE:
+            DcvsProfiles::getInstance().setActive(DcvsProfiles::GAMING, enabled);
+            TouchModes::getInstance().setActive(TouchModes::FIXED_PERFORMANCE, enabled);
+            return false;
         default:
             return false;
     }
@@ -0,0 +1,196 @@
+/*
+ * Copyright (C) 2021 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Replays a sequence of power hints against a fake devfreq tree laid out
+// like the sm8150 one, and checks the tunables and the writes issued after
+// every hint.
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include <sysfs/testing/FakeSysfs.h>
+
+#include "../DcvsProfiles.h"
+
+namespace aidl {
+namespace android {
+namespace hardware {
+namespace power {
+namespace impl {
+namespace {
+
+using sysfs::testing::FakeSysfs;
+
+constexpr const char* kSoc = "/sys/devices/platform/soc/soc:qcom,";
+
+// mem_latency nodes and their ratio_ceil at boot.
+const std::vector<std::pair<std::string, int>> kMemlat = {
+        {"cpu0-cpu-l3-lat", 400},     {"cpu4-cpu-l3-lat", 4000},    {"cpu7-cpu-l3-lat", 20000},
+        {"cpu0-cpu-llcc-lat", 400},   {"cpu4-cpu-llcc-lat", 400},   {"cpu0-llcc-ddr-lat", 400},
+        {"cpu4-llcc-ddr-lat", 400},
+};
+
+// Left alone, they are set up by other parts of init.qti.dcvs.sh.
+const std::vector<std::string> kOthers = {
+        "cdsp-cdsp-l3-lat",
+        "cpu4-cpu-ddr-latfloor",
+        "npu-npu-ddr-bw",
+};
+
+struct Expected {
+    int memlatPollingMs;
+    int ratioPercent;
+    int bwPollingMs;
+    int sampleMs;
+    int llccIoPercent;
+    int ddrIoPercent;
+};
+
+const std::map<DcvsProfiles::Profile, Expected> kExpected = {
+        {DcvsProfiles::IDLE, {50, 50, 100, 10, 80, 90}},
+        {DcvsProfiles::INTERACTIVE, {10, 100, 40, 4, 50, 80}},
+        {DcvsProfiles::SUSTAINED, {10, 100, 40, 8, 50, 80}},
+        {DcvsProfiles::GAMING, {10, 150, 20, 4, 34, 54}},
+};
+
+std::string DevfreqPath(const std::string& name) {
+    return kSoc + name + "/devfreq/soc:qcom," + name;
+}
+
+class DcvsProfilesTest : public ::testing::Test {
+  protected:
+    static void SetUpTestSuite() {
+        fake_ = new FakeSysfs();
+        for (const auto& [name, ratio] : kMemlat) {
+            fake_->add(DevfreqPath(name) + "/polling_interval", "10\n");
+            fake_->add(DevfreqPath(name) + "/mem_latency/ratio_ceil", std::to_string(ratio));
+        }
+        for (const char* name : {"cpu-cpu-llcc-bw", "cpu-llcc-ddr-bw"}) {
+            fake_->add(DevfreqPath(name) + "/polling_interval", "40\n");
+            fake_->add(DevfreqPath(name) + "/bw_hwmon/sample_ms", "4\n");
+        }
+        fake_->add(DevfreqPath("cpu-cpu-llcc-bw") + "/bw_hwmon/io_percent", "50\n");
+        fake_->add(DevfreqPath("cpu-llcc-ddr-bw") + "/bw_hwmon/io_percent", "80\n");
+        for (const auto& name : kOthers) {
+            fake_->add(DevfreqPath(name) + "/polling_interval", "10\n");
+        }
+    }
+
+    static void TearDownTestSuite() { delete fake_; }
+
+    std::map<std::string, std::string> snapshot() const {
+        std::map<std::string, std::string> values;
+        for (const auto& [name, ratio] : kMemlat) {
+            for (const char* attr : {"/polling_interval", "/mem_latency/ratio_ceil"}) {
+                values[DevfreqPath(name) + attr] = fake_->value(DevfreqPath(name) + attr);
+            }
+        }
+        for (const char* name : {"cpu-cpu-llcc-bw", "cpu-llcc-ddr-bw"}) {
+            for (const char* attr :
+                 {"/polling_interval", "/bw_hwmon/sample_ms", "/bw_hwmon/io_percent"}) {
+                values[DevfreqPath(name) + attr] = fake_->value(DevfreqPath(name) + attr);
+            }
+        }
+        return values;
+    }
+
+    void expectProfile(DcvsProfiles::Profile profile) const {
+        const Expected& e = kExpected.at(profile);
+        for (const auto& [name, ratio] : kMemlat) {
+            EXPECT_EQ(fake_->value(DevfreqPath(name) + "/polling_interval"),
+                      std::to_string(e.memlatPollingMs))
+                    << name;
+            EXPECT_EQ(fake_->value(DevfreqPath(name) + "/mem_latency/ratio_ceil"),
+                      std::to_string(ratio * e.ratioPercent / 100))
+                    << name;
+        }
+        for (const char* name : {"cpu-cpu-llcc-bw", "cpu-llcc-ddr-bw"}) {
+            EXPECT_EQ(fake_->value(DevfreqPath(name) + "/polling_interval"),
+                      std::to_string(e.bwPollingMs))
+                    << name;
+            EXPECT_EQ(fake_->value(DevfreqPath(name) + "/bw_hwmon/sample_ms"),
+                      std::to_string(e.sampleMs))
+                    << name;
+        }
+        EXPECT_EQ(fake_->value(DevfreqPath("cpu-cpu-llcc-bw") + "/bw_hwmon/io_percent"),
+                  std::to_string(e.llccIoPercent));
+        EXPECT_EQ(fake_->value(DevfreqPath("cpu-llcc-ddr-bw") + "/bw_hwmon/io_percent"),
+                  std::to_string(e.ddrIoPercent));
+        for (const auto& name : kOthers) {
+            EXPECT_EQ(fake_->value(DevfreqPath(name) + "/polling_interval"), "10") << name;
+        }
+    }
+
+    static FakeSysfs* fake_;
+};
+
+FakeSysfs* DcvsProfilesTest::fake_;
+
+TEST_F(DcvsProfilesTest, Replay) {
+    struct Step {
+        DcvsProfiles::Profile hint;
+        bool active;
+        DcvsProfiles::Profile expected;
+    };
+    // A game session: launched with the screen on, throttled into sustained
+    // mode, quit, then the screen goes off and back on.
+    const Step kTrace[] = {
+            {DcvsProfiles::INTERACTIVE, true, DcvsProfiles::INTERACTIVE},
+            {DcvsProfiles::GAMING, true, DcvsProfiles::GAMING},
+            {DcvsProfiles::SUSTAINED, true, DcvsProfiles::GAMING},
+            {DcvsProfiles::GAMING, false, DcvsProfiles::SUSTAINED},
+            {DcvsProfiles::SUSTAINED, true, DcvsProfiles::SUSTAINED},
+            {DcvsProfiles::SUSTAINED, false, DcvsProfiles::INTERACTIVE},
+            {DcvsProfiles::INTERACTIVE, false, DcvsProfiles::IDLE},
+            {DcvsProfiles::INTERACTIVE, false, DcvsProfiles::IDLE},
+            {DcvsProfiles::INTERACTIVE, true, DcvsProfiles::INTERACTIVE},
+    };
+
+    for (size_t i = 0; i < arraysize(kTrace); i++) {
+        SCOPED_TRACE("step " + std::to_string(i));
+        auto before = snapshot();
+        fake_->resetCounts();
+
+        DcvsProfiles::getInstance().setActive(kTrace[i].hint, kTrace[i].active);
+        expectProfile(kTrace[i].expected);
+
+        // Exactly one write per attribute that changed, in one batch.
+        auto after = snapshot();
+        size_t changed = 0;
+        for (const auto& [path, value] : after) {
+            changed += before[path] != value;
+        }
+        EXPECT_EQ(fake_->counts().writes, changed);
+        // Nodes are discovered, opened and read once, when the first switch
+        // happens.
+        if (i == 1) {
+            EXPECT_EQ(fake_->counts().opens, 20u);
+            EXPECT_EQ(fake_->counts().reads, 20u);
+        } else {
+            EXPECT_EQ(fake_->counts().opens, 0u);
+            EXPECT_EQ(fake_->counts().reads, 0u);
+        }
+    }
+}
+
+}  // namespace
+}  // namespace impl
+}  // namespace power
+}  // namespace hardware
+}  // namespace android
+}  // namespace aidl
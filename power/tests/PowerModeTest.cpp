@@ -0,0 +1,295 @@
+/*
+ * Copyright (C) 2021 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <linux/input.h>
+#include <string.h>
+
+#include <chrono>
+#include <functional>
+#include <thread>
+
+#include <aidl/android/hardware/power/BnPower.h>
+#include <gtest/gtest.h>
+#include <sysfs/testing/FakeSysfs.h>
+
+#include "../InputBoost.h"
+
+namespace aidl {
+namespace android {
+namespace hardware {
+namespace power {
+namespace impl {
+
+bool isDeviceSpecificModeSupported(Mode type, bool* _aidl_return);
+bool setDeviceSpecificMode(Mode type, bool enabled);
+
+namespace {
+
+using sysfs::testing::FakeSysfs;
+using sysfs::testing::IoCounts;
+using Writes = std::vector<std::string>;
+
+constexpr const char* kPolicy0MinFreq = "/sys/devices/system/cpu/cpufreq/policy0/scaling_min_freq";
+constexpr const char* kPolicy4MinFreq = "/sys/devices/system/cpu/cpufreq/policy4/scaling_min_freq";
+constexpr const char* kPolicy7MinFreq = "/sys/devices/system/cpu/cpufreq/policy7/scaling_min_freq";
+
+constexpr const char* kPolicy0MaxFreq = "/sys/devices/system/cpu/cpufreq/policy0/scaling_max_freq";
+constexpr const char* kPolicy4MaxFreq = "/sys/devices/system/cpu/cpufreq/policy4/scaling_max_freq";
+constexpr const char* kPolicy7MaxFreq = "/sys/devices/system/cpu/cpufreq/policy7/scaling_max_freq";
+constexpr const char* kCpuMaxFreq = "/sys/module/msm_performance/parameters/cpu_max_freq";
+constexpr const char* kSkinTemp = "/sys/class/thermal/thermal_zone1/temp";
+
+constexpr const char* kSilverLat =
+        "/sys/devices/platform/soc/soc:qcom,cpu0-cpu-l3-lat/devfreq/soc:qcom,cpu0-cpu-l3-lat";
+constexpr const char* kGoldLat =
+        "/sys/devices/platform/soc/soc:qcom,cpu4-cpu-l3-lat/devfreq/soc:qcom,cpu4-cpu-l3-lat";
+constexpr const char* kLlccBw =
+        "/sys/devices/platform/soc/soc:qcom,cpu-cpu-llcc-bw/devfreq/soc:qcom,cpu-cpu-llcc-bw";
+
+bool WaitFor(const std::function<bool()>& condition, int timeoutMs = 1000) {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+    while (!condition()) {
+        if (std::chrono::steady_clock::now() > deadline) {
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return true;
+}
+
+// The controllers are process wide singletons with threads of their own,
+// so they share one fake tree.
+class PowerEnvironment : public ::testing::Environment {
+  public:
+    void SetUp() override {
+        fake = new FakeSysfs();
+        fake->addFifo(kTouchscreenPath);
+        fake->add(kPolicy0MinFreq, "576000\n");
+        fake->add(kPolicy4MinFreq, "710400\n");
+        fake->add(kPolicy7MinFreq, "825600\n");
+        fake->add("/sys/devices/system/cpu/cpufreq/policy0/cpuinfo_min_freq", "300000\n");
+        fake->add("/sys/devices/system/cpu/cpufreq/policy4/cpuinfo_min_freq", "710400\n");
+        fake->add("/sys/devices/system/cpu/cpufreq/policy7/cpuinfo_min_freq", "825600\n");
+        fake->add("/sys/devices/system/cpu/cpufreq/policy0/scaling_available_frequencies",
+                  "300000 576000 1209600 1785600 \n");
+        fake->add("/sys/devices/system/cpu/cpufreq/policy4/scaling_available_frequencies",
+                  "710400 1286400 1804800 2419200 \n");
+        fake->add("/sys/devices/system/cpu/cpufreq/policy7/scaling_available_frequencies",
+                  "825600 1286400 1804800 2016000 2841600 \n");
+        fake->add(kPolicy0MaxFreq, "1785600\n");
+        fake->add(kPolicy4MaxFreq, "2419200\n");
+        fake->add(kPolicy7MaxFreq, "2841600\n");
+        fake->add(kCpuMaxFreq, "0:4294967295 1:4294967295 2:4294967295 3:4294967295 "
+                               "4:4294967295 5:4294967295 6:4294967295 7:4294967295\n");
+        fake->add("/sys/class/thermal/thermal_zone0/type", "cpu-0-0-usr\n");
+        fake->add("/sys/class/thermal/thermal_zone0/temp", "60000\n");
+        fake->add("/sys/class/thermal/thermal_zone1/type", "quiet_therm\n");
+        fake->add(kSkinTemp, "35000\n");
+        fake->add(std::string(kSilverLat) + "/polling_interval", "10\n");
+        fake->add(std::string(kSilverLat) + "/mem_latency/ratio_ceil", "400\n");
+        fake->add(std::string(kGoldLat) + "/polling_interval", "10\n");
+        fake->add(std::string(kGoldLat) + "/mem_latency/ratio_ceil", "4000\n");
+        fake->add(std::string(kLlccBw) + "/polling_interval", "40\n");
+        fake->add(std::string(kLlccBw) + "/bw_hwmon/sample_ms", "4\n");
+        fake->add(std::string(kLlccBw) + "/bw_hwmon/io_percent", "50\n");
+
+        InputBoost::getInstance().start();
+        // Wait for the input boost thread to open its nodes.
+        ASSERT_TRUE(WaitFor([] { return fake->counts(kPolicy7MinFreq).opens > 0; }));
+    }
+
+    static FakeSysfs* fake;
+};
+
+FakeSysfs* PowerEnvironment::fake;
+
+class PowerModeTest : public ::testing::Test {
+  protected:
+    void SetUp() override { fake_->resetCounts(); }
+
+    void event(int64_t timeUs, uint16_t type, uint16_t code, int32_t value) {
+        struct input_event ev = {};
+        ev.time.tv_sec = timeUs / 1000000;
+        ev.time.tv_usec = timeUs % 1000000;
+        ev.type = type;
+        ev.code = code;
+        ev.value = value;
+        fake_->feed(kTouchscreenPath, &ev, sizeof(ev));
+    }
+
+    // Waits for the input boost thread to handle everything fed so far.
+    void drain() {
+        ASSERT_TRUE(WaitFor([this] { return fake_->queued(kTouchscreenPath) == 0; }));
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    }
+
+    void touch(int64_t timeUs, int x, int y) {
+        event(timeUs, EV_ABS, ABS_MT_POSITION_X, x);
+        event(timeUs, EV_ABS, ABS_MT_POSITION_Y, y);
+        event(timeUs, EV_SYN, SYN_REPORT, 0);
+    }
+
+    FakeSysfs* fake_ = PowerEnvironment::fake;
+};
+
+TEST_F(PowerModeTest, DoubleTapToWake) {
+    bool supported = false;
+    ASSERT_TRUE(isDeviceSpecificModeSupported(Mode::DOUBLE_TAP_TO_WAKE, &supported));
+    ASSERT_TRUE(supported);
+    ASSERT_TRUE(setDeviceSpecificMode(Mode::DOUBLE_TAP_TO_WAKE, true));
+    Writes writes = fake_->writes(kTouchscreenPath);
+    ASSERT_EQ(writes.size(), 1u);
+    struct input_event ev;
+    ASSERT_EQ(writes[0].size(), sizeof(ev));
+    memcpy(&ev, writes[0].data(), sizeof(ev));
+    EXPECT_EQ(ev.type, EV_SYN);
+    EXPECT_EQ(ev.code, SYN_CONFIG);
+    EXPECT_EQ(ev.value, 5);
+}
+
+TEST_F(PowerModeTest, ObservedModesFallThrough) {
+    EXPECT_FALSE(setDeviceSpecificMode(Mode::INTERACTIVE, true));
+    EXPECT_FALSE(setDeviceSpecificMode(Mode::FIXED_PERFORMANCE, false));
+    EXPECT_FALSE(setDeviceSpecificMode(Mode::LAUNCH, true));
+}
+
+TEST_F(PowerModeTest, DcvsFollowsFixedPerformance) {
+    setDeviceSpecificMode(Mode::FIXED_PERFORMANCE, true);
+    EXPECT_EQ(fake_->value(std::string(kSilverLat) + "/mem_latency/ratio_ceil"), "600");
+    EXPECT_EQ(fake_->value(std::string(kGoldLat) + "/mem_latency/ratio_ceil"), "6000");
+    EXPECT_EQ(fake_->value(std::string(kLlccBw) + "/polling_interval"), "20");
+    EXPECT_EQ(fake_->value(std::string(kLlccBw) + "/bw_hwmon/io_percent"), "34");
+
+    // Repeated modes don't touch the nodes again.
+    fake_->resetCounts();
+    setDeviceSpecificMode(Mode::FIXED_PERFORMANCE, true);
+    EXPECT_EQ(fake_->counts(std::string(kLlccBw) + "/polling_interval"), IoCounts());
+
+    setDeviceSpecificMode(Mode::FIXED_PERFORMANCE, false);
+    EXPECT_EQ(fake_->value(std::string(kSilverLat) + "/mem_latency/ratio_ceil"), "400");
+    EXPECT_EQ(fake_->value(std::string(kGoldLat) + "/mem_latency/ratio_ceil"), "4000");
+    EXPECT_EQ(fake_->value(std::string(kLlccBw) + "/polling_interval"), "40");
+    EXPECT_EQ(fake_->value(std::string(kLlccBw) + "/bw_hwmon/io_percent"), "50");
+    // sample_ms is the same in both profiles.
+    EXPECT_EQ(fake_->writes(std::string(kLlccBw) + "/bw_hwmon/sample_ms"), Writes{});
+}
+
+TEST_F(PowerModeTest, SustainedLeavesThermalCapsAlone) {
+    // Thermal mitigation already holds the prime core back.
+    fake_->set(kPolicy7MaxFreq, "2016000\n");
+    fake_->set(kSkinTemp, "45000\n");
+
+    setDeviceSpecificMode(Mode::SUSTAINED_PERFORMANCE, true);
+    ASSERT_TRUE(WaitFor([this] { return fake_->writes(kCpuMaxFreq).size() == 1; }));
+    // The silver cluster keeps its clock until the budget runs low.
+    EXPECT_EQ(fake_->writes(kCpuMaxFreq), (Writes{"4:1804800 7:1286400"}));
+
+    setDeviceSpecificMode(Mode::SUSTAINED_PERFORMANCE, false);
+    ASSERT_TRUE(WaitFor([this] { return fake_->writes(kCpuMaxFreq).size() == 2; }));
+    EXPECT_EQ(fake_->writes(kCpuMaxFreq)[1], "4:4294967295 7:4294967295");
+
+    // Whatever thermal set is its own business, before and after.
+    EXPECT_EQ(fake_->writes(kPolicy0MaxFreq), Writes{});
+    EXPECT_EQ(fake_->writes(kPolicy4MaxFreq), Writes{});
+    EXPECT_EQ(fake_->writes(kPolicy7MaxFreq), Writes{});
+}
+
+TEST_F(PowerModeTest, TapBoostsTheSilverCluster) {
+    event(1000000, EV_KEY, BTN_TOUCH, 1);
+    touch(1000000, 500, 500);
+    ASSERT_TRUE(WaitFor([this] { return fake_->value(kPolicy0MinFreq) == "1324800"; }));
+    EXPECT_EQ(fake_->writes(kPolicy4MinFreq), Writes{});
+    EXPECT_EQ(fake_->writes(kPolicy7MinFreq), Writes{});
+
+    event(1050000, EV_KEY, BTN_TOUCH, 0);
+    event(1050000, EV_SYN, SYN_REPORT, 0);
+    // The minimum set by init.qcom.post_boot.sh comes back after the tail.
+    ASSERT_TRUE(WaitFor([this] { return fake_->writes(kPolicy0MinFreq).size() == 2; }));
+    EXPECT_EQ(fake_->writes(kPolicy0MinFreq), (Writes{"1324800", "576000"}));
+    EXPECT_EQ(fake_->value(kPolicy0MinFreq), "576000");
+}
+
+TEST_F(PowerModeTest, FlingBoostsUntilTheTailEnds) {
+    event(3000000, EV_KEY, BTN_TOUCH, 1);
+    touch(3000000, 500, 500);
+    for (int i = 1; i <= 10; i++) {
+        touch(3000000 + i * 8000, 500, 500 + i * 100);
+    }
+    event(3080000, EV_KEY, BTN_TOUCH, 0);
+    event(3080000, EV_SYN, SYN_REPORT, 0);
+
+    ASSERT_TRUE(WaitFor([this] { return fake_->value(kPolicy4MinFreq) == "1612800"; }));
+    EXPECT_EQ(fake_->value(kPolicy0MinFreq), "1574400");
+    // The prime core is left alone.
+    EXPECT_EQ(fake_->writes(kPolicy7MinFreq), Writes{});
+
+    ASSERT_TRUE(WaitFor([this] { return fake_->value(kPolicy4MinFreq) == "710400"; }, 2000));
+    EXPECT_EQ(fake_->value(kPolicy0MinFreq), "576000");
+}
+
+TEST_F(PowerModeTest, LiftAfterRestIsNoFling) {
+    event(4000000, EV_KEY, BTN_TOUCH, 1);
+    touch(4000000, 500, 500);
+    for (int i = 1; i <= 10; i++) {
+        touch(4000000 + i * 8000, 500, 500 + i * 100);
+    }
+    // The finger rests for 200ms before it is lifted.
+    event(4280000, EV_KEY, BTN_TOUCH, 0);
+    event(4280000, EV_SYN, SYN_REPORT, 0);
+    drain();
+
+    EXPECT_EQ(fake_->writes(kPolicy0MinFreq), (Writes{"1324800"}));
+    EXPECT_EQ(fake_->writes(kPolicy4MinFreq), (Writes{"1286400"}));
+    ASSERT_TRUE(WaitFor([this] { return fake_->value(kPolicy4MinFreq) == "710400"; }));
+}
+
+TEST_F(PowerModeTest, BoostEndsAtTheBaseFrequency) {
+    // A perf HAL lock shows up in scaling_min_freq, it isn't ours to restore.
+    fake_->set(kPolicy4MinFreq, "1804800\n");
+    event(5000000, EV_KEY, BTN_TOUCH, 1);
+    touch(5000000, 500, 500);
+    touch(5008000, 500, 700);
+    event(5300000, EV_KEY, BTN_TOUCH, 0);
+    event(5300000, EV_SYN, SYN_REPORT, 0);
+
+    ASSERT_TRUE(WaitFor([this] { return fake_->writes(kPolicy4MinFreq).size() == 2; }));
+    EXPECT_EQ(fake_->writes(kPolicy4MinFreq), (Writes{"1286400", "710400"}));
+}
+
+TEST_F(PowerModeTest, NoBoostWhileNonInteractive) {
+    setDeviceSpecificMode(Mode::INTERACTIVE, false);
+    event(2000000, EV_KEY, BTN_TOUCH, 1);
+    touch(2000000, 500, 500);
+    event(2050000, EV_KEY, BTN_TOUCH, 0);
+    event(2050000, EV_SYN, SYN_REPORT, 0);
+    drain();
+    setDeviceSpecificMode(Mode::INTERACTIVE, true);
+    EXPECT_EQ(fake_->writes(kPolicy0MinFreq), Writes{});
+}
+
+}  // namespace
+}  // namespace impl
+}  // namespace power
+}  // namespace hardware
+}  // namespace android
+}  // namespace aidl
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    ::testing::AddGlobalTestEnvironment(
+            new aidl::android::hardware::power::impl::PowerEnvironment());
+    return RUN_ALL_TESTS();
+}
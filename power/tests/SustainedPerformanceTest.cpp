@@ -0,0 +1,126 @@
+/*
+ * Copyright (C) 2021 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <math.h>
+
+#include <gtest/gtest.h>
+
+#include "../SustainedPerformance.h"
+
+namespace aidl {
+namespace android {
+namespace hardware {
+namespace power {
+namespace impl {
+namespace {
+
+// First order model of the chassis: the skin follows the SoC power with a
+// two minute time constant, 6.5W at full clocks settle it above 45C.
+class ThermalModel {
+  public:
+    static constexpr float kAmbientC = 25.0f;
+    static constexpr float kTauS = 120.0f;
+    static constexpr float kCPerWatt = 3.2f;
+
+    explicit ThermalModel(float skinC) : skin_c_(skinC) {}
+
+    // Power is 1W idle plus up to 5.5W, roughly cubic in the clocks.
+    float step(float budget, float dtS) {
+        float watts = 1.0f + 5.5f * budget * budget * budget;
+        skin_c_ += (kAmbientC + kCPerWatt * watts - skin_c_) * dtS / kTauS;
+        return skin_c_;
+    }
+
+    float skinC() const { return skin_c_; }
+
+  private:
+    float skin_c_;
+};
+
+struct Trace {
+    float maxC = 0;
+    // First second after which the skin stays within 0.5C of the target.
+    int settledS = -1;
+    float finalBudget = 0;
+};
+
+Trace Simulate(float startC, int seconds) {
+    constexpr float kTargetC = 40.0f;
+    SkinPi pi(kTargetC);
+    pi.reset();
+    ThermalModel model(startC);
+
+    Trace trace;
+    for (int t = 0; t < seconds; t++) {
+        trace.finalBudget = pi.update(model.skinC(), 1.0f);
+        float skinC = model.step(trace.finalBudget, 1.0f);
+        trace.maxC = std::max(trace.maxC, skinC);
+        if (fabsf(skinC - kTargetC) > 0.5f) {
+            trace.settledS = -1;
+        } else if (trace.settledS < 0) {
+            trace.settledS = t;
+        }
+    }
+    return trace;
+}
+
+TEST(SkinPiTest, SettlesWithoutOvershoot) {
+    Trace trace = Simulate(32.0f, 1800);
+    EXPECT_LT(trace.maxC, 41.0f);
+    ASSERT_GE(trace.settledS, 0);
+    EXPECT_LE(trace.settledS, 5 * 60);
+    // Holding 40C takes a little more than half of the full power.
+    EXPECT_GT(trace.finalBudget, 0.7f);
+    EXPECT_LT(trace.finalBudget, 0.9f);
+}
+
+TEST(SkinPiTest, HotStartRecovers) {
+    Trace trace = Simulate(44.0f, 1800);
+    ASSERT_GE(trace.settledS, 0);
+    EXPECT_LE(trace.settledS, 10 * 60);
+}
+
+TEST(SkinPiTest, CoolDeviceStaysUncapped) {
+    SkinPi pi(40.0f);
+    pi.reset();
+    for (int t = 0; t < 600; t++) {
+        EXPECT_EQ(pi.update(30.0f, 1.0f), 1.0f);
+    }
+    // No budget was banked, the first reading above target cuts in.
+    EXPECT_LT(pi.update(41.0f, 1.0f), 1.0f);
+}
+
+TEST(SkinPiTest, BudgetBottomsOut) {
+    SkinPi pi(40.0f);
+    pi.reset();
+    float budget = 1.0f;
+    for (int t = 0; t < 600; t++) {
+        budget = pi.update(60.0f, 1.0f);
+    }
+    EXPECT_EQ(budget, 0.0f);
+    // ...and comes back quickly, as nothing was wound up below 0.
+    for (int t = 0; t < 30; t++) {
+        budget = pi.update(39.0f, 1.0f);
+    }
+    EXPECT_GT(budget, 0.0f);
+}
+
+}  // namespace
+}  // namespace impl
+}  // namespace power
+}  // namespace hardware
+}  // namespace android
+}  // namespace aidl
@@ -0,0 +1,101 @@
+/*
+ * Copyright (C) 2021 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Manifest.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <algorithm>
+#include <sstream>
+
+#include <android-base/strings.h>
+
+namespace prefetch {
+
+namespace {
+
+constexpr const char* kHeader = "# prefetch 1 ";
+
+}  // anonymous namespace
+
+std::vector<Range> ResidentRanges(const uint8_t* residency, size_t pages, uint32_t maxGap) {
+    std::vector<Range> ranges;
+    for (size_t i = 0; i < pages; i++) {
+        if (!(residency[i] & 1)) {
+            continue;
+        }
+        if (!ranges.empty()) {
+            Range& last = ranges.back();
+            if (i - (last.start + last.count) <= maxGap) {
+                last.count = i - last.start + 1;
+                continue;
+            }
+        }
+        ranges.push_back({static_cast<uint32_t>(i), 1});
+    }
+    return ranges;
+}
+
+void SortByPhysical(Manifest* manifest) {
+    std::stable_sort(manifest->entries.begin(), manifest->entries.end(),
+                     [](const Entry& a, const Entry& b) { return a.physical < b.physical; });
+}
+
+std::string Serialize(const Manifest& manifest) {
+    std::ostringstream out;
+    out << kHeader << manifest.fingerprint << "\n";
+    for (const auto& entry : manifest.entries) {
+        out << entry.path;
+        for (const auto& range : entry.ranges) {
+            out << " " << range.start << "+" << range.count;
+        }
+        out << "\n";
+    }
+    return out.str();
+}
+
+bool Parse(const std::string& buf, Manifest* out) {
+    std::vector<std::string> lines = android::base::Split(buf, "\n");
+    if (lines.empty() || !android::base::StartsWith(lines[0], kHeader)) {
+        return false;
+    }
+    out->fingerprint = lines[0].substr(strlen(kHeader));
+    out->entries.clear();
+
+    for (size_t i = 1; i < lines.size(); i++) {
+        if (lines[i].empty()) {
+            continue;
+        }
+
+        std::vector<std::string> fields = android::base::Split(lines[i], " ");
+        Entry entry = {fields[0], 0, {}};
+        for (size_t j = 1; j < fields.size(); j++) {
+            Range range;
+            if (sscanf(fields[j].c_str(), "%" SCNu32 "+%" SCNu32, &range.start, &range.count) !=
+                        2 ||
+                range.count == 0) {
+                return false;
+            }
+            entry.ranges.push_back(range);
+        }
+        out->entries.push_back(std::move(entry));
+    }
+    return true;
+}
+
+}  // namespace prefetch
@@ -0,0 +1,62 @@
+/*
+ * Copyright (C) 2021 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+namespace prefetch {
+
+// A run of pages, in units of the page size.
+struct Range {
+    uint32_t start;
+    uint32_t count;
+};
+
+struct Entry {
+    std::string path;
+    // Where the file starts on disk, only used to order the entries.
+    uint64_t physical;
+    std::vector<Range> ranges;
+};
+
+// Files are read back in the order they are listed in, which the capture
+// sorts by physical offset so the replay streams through the partition.
+//
+//   # prefetch 1 <build fingerprint>
+//   /vendor/lib64/libfoo.so 0+12 40+3
+struct Manifest {
+    std::string fingerprint;
+    std::vector<Entry> entries;
+};
+
+// Collapses a mincore() residency vector into page runs. Runs separated by a
+// gap of at most maxGap pages are merged, reading a few extra pages is
+// cheaper than another request.
+std::vector<Range> ResidentRanges(const uint8_t* residency, size_t pages, uint32_t maxGap);
+
+void SortByPhysical(Manifest* manifest);
+
+std::string Serialize(const Manifest& manifest);
+
+// Returns false on malformed input.
+bool Parse(const std::string& buf, Manifest* out);
+
+}  // namespace prefetch
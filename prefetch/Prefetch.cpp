@@ -0,0 +1,150 @@
+/*
+ * Copyright (C) 2021 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "vendor_prefetch"
+
+#include "Prefetch.h"
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <linux/fiemap.h>
+#include <linux/fs.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <memory>
+
+#include <android-base/logging.h>
+#include <android-base/unique_fd.h>
+
+using ::android::base::unique_fd;
+
+namespace prefetch {
+
+namespace {
+
+// Physical offset of the first extent, or 0 if the filesystem can't tell,
+// in which case the walk order is kept.
+uint64_t PhysicalOffset(int fd) {
+    alignas(struct fiemap) uint8_t buf[sizeof(struct fiemap) + sizeof(struct fiemap_extent)] = {};
+    struct fiemap* map = reinterpret_cast<struct fiemap*>(buf);
+    map->fm_start = 0;
+    map->fm_length = FIEMAP_MAX_OFFSET;
+    map->fm_extent_count = 1;
+
+    if (ioctl(fd, FS_IOC_FIEMAP, map) < 0 || map->fm_mapped_extents == 0) {
+        return 0;
+    }
+    return map->fm_extents[0].fe_physical;
+}
+
+// Records which pages of the file are in the page cache. The file is mapped
+// but never touched, so mincore() doesn't fault anything in.
+bool CaptureFile(const std::string& path, size_t pageSize, Manifest* manifest) {
+    unique_fd fd(TEMP_FAILURE_RETRY(open(path.c_str(), O_RDONLY | O_CLOEXEC | O_NOFOLLOW)));
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) < 0 || !S_ISREG(st.st_mode) || st.st_size == 0) {
+        return false;
+    }
+
+    void* addr = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    if (addr == MAP_FAILED) {
+        return false;
+    }
+
+    size_t pages = (st.st_size + pageSize - 1) / pageSize;
+    std::vector<uint8_t> residency(pages);
+    int ret = mincore(addr, st.st_size, residency.data());
+    munmap(addr, st.st_size);
+    if (ret < 0) {
+        PLOG(WARNING) << "mincore failed for " << path;
+        return false;
+    }
+
+    std::vector<Range> ranges = ResidentRanges(residency.data(), pages, kMaxGapPages);
+    if (ranges.empty()) {
+        return false;
+    }
+    manifest->entries.push_back({path, PhysicalOffset(fd), std::move(ranges)});
+    return true;
+}
+
+void CaptureDir(const std::string& dir, size_t pageSize, Manifest* manifest) {
+    std::unique_ptr<DIR, decltype(&closedir)> d(opendir(dir.c_str()), closedir);
+    if (!d) {
+        return;
+    }
+
+    while (struct dirent* de = readdir(d.get())) {
+        if (!strcmp(de->d_name, ".") || !strcmp(de->d_name, "..")) {
+            continue;
+        }
+
+        std::string path = dir + "/" + de->d_name;
+        unsigned char type = de->d_type;
+        if (type == DT_UNKNOWN) {
+            struct stat st;
+            if (lstat(path.c_str(), &st) < 0) {
+                continue;
+            }
+            type = S_ISDIR(st.st_mode) ? DT_DIR : S_ISREG(st.st_mode) ? DT_REG : DT_LNK;
+        }
+
+        if (type == DT_DIR) {
+            CaptureDir(path, pageSize, manifest);
+        } else if (type == DT_REG) {
+            CaptureFile(path, pageSize, manifest);
+        }
+    }
+}
+
+}  // anonymous namespace
+
+void CaptureDirs(const std::vector<std::string>& dirs, size_t pageSize, Manifest* manifest) {
+    for (const auto& dir : dirs) {
+        CaptureDir(dir, pageSize, manifest);
+    }
+    SortByPhysical(manifest);
+}
+
+ReplayStats ReplayManifest(const Manifest& manifest, size_t pageSize, uint64_t maxBytes) {
+    ReplayStats stats = {0, 0};
+    for (const auto& entry : manifest.entries) {
+        if (stats.bytes >= maxBytes) {
+            break;
+        }
+        unique_fd fd(TEMP_FAILURE_RETRY(open(entry.path.c_str(), O_RDONLY | O_CLOEXEC)));
+        if (fd < 0) {
+            continue;
+        }
+        for (const auto& range : entry.ranges) {
+            if (stats.bytes >= maxBytes) {
+                break;
+            }
+            off_t len = static_cast<off_t>(range.count) * pageSize;
+            posix_fadvise(fd, static_cast<off_t>(range.start) * pageSize, len,
+                          POSIX_FADV_WILLNEED);
+            stats.bytes += len;
+        }
+        stats.files++;
+    }
+    return stats;
+}
+
+}  // namespace prefetch
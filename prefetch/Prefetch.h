@@ -0,0 +1,45 @@
+/*
+ * Copyright (C) 2021 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include "Manifest.h"
+
+namespace prefetch {
+
+// Holes of up to 64k between resident pages are read as well.
+constexpr uint32_t kMaxGapPages = 16;
+
+// Adds the page cache residency of every regular file below the directories
+// to the manifest, sorted by physical offset.
+void CaptureDirs(const std::vector<std::string>& dirs, size_t pageSize, Manifest* manifest);
+
+struct ReplayStats {
+    size_t files;
+    uint64_t bytes;
+};
+
+// Asks for every range in manifest order until maxBytes are queued. WILLNEED
+// only queues the reads, so this returns long before the pages are in.
+ReplayStats ReplayManifest(const Manifest& manifest, size_t pageSize, uint64_t maxBytes);
+
+}  // namespace prefetch
@@ -0,0 +1,164 @@
+/*
+ * Copyright (C) 2021 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "vendor_prefetch"
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include <android-base/file.h>
+#include <android-base/logging.h>
+#include <android-base/properties.h>
+
+#include "Manifest.h"
+#include "Prefetch.h"
+
+using ::android::base::GetProperty;
+using ::android::base::ReadFileToString;
+using ::android::base::WriteStringToFile;
+
+using ::prefetch::Manifest;
+
+namespace {
+
+constexpr const char* kManifestPath = "/data/vendor/prefetch/vendor.manifest";
+
+// Where the HALs and the libraries they pull in live.
+constexpr const char* kCaptureDirs[] = {
+        "/vendor/bin",
+        "/vendor/etc",
+        "/vendor/lib",
+        "/vendor/lib64",
+};
+
+// A vendor OTA moves every file, so the manifest is only trusted for the
+// build it was captured on.
+constexpr const char* kFingerprintProp = "ro.vendor.build.fingerprint";
+
+// Keep the replay from evicting what init itself is about to need.
+constexpr uint64_t kMaxReplayBytes = 128 * 1024 * 1024;
+
+int64_t NowMs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000LL + ts.tv_nsec / 1000000;
+}
+
+int Capture(const std::string& manifestPath, const std::vector<std::string>& dirs) {
+    int64_t start = NowMs();
+    size_t pageSize = sysconf(_SC_PAGESIZE);
+
+    Manifest manifest;
+    manifest.fingerprint = GetProperty(kFingerprintProp, "");
+    prefetch::CaptureDirs(dirs, pageSize, &manifest);
+
+    uint64_t pages = 0;
+    for (const auto& entry : manifest.entries) {
+        for (const auto& range : entry.ranges) {
+            pages += range.count;
+        }
+    }
+
+    // Written next to the old one and renamed, a replay never sees half a file.
+    std::string tmpPath = manifestPath + ".tmp";
+    if (!WriteStringToFile(prefetch::Serialize(manifest), tmpPath) ||
+        rename(tmpPath.c_str(), manifestPath.c_str()) < 0) {
+        PLOG(ERROR) << "Failed to write " << manifestPath;
+        unlink(tmpPath.c_str());
+        return 1;
+    }
+
+    LOG(INFO) << "event=capture files=" << manifest.entries.size()
+              << " kb=" << pages * pageSize / 1024 << " took_ms=" << NowMs() - start;
+    return 0;
+}
+
+int Replay(const std::string& manifestPath) {
+    int64_t start = NowMs();
+    size_t pageSize = sysconf(_SC_PAGESIZE);
+
+    std::string buf;
+    if (!ReadFileToString(manifestPath, &buf)) {
+        LOG(INFO) << "event=replay_skipped reason=no_manifest";
+        return 0;
+    }
+
+    Manifest manifest;
+    if (!prefetch::Parse(buf, &manifest)) {
+        LOG(ERROR) << "Malformed " << manifestPath;
+        return 1;
+    }
+    if (manifest.fingerprint != GetProperty(kFingerprintProp, "")) {
+        LOG(INFO) << "event=replay_skipped reason=stale_manifest";
+        return 0;
+    }
+
+    prefetch::ReplayStats stats = prefetch::ReplayManifest(manifest, pageSize, kMaxReplayBytes);
+    LOG(INFO) << "event=replay files=" << stats.files << " kb=" << stats.bytes / 1024
+              << " took_ms=" << NowMs() - start;
+    return 0;
+}
+
+// Captures after the first boot of a build, there is nothing to do once the
+// manifest matches the running one.
+bool NeedsCapture(const std::string& manifestPath) {
+    std::string buf;
+    Manifest manifest;
+    return !ReadFileToString(manifestPath, &buf) || !prefetch::Parse(buf, &manifest) ||
+           manifest.fingerprint != GetProperty(kFingerprintProp, "");
+}
+
+void Usage(const char* argv0) {
+    fprintf(stderr,
+            "usage: %s --replay [manifest]\n"
+            "       %s --capture [manifest [dir...]]\n",
+            argv0, argv0);
+}
+
+}  // anonymous namespace
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        Usage(argv[0]);
+        return 1;
+    }
+
+    std::string manifestPath = argc > 2 ? argv[2] : kManifestPath;
+    if (strcmp(argv[1], "--replay") == 0 && argc <= 3) {
+        return Replay(manifestPath);
+    }
+
+    if (strcmp(argv[1], "--capture") == 0) {
+        std::vector<std::string> dirs(argv + std::min(argc, 3), argv + argc);
+        if (dirs.empty()) {
+            if (!NeedsCapture(manifestPath)) {
+                return 0;
+            }
+            dirs.assign(std::begin(kCaptureDirs), std::end(kCaptureDirs));
+        }
+        return Capture(manifestPath, dirs);
+    }
+
+    Usage(argv[0]);
+    return 1;
+}
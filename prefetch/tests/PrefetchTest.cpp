@@ -0,0 +1,147 @@
+/*
+ * Copyright (C) 2021 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Captures and replays a synthetic vendor tree in a temporary directory.
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include <android-base/file.h>
+#include <android-base/unique_fd.h>
+#include <gtest/gtest.h>
+
+#include "../Prefetch.h"
+
+namespace prefetch {
+namespace {
+
+using ::android::base::unique_fd;
+
+class PrefetchTest : public ::testing::Test {
+  protected:
+    void SetUp() override {
+        page_size_ = sysconf(_SC_PAGESIZE);
+        root_ = dir_.path;
+    }
+
+    // Creates the file and drops it from the page cache.
+    std::string addFile(const std::string& name, size_t pages) {
+        std::string path = root_ + "/" + name;
+        for (size_t slash = root_.size() + 1; (slash = path.find('/', slash)) != std::string::npos;
+             slash++) {
+            mkdir(path.substr(0, slash).c_str(), 0755);
+        }
+        unique_fd fd(open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644));
+        EXPECT_GE(fd, 0) << path;
+        std::string data(pages * page_size_, 'x');
+        EXPECT_TRUE(android::base::WriteFully(fd, data.data(), data.size()));
+        fsync(fd);
+        posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+        return path;
+    }
+
+    // Faults in exactly these pages, without read-ahead.
+    void touch(const std::string& path, const std::vector<size_t>& pages) {
+        unique_fd fd(open(path.c_str(), O_RDONLY | O_CLOEXEC));
+        ASSERT_GE(fd, 0) << path;
+        posix_fadvise(fd, 0, 0, POSIX_FADV_RANDOM);
+        std::string buf(page_size_, '\0');
+        for (size_t page : pages) {
+            ASSERT_EQ(pread(fd, buf.data(), page_size_, page * page_size_),
+                      static_cast<ssize_t>(page_size_));
+        }
+    }
+
+    size_t residentPages(const std::string& path) {
+        unique_fd fd(open(path.c_str(), O_RDONLY | O_CLOEXEC));
+        struct stat st;
+        if (fd < 0 || fstat(fd, &st) < 0 || st.st_size == 0) {
+            return 0;
+        }
+        void* addr = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        size_t pages = (st.st_size + page_size_ - 1) / page_size_;
+        std::vector<uint8_t> residency(pages);
+        mincore(addr, st.st_size, residency.data());
+        munmap(addr, st.st_size);
+        size_t resident = 0;
+        for (uint8_t r : residency) {
+            resident += r & 1;
+        }
+        return resident;
+    }
+
+    TemporaryDir dir_;
+    std::string root_;
+    size_t page_size_;
+};
+
+TEST_F(PrefetchTest, CaptureRecordsResidentRuns) {
+    std::string lib = addFile("lib64/libfoo.so", 64);
+    std::string bin = addFile("bin/hw/foo-service", 8);
+    std::string cold = addFile("etc/cold.xml", 4);
+    addFile("etc/empty.xml", 0);
+    symlink(lib.c_str(), (root_ + "/lib64/libfoo.so.1").c_str());
+    if (residentPages(lib) != 0) {
+        GTEST_SKIP() << "the page cache of " << root_ << " can't be dropped";
+    }
+
+    touch(lib, {0, 1, 2, 3, 10, 11, 40, 41});
+    touch(bin, {0, 1, 2, 3, 4, 5, 6, 7});
+
+    Manifest manifest;
+    CaptureDirs({root_ + "/bin", root_ + "/etc", root_ + "/lib64"}, page_size_, &manifest);
+
+    std::map<std::string, std::string> ranges;
+    for (const auto& entry : manifest.entries) {
+        std::string& out = ranges[entry.path];
+        for (const auto& range : entry.ranges) {
+            out += std::to_string(range.start) + "+" + std::to_string(range.count) + " ";
+        }
+    }
+    // The gap of six pages is read along, the one of 28 is not. Cold and
+    // empty files and symlinks are left out.
+    std::map<std::string, std::string> expected = {
+            {lib, "0+12 40+2 "},
+            {bin, "0+8 "},
+    };
+    EXPECT_EQ(ranges, expected);
+}
+
+TEST_F(PrefetchTest, ReplayStopsAtTheCap) {
+    Manifest manifest;
+    manifest.entries.push_back({addFile("lib64/liba.so", 4), 0, {{0, 4}}});
+    manifest.entries.push_back({root_ + "/lib64/gone.so", 0, {{0, 4}}});
+    manifest.entries.push_back({addFile("lib64/libb.so", 4), 0, {{0, 2}, {2, 2}}});
+    manifest.entries.push_back({addFile("lib64/libc.so", 4), 0, {{0, 4}}});
+
+    // The cap is reached within libb, libc is not even opened.
+    ReplayStats stats = ReplayManifest(manifest, page_size_, 6 * page_size_);
+    EXPECT_EQ(stats.files, 2u);
+    EXPECT_EQ(stats.bytes, 6 * page_size_);
+
+    stats = ReplayManifest(manifest, page_size_, 1 << 30);
+    EXPECT_EQ(stats.files, 3u);
+    EXPECT_EQ(stats.bytes, 12 * page_size_);
+}
+
+}  // namespace
+}  // namespace prefetch
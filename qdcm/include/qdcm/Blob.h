@@ -0,0 +1,313 @@
+/*
+ * Copyright (C) 2021 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <array>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include <android-base/logging.h>
+#include <android-base/unique_fd.h>
+
+namespace qdcm {
+
+constexpr const char* kCalibrationPath =
+        "/vendor/etc/qdcm_calib_data_samsung_ea8076_fhd_cmd_dsi_panel.bin";
+
+// On-disk layout written by qdcm_compile.py, all fields are little endian:
+//
+//   Header
+//   ModeRecord[numModes]
+//   FeatureRecord[numFeatures]
+//   strings, NUL terminated, starting with an empty one
+//   feature data, every blob 8 byte aligned
+//
+// The CRC covers everything after the header.
+namespace format {
+
+constexpr char kMagic[4] = {'Q', 'D', 'C', 'M'};
+constexpr uint16_t kVersion = 1;
+
+constexpr uint16_t kModeDefault = 1 << 0;
+constexpr uint16_t kModeApp = 1 << 1;
+
+constexpr uint32_t kFeatureDisabled = 1 << 0;
+
+struct Header {
+    char magic[4];
+    uint16_t version;
+    uint16_t numModes;
+    int32_t defaultMode;
+    uint32_t numFeatures;
+    uint32_t stringsOffset;
+    uint32_t dataOffset;
+    uint32_t size;
+    uint32_t crc;
+};
+static_assert(sizeof(Header) == 32);
+
+struct ModeRecord {
+    int32_t id;
+    int32_t displayId;
+    // Offsets into the string table.
+    uint32_t name;
+    uint32_t dynamicRange;
+    uint32_t colorGamut;
+    uint32_t pictureQuality;
+    int32_t whitePoint;
+    int32_t eValue;
+    int32_t bValue;
+    int32_t rValue;
+    uint16_t flags;
+    uint16_t numFeatures;
+    uint32_t firstFeature;
+};
+static_assert(sizeof(ModeRecord) == 48);
+
+struct FeatureRecord {
+    uint32_t type;
+    uint32_t flags;
+    // Offset from the start of the data section.
+    uint32_t offset;
+    uint32_t size;
+};
+static_assert(sizeof(FeatureRecord) == 16);
+
+}  // namespace format
+
+inline uint32_t Crc32(const uint8_t* data, size_t size) {
+    static const std::array<uint32_t, 256> sTable = [] {
+        std::array<uint32_t, 256> table;
+        for (uint32_t i = 0; i < table.size(); i++) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; k++) {
+                c = (c & 1) ? 0xedb88320 ^ (c >> 1) : c >> 1;
+            }
+            table[i] = c;
+        }
+        return table;
+    }();
+
+    uint32_t crc = 0xffffffff;
+    for (size_t i = 0; i < size; i++) {
+        crc = sTable[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+    }
+    return crc ^ 0xffffffff;
+}
+
+struct Feature {
+    uint32_t type;
+    bool disabled;
+    const uint8_t* data;
+    size_t size;
+};
+
+struct Mode {
+    int32_t id;
+    int32_t displayId;
+    std::string_view name;
+    std::string_view dynamicRange;
+    std::string_view colorGamut;
+    std::string_view pictureQuality;
+    int32_t whitePoint;
+    int32_t eValue;
+    int32_t bValue;
+    int32_t rValue;
+    bool isDefault;
+    bool isAppMode;
+    size_t numFeatures;
+};
+
+// Read-only view of a compiled calibration blob. The file is mapped once and
+// every accessor hands out pointers into the mapping, nothing is copied.
+class Blob {
+  public:
+    Blob() = default;
+    Blob(const Blob&) = delete;
+    Blob& operator=(const Blob&) = delete;
+
+    ~Blob() {
+        if (base_ != nullptr) {
+            munmap(const_cast<uint8_t*>(base_), size_);
+        }
+    }
+
+    bool open(const std::string& path = kCalibrationPath) {
+        android::base::unique_fd fd(TEMP_FAILURE_RETRY(::open(path.c_str(), O_RDONLY | O_CLOEXEC)));
+        struct stat st;
+        if (fd < 0 || fstat(fd, &st) < 0) {
+            PLOG(ERROR) << "Failed to open " << path;
+            return false;
+        }
+
+        void* addr = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (addr == MAP_FAILED) {
+            PLOG(ERROR) << "Failed to map " << path;
+            return false;
+        }
+        base_ = static_cast<const uint8_t*>(addr);
+        size_ = st.st_size;
+
+        if (!validate()) {
+            LOG(ERROR) << "Rejecting malformed calibration blob " << path;
+            munmap(addr, size_);
+            base_ = nullptr;
+            size_ = 0;
+            return false;
+        }
+        return true;
+    }
+
+    bool valid() const { return base_ != nullptr; }
+
+    size_t numModes() const { return header()->numModes; }
+    int32_t defaultModeId() const { return header()->defaultMode; }
+
+    Mode mode(size_t index) const {
+        const format::ModeRecord& r = modes()[index];
+        return {
+                .id = r.id,
+                .displayId = r.displayId,
+                .name = string(r.name),
+                .dynamicRange = string(r.dynamicRange),
+                .colorGamut = string(r.colorGamut),
+                .pictureQuality = string(r.pictureQuality),
+                .whitePoint = r.whitePoint,
+                .eValue = r.eValue,
+                .bValue = r.bValue,
+                .rValue = r.rValue,
+                .isDefault = (r.flags & format::kModeDefault) != 0,
+                .isAppMode = (r.flags & format::kModeApp) != 0,
+                .numFeatures = r.numFeatures,
+        };
+    }
+
+    // Index of the mode with the given id, if there is one.
+    std::optional<size_t> findMode(int32_t id) const {
+        for (size_t i = 0; i < numModes(); i++) {
+            if (modes()[i].id == id) {
+                return i;
+            }
+        }
+        return std::nullopt;
+    }
+
+    Feature feature(size_t modeIndex, size_t featureIndex) const {
+        const format::FeatureRecord& r =
+                features()[modes()[modeIndex].firstFeature + featureIndex];
+        return {
+                .type = r.type,
+                .disabled = (r.flags & format::kFeatureDisabled) != 0,
+                .data = base_ + header()->dataOffset + r.offset,
+                .size = r.size,
+        };
+    }
+
+    std::optional<Feature> findFeature(size_t modeIndex, uint32_t type) const {
+        for (size_t i = 0; i < modes()[modeIndex].numFeatures; i++) {
+            Feature f = feature(modeIndex, i);
+            if (f.type == type) {
+                return f;
+            }
+        }
+        return std::nullopt;
+    }
+
+  private:
+    const format::Header* header() const {
+        return reinterpret_cast<const format::Header*>(base_);
+    }
+
+    const format::ModeRecord* modes() const {
+        return reinterpret_cast<const format::ModeRecord*>(base_ + sizeof(format::Header));
+    }
+
+    const format::FeatureRecord* features() const {
+        return reinterpret_cast<const format::FeatureRecord*>(
+                reinterpret_cast<const uint8_t*>(modes()) +
+                header()->numModes * sizeof(format::ModeRecord));
+    }
+
+    std::string_view string(uint32_t offset) const {
+        return reinterpret_cast<const char*>(base_ + header()->stringsOffset + offset);
+    }
+
+    // Everything the accessors dereference is bounds checked here, once.
+    bool validate() const {
+        if (size_ < sizeof(format::Header)) {
+            return false;
+        }
+
+        const format::Header* h = header();
+        if (memcmp(h->magic, format::kMagic, sizeof(h->magic)) != 0) {
+            LOG(ERROR) << "Bad magic";
+            return false;
+        }
+        if (h->version != format::kVersion) {
+            LOG(ERROR) << "Unsupported version " << h->version;
+            return false;
+        }
+        if (h->size != size_) {
+            LOG(ERROR) << "Truncated, expected " << h->size << " bytes, got " << size_;
+            return false;
+        }
+        if (Crc32(base_ + sizeof(format::Header), size_ - sizeof(format::Header)) != h->crc) {
+            LOG(ERROR) << "Checksum mismatch";
+            return false;
+        }
+
+        size_t tablesEnd = sizeof(format::Header) + h->numModes * sizeof(format::ModeRecord) +
+                           h->numFeatures * sizeof(format::FeatureRecord);
+        if (tablesEnd > h->stringsOffset || h->stringsOffset >= h->dataOffset ||
+            h->dataOffset > size_ || base_[h->dataOffset - 1] != '\0') {
+            LOG(ERROR) << "Bad section offsets";
+            return false;
+        }
+
+        size_t stringsSize = h->dataOffset - h->stringsOffset;
+        size_t dataSize = size_ - h->dataOffset;
+        for (size_t i = 0; i < h->numModes; i++) {
+            const format::ModeRecord& m = modes()[i];
+            if (m.name >= stringsSize || m.dynamicRange >= stringsSize ||
+                m.colorGamut >= stringsSize || m.pictureQuality >= stringsSize ||
+                static_cast<size_t>(m.firstFeature) + m.numFeatures > h->numFeatures) {
+                LOG(ERROR) << "Bad mode record " << i;
+                return false;
+            }
+        }
+        for (size_t i = 0; i < h->numFeatures; i++) {
+            const format::FeatureRecord& f = features()[i];
+            if (f.offset > dataSize || f.size > dataSize - f.offset) {
+                LOG(ERROR) << "Bad feature record " << i;
+                return false;
+            }
+        }
+        return true;
+    }
+
+    const uint8_t* base_ = nullptr;
+    size_t size_ = 0;
+};
+
+}  // namespace qdcm
@@ -0,0 +1,211 @@
+#!/usr/bin/env python
+#
+# Copyright (C) 2021 The LineageOS Project
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#      http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+#
+
+"""Validates a QDCM calibration XML and compiles it into the binary layout
+read by qdcm/include/qdcm/Blob.h. The display stack still reads the XML
+itself, so the validated XML can be copied out as well."""
+
+import argparse
+import binascii
+import shutil
+import struct
+import sys
+import xml.etree.ElementTree as ET
+import zlib
+
+MAGIC = b'QDCM'
+VERSION = 1
+
+MODE_DEFAULT = 1 << 0
+MODE_APP = 1 << 1
+
+FEATURE_DISABLED = 1 << 0
+
+HEADER = struct.Struct('<4sHHiIIIII')
+MODE = struct.Struct('<iiIIIIiiiiHHI')
+FEATURE = struct.Struct('<IIII')
+
+DATA_ALIGNMENT = 8
+
+
+class CalibError(Exception):
+    pass
+
+
+def align(offset):
+    return (offset + DATA_ALIGNMENT - 1) & ~(DATA_ALIGNMENT - 1)
+
+
+def int_attr(elem, name, default=None):
+    value = elem.get(name)
+    if value is None:
+        if default is None:
+            raise CalibError('<%s> is missing %s' % (elem.tag, name))
+        return default
+    try:
+        return int(value)
+    except ValueError:
+        raise CalibError('<%s> %s="%s" is not an integer' % (elem.tag, name, value))
+
+
+def bool_attr(elem, name):
+    value = elem.get(name, 'false')
+    if value not in ('true', 'false'):
+        raise CalibError('<%s> %s="%s" is not true or false' % (elem.tag, name, value))
+    return value == 'true'
+
+
+def parse_feature(mode_name, elem):
+    feature_type = int_attr(elem, 'FeatureType')
+    size = int_attr(elem, 'DataSize')
+    text = ''.join((elem.text or '').split())
+    try:
+        data = binascii.unhexlify(text)
+    except (binascii.Error, TypeError):
+        raise CalibError('mode %s feature %d has malformed hex data' % (mode_name, feature_type))
+    if len(data) != size:
+        raise CalibError('mode %s feature %d has %d bytes of data, DataSize says %d' %
+                         (mode_name, feature_type, len(data), size))
+    return {
+        'type': feature_type,
+        'disabled': bool_attr(elem, 'Disable'),
+        'data': data,
+    }
+
+
+def parse_mode(elem):
+    name = elem.get('Name')
+    if not name:
+        raise CalibError('<Mode> is missing Name')
+
+    # NumOfFeatures counts every feature the mode could carry, not just the
+    # ones with calibration data, so it is not checked against the children.
+    features = [parse_feature(name, f) for f in elem.findall('Feature')]
+    types = [f['type'] for f in features]
+    if len(set(types)) != len(types):
+        raise CalibError('mode %s has duplicate features' % name)
+
+    flags = 0
+    if int_attr(elem, 'IsDefaultMode', 0):
+        flags |= MODE_DEFAULT
+    if int_attr(elem, 'IsAppMode', 0):
+        flags |= MODE_APP
+
+    return {
+        'id': int_attr(elem, 'ModeID'),
+        'display_id': int_attr(elem, 'DisplayID', 0),
+        'name': name,
+        'dynamic_range': elem.get('DynamicRange', ''),
+        'color_gamut': elem.get('ColorGamut', ''),
+        'picture_quality': elem.get('PictureQuality', ''),
+        'white_point': int_attr(elem, 'WhitePoint', 0),
+        'e_value': int_attr(elem, 'EValue', 0),
+        'b_value': int_attr(elem, 'BValue', 0),
+        'r_value': int_attr(elem, 'RValue', 0),
+        'flags': flags,
+        'features': features,
+    }
+
+
+def parse(path):
+    try:
+        root = ET.parse(path).getroot()
+    except ET.ParseError as e:
+        raise CalibError(str(e))
+
+    if root.tag != 'Calib_Data':
+        raise CalibError('root element is <%s>, expected <Calib_Data>' % root.tag)
+    disp_modes = root.find('Disp_Modes')
+    if disp_modes is None:
+        raise CalibError('<Disp_Modes> is missing')
+
+    modes = [parse_mode(m) for m in disp_modes.findall('Mode')]
+    num_modes = int_attr(disp_modes, 'NumModes')
+    if num_modes != len(modes):
+        raise CalibError('NumModes is %d but there are %d modes' % (num_modes, len(modes)))
+
+    ids = [m['id'] for m in modes]
+    if len(set(ids)) != len(ids):
+        raise CalibError('duplicate ModeID')
+    default_mode = int_attr(disp_modes, 'DefaultMode')
+    if default_mode not in ids:
+        raise CalibError('DefaultMode %d does not exist' % default_mode)
+
+    return default_mode, modes
+
+
+def compile_blob(default_mode, modes):
+    strings = bytearray(b'\0')
+    string_offsets = {'': 0}
+
+    def intern(s):
+        if s not in string_offsets:
+            string_offsets[s] = len(strings)
+            strings.extend(s.encode('utf-8') + b'\0')
+        return string_offsets[s]
+
+    mode_records = bytearray()
+    feature_records = bytearray()
+    data = bytearray()
+    num_features = 0
+    for m in modes:
+        mode_records += MODE.pack(m['id'], m['display_id'], intern(m['name']),
+                                  intern(m['dynamic_range']), intern(m['color_gamut']),
+                                  intern(m['picture_quality']), m['white_point'], m['e_value'],
+                                  m['b_value'], m['r_value'], m['flags'], len(m['features']),
+                                  num_features)
+        for f in m['features']:
+            data += b'\0' * (align(len(data)) - len(data))
+            feature_records += FEATURE.pack(f['type'], FEATURE_DISABLED if f['disabled'] else 0,
+                                            len(data), len(f['data']))
+            data += f['data']
+            num_features += 1
+
+    strings_offset = HEADER.size + len(mode_records) + len(feature_records)
+    data_offset = align(strings_offset + len(strings))
+    strings += b'\0' * (data_offset - strings_offset - len(strings))
+
+    body = bytes(mode_records + feature_records + strings + data)
+    header = HEADER.pack(MAGIC, VERSION, len(modes), default_mode, num_features,
+                         strings_offset, data_offset, HEADER.size + len(body),
+                         zlib.crc32(body) & 0xffffffff)
+    return header + body
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument('input', help='QDCM calibration XML')
+    parser.add_argument('--blob', help='where to write the compiled blob')
+    parser.add_argument('--xml', help='where to copy the validated XML')
+    args = parser.parse_args()
+
+    try:
+        default_mode, modes = parse(args.input)
+    except CalibError as e:
+        sys.stderr.write('%s: error: %s\n' % (args.input, e))
+        return 1
+
+    if args.blob:
+        with open(args.blob, 'wb') as f:
+            f.write(compile_blob(default_mode, modes))
+    if args.xml:
+        shutil.copyfile(args.input, args.xml)
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
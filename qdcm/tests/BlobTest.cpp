@@ -0,0 +1,104 @@
+/*
+ * Copyright (C) 2021 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdint.h>
+
+#include <string>
+
+#include <android-base/file.h>
+#include <gtest/gtest.h>
+#include <qdcm/Blob.h>
+
+namespace qdcm {
+namespace {
+
+std::string ShippedBlob() {
+    return android::base::GetExecutableDirectory() +
+           "/qdcm_calib_data_samsung_ea8076_fhd_cmd_dsi_panel.bin";
+}
+
+// Writes a copy of the shipped blob after letting edit() change it.
+template <typename F>
+std::string EditedBlob(const TemporaryFile& file, F edit) {
+    std::string data;
+    EXPECT_TRUE(android::base::ReadFileToString(ShippedBlob(), &data));
+    edit(&data);
+    EXPECT_TRUE(android::base::WriteStringToFile(data, file.path));
+    return file.path;
+}
+
+TEST(BlobTest, ReadsTheShippedCalibration) {
+    Blob blob;
+    ASSERT_TRUE(blob.open(ShippedBlob()));
+    ASSERT_EQ(blob.numModes(), 4u);
+    EXPECT_EQ(blob.defaultModeId(), 0);
+
+    Mode srgb = blob.mode(0);
+    EXPECT_EQ(srgb.id, 0);
+    EXPECT_EQ(srgb.name, "adaptive_srgb_V1_5_CR_0");
+    EXPECT_EQ(srgb.colorGamut, "srgb");
+    EXPECT_EQ(srgb.pictureQuality, "enhanced");
+    ASSERT_EQ(srgb.numFeatures, 1u);
+    EXPECT_EQ(blob.feature(0, 0).type, 14u);
+    EXPECT_EQ(blob.feature(0, 0).size, 9560u);
+
+    Mode native = blob.mode(*blob.findMode(2));
+    EXPECT_EQ(native.name, "native");
+    // Attributes a mode doesn't have read back empty.
+    EXPECT_EQ(native.colorGamut, "");
+    EXPECT_FALSE(blob.findMode(4).has_value());
+}
+
+TEST(BlobTest, FeaturesPointIntoTheMapping) {
+    Blob blob;
+    ASSERT_TRUE(blob.open(ShippedBlob()));
+    for (size_t m = 0; m < blob.numModes(); m++) {
+        for (size_t f = 0; f < blob.mode(m).numFeatures; f++) {
+            Feature feature = blob.feature(m, f);
+            EXPECT_EQ(reinterpret_cast<uintptr_t>(feature.data) % 8, 0u);
+        }
+    }
+
+    size_t native = *blob.findMode(2);
+    std::optional<Feature> feature = blob.findFeature(native, 3);
+    ASSERT_TRUE(feature.has_value());
+    EXPECT_TRUE(feature->disabled);
+    EXPECT_EQ(feature->size, 117928u);
+    EXPECT_FALSE(blob.findFeature(native, 1000).has_value());
+}
+
+TEST(BlobTest, RejectsCorruption) {
+    TemporaryFile file;
+    Blob blob;
+    EXPECT_FALSE(blob.open(EditedBlob(file, [](std::string* data) { (*data)[100] ^= 1; })));
+    EXPECT_FALSE(blob.valid());
+}
+
+TEST(BlobTest, RejectsTruncation) {
+    TemporaryFile file;
+    Blob blob;
+    EXPECT_FALSE(blob.open(EditedBlob(file, [](std::string* data) { data->resize(1000); })));
+    EXPECT_FALSE(blob.open(EditedBlob(file, [](std::string* data) { data->resize(16); })));
+}
+
+TEST(BlobTest, RejectsOtherVersions) {
+    TemporaryFile file;
+    Blob blob;
+    EXPECT_FALSE(blob.open(EditedBlob(file, [](std::string* data) { (*data)[4] = 2; })));
+}
+
+}  // namespace
+}  // namespace qdcm
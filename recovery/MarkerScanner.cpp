@@ -0,0 +1,111 @@
+/*
+ * Copyright (C) 2021 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "fwmarkers/MarkerScanner.h"
+
+#include <string.h>
+
+#include <algorithm>
+
+namespace fwmarkers {
+
+MarkerScanner::MarkerScanner(std::vector<std::string> markers, size_t maxValueLen)
+    : markers_(std::move(markers)),
+      max_value_len_(maxValueLen),
+      max_marker_len_(0),
+      matches_(markers_.size()) {
+    for (const auto& marker : markers_) {
+        max_marker_len_ = std::max(max_marker_len_, marker.size());
+    }
+}
+
+size_t MarkerScanner::capture(Match* match, const uint8_t* data, size_t len) const {
+    size_t avail = std::min(len, max_value_len_ - match->value.size());
+    const uint8_t* nul = static_cast<const uint8_t*>(memchr(data, '\0', avail));
+    size_t n = nul ? nul - data : avail;
+
+    match->value.append(reinterpret_cast<const char*>(data), n);
+    match->complete = nul != nullptr || match->value.size() == max_value_len_;
+    return n;
+}
+
+void MarkerScanner::search(size_t i, const uint8_t* data, size_t len) {
+    const std::string& marker = markers_[i];
+    Match& match = matches_[i];
+    if (marker.empty()) {
+        match.found = true;
+        capture(&match, data, len);
+        return;
+    }
+
+    // A match straddling the boundary starts in the tail and ends within the
+    // first marker.size() - 1 bytes of the chunk.
+    size_t head = std::min(len, marker.size() - 1);
+    if (!tail_.empty() && head > 0) {
+        std::string seam = tail_ + std::string(reinterpret_cast<const char*>(data), head);
+        size_t from = tail_.size() >= marker.size() ? tail_.size() - marker.size() + 1 : 0;
+        size_t pos = seam.find(marker, from);
+        if (pos != std::string::npos) {
+            size_t end = pos + marker.size() - tail_.size();
+            match.found = true;
+            capture(&match, data + end, len - end);
+            return;
+        }
+    }
+
+    const void* hit = memmem(data, len, marker.data(), marker.size());
+    if (hit != nullptr) {
+        size_t end = static_cast<const uint8_t*>(hit) - data + marker.size();
+        match.found = true;
+        capture(&match, data + end, len - end);
+    }
+}
+
+void MarkerScanner::update(const uint8_t* data, size_t len) {
+    for (size_t i = 0; i < markers_.size(); i++) {
+        Match& match = matches_[i];
+        if (match.complete) {
+            continue;
+        }
+        if (match.found) {
+            capture(&match, data, len);
+        } else {
+            search(i, data, len);
+        }
+    }
+
+    size_t keep = max_marker_len_ > 0 ? max_marker_len_ - 1 : 0;
+    if (len >= keep) {
+        tail_.assign(reinterpret_cast<const char*>(data + len - keep), keep);
+    } else {
+        tail_.append(reinterpret_cast<const char*>(data), len);
+        tail_.erase(0, tail_.size() - std::min(tail_.size(), keep));
+    }
+}
+
+bool MarkerScanner::done() const {
+    return std::all_of(matches_.begin(), matches_.end(),
+                       [](const Match& match) { return match.complete; });
+}
+
+std::optional<std::string> MarkerScanner::value(size_t i) const {
+    if (!matches_[i].found) {
+        return std::nullopt;
+    }
+    return matches_[i].value;
+}
+
+}  // namespace fwmarkers
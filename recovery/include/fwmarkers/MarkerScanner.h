@@ -0,0 +1,77 @@
+/*
+ * Copyright (C) 2021 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace fwmarkers {
+
+// The version string Qualcomm stamps into every firmware image.
+constexpr const char* kImageVersionMarker = "QC_IMAGE_VERSION_STRING=";
+constexpr const char* kTrustZoneVersionMarker = "QC_IMAGE_VERSION_STRING=TZ.";
+
+// Longest value captured after a marker, matching what the updater has
+// always accepted.
+constexpr size_t kMaxValueLen = 255;
+
+// Finds the first occurrence of each marker in an image fed in arbitrary
+// chunks, and captures the NUL terminated value following it. Matches and
+// values may straddle chunk boundaries, so the same code serves
+// verify_trustzone(), which hands over a whole mapped partition, and
+// firmware_info(), which reads the partition in chunks.
+class MarkerScanner {
+  public:
+    explicit MarkerScanner(std::vector<std::string> markers, size_t maxValueLen = kMaxValueLen);
+
+    void update(const uint8_t* data, size_t len);
+
+    // True once every marker has been found and its value is complete, the
+    // rest of the image doesn't need to be read.
+    bool done() const;
+
+    // The value after markers()[i], or nullopt if it wasn't found (yet). A
+    // value cut short by the end of the image is returned as is.
+    std::optional<std::string> value(size_t i) const;
+
+    const std::vector<std::string>& markers() const { return markers_; }
+
+  private:
+    struct Match {
+        bool found = false;
+        bool complete = false;
+        std::string value;
+    };
+
+    // Appends to the value of the match, returns the bytes consumed.
+    size_t capture(Match* match, const uint8_t* data, size_t len) const;
+    void search(size_t i, const uint8_t* data, size_t len);
+
+    std::vector<std::string> markers_;
+    size_t max_value_len_;
+    size_t max_marker_len_;
+    std::vector<Match> matches_;
+    // The end of the previous chunk, long enough to hold all but the last
+    // byte of any marker.
+    std::string tail_;
+};
+
+}  // namespace fwmarkers
@@ -17,6 +17,7 @@
 
 #include <errno.h>
 #include <fcntl.h>
+#include <inttypes.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -26,147 +27,418 @@
 #include <sys/types.h>
 #include <unistd.h>
 
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <memory>
 #include <string>
+#include <thread>
 #include <vector>
 
+#include <android-base/file.h>
+#include <android-base/properties.h>
+#include <android-base/stringprintf.h>
+#include <openssl/sha.h>
+#include <ziparchive/zip_archive.h>
+
 #include "edify/expr.h"
+#include "fwmarkers/MarkerScanner.h"
 #include "otautil/error_code.h"
+#include "updater/updater_interface.h"
 
-#define MAX(a, b) (((a) > (b)) ? (a) : (b))
-
-#define ALPHABET_LEN 256
+#define MIN(a, b) (((a) < (b)) ? (a) : (b))
 
 #define XBL_PART_PATH "/dev/block/bootdevice/by-name/xbl_a"
-#define TZ_VER_STR "QC_IMAGE_VERSION_STRING=TZ."
-#define TZ_VER_STR_LEN 27
-#define TZ_VER_BUF_LEN 255
 
-/* Boyer-Moore string search implementation from Wikipedia */
+#define FW_PART_DIR "/dev/block/bootdevice/by-name/"
+#define FW_SCAN_MAX_THREADS 4
+#define FW_SCAN_CHUNK_SIZE (1024 * 1024)
+#define FW_FLASH_BATCH 16
+
+using fwmarkers::MarkerScanner;
+
+static int get_info(std::string* value, const char* marker, const char* part_path) {
+    int ret = 0;
+    int fd;
+    off64_t size;
+    char* data = NULL;
+
+    fd = open(part_path, O_RDONLY);
+    if (fd < 0) {
+        ret = errno;
+        goto err_ret;
+    }
+
+    size = lseek64(fd, 0, SEEK_END);
+    if (size == -1) {
+        ret = errno;
+        goto err_fd_close;
+    }
 
-/* Return longest suffix length of suffix ending at str[p] */
-static int max_suffix_len(const char* str, size_t str_len, size_t p) {
-    uint32_t i;
+    data = (char*)mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data == (char*)-1) {
+        ret = errno;
+        goto err_fd_close;
+    }
 
-    for (i = 0; (str[p - i] == str[str_len - 1 - i]) && (i < p);) {
-        i++;
+    {
+        MarkerScanner scanner({marker});
+        scanner.update((const uint8_t*)data, size);
+        if (scanner.value(0)) {
+            *value = *scanner.value(0);
+        } else {
+            ret = -ENOENT;
+        }
     }
 
-    return i;
+    munmap(data, size);
+err_fd_close:
+    close(fd);
+err_ret:
+    return ret;
 }
 
-/* Generate table of distance between last character of pat and rightmost
- * occurrence of character c in pat
- */
-static void bm_make_delta1(int* delta1, const char* pat, size_t pat_len) {
-    uint32_t i;
-    for (i = 0; i < ALPHABET_LEN; i++) {
-        delta1[i] = pat_len;
+struct fw_part_info {
+    std::string name;
+    bool want_digest;
+    int ret;
+    std::string version;
+    std::string digest;
+};
+
+/* Partitions scanned by firmware_info() when the script does not name any */
+static const char* const default_fw_parts[] = {
+        "xbl", "tz", "hyp", "modem", "dsp", "abl",
+};
+
+static int open_fw_part(const std::string& name, int flags = O_RDONLY) {
+    std::string path = FW_PART_DIR + name;
+    int fd = open(path.c_str(), flags | O_CLOEXEC);
+    if (fd >= 0 || errno != ENOENT) {
+        return fd;
     }
-    for (i = 0; i < pat_len - 1; i++) {
-        uint8_t idx = (uint8_t)pat[i];
-        delta1[idx] = pat_len - 1 - i;
+
+    /* Slotted partitions are only touched on the slot which booted, without
+     * one there is no telling which copy the bootloader is going to run.
+     */
+    std::string suffix = android::base::GetProperty("ro.boot.slot_suffix", "");
+    if (suffix.empty()) {
+        errno = ENOENT;
+        return -1;
     }
+    path += suffix;
+
+    return open(path.c_str(), flags | O_CLOEXEC);
 }
 
-/* Generate table of next possible full match from mismatch at pat[p] */
-static void bm_make_delta2(int* delta2, const char* pat, size_t pat_len) {
-    int p;
-    uint32_t last_prefix = pat_len - 1;
+/* Scan a partition in place: the version lookup and the digest are both
+ * computed over the read-only mapping, no image data is copied.
+ */
+static void scan_fw_part(fw_part_info* info) {
+    int fd;
+    off64_t size;
+    char* data;
+
+    fd = open_fw_part(info->name);
+    if (fd < 0) {
+        info->ret = errno;
+        return;
+    }
+
+    size = lseek64(fd, 0, SEEK_END);
+    if (size <= 0) {
+        info->ret = size == 0 ? -ENODATA : errno;
+        close(fd);
+        return;
+    }
+
+    data = (char*)mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data == (char*)-1) {
+        info->ret = errno;
+        close(fd);
+        return;
+    }
+
+    if (info->want_digest) {
+        madvise(data, size, MADV_SEQUENTIAL);
+    }
 
-    for (p = pat_len - 1; p >= 0; p--) {
-        /* Compare whether pat[p-pat_len] is suffix of pat */
-        if (strncmp(pat + p, pat, pat_len - p) == 0) {
-            last_prefix = p + 1;
+    /* The version lookup and the digest share a single pass over the image,
+     * chunk by chunk so each piece is hashed while it is still in cache. The
+     * lookup alone stops as soon as the version is complete.
+     */
+    MarkerScanner scanner({fwmarkers::kImageVersionMarker});
+    SHA256_CTX ctx;
+    SHA256_Init(&ctx);
+    for (off64_t pos = 0; pos < size; pos += FW_SCAN_CHUNK_SIZE) {
+        size_t len = MIN((size_t)(size - pos), (size_t)FW_SCAN_CHUNK_SIZE);
+        if (!scanner.done()) {
+            scanner.update((const uint8_t*)data + pos, len);
+        } else if (!info->want_digest) {
+            break;
+        }
+        if (info->want_digest) {
+            SHA256_Update(&ctx, data + pos, len);
         }
-        delta2[p] = last_prefix + (pat_len - 1 - p);
     }
+    if (scanner.value(0)) {
+        info->version = *scanner.value(0);
+    }
+
+    if (info->want_digest) {
+        static const char hex[] = "0123456789abcdef";
+        uint8_t md[SHA256_DIGEST_LENGTH];
 
-    for (p = 0; p < (int)pat_len - 1; p++) {
-        /* Get longest suffix of pattern ending on character pat[p] */
-        int suf_len = max_suffix_len(pat, pat_len, p);
-        if (pat[p - suf_len] != pat[pat_len - 1 - suf_len]) {
-            delta2[pat_len - 1 - suf_len] = pat_len - 1 - p + suf_len;
+        SHA256_Final(md, &ctx);
+        info->digest.reserve(SHA256_DIGEST_LENGTH * 2);
+        for (size_t i = 0; i < SHA256_DIGEST_LENGTH; i++) {
+            info->digest.push_back(hex[md[i] >> 4]);
+            info->digest.push_back(hex[md[i] & 0xf]);
         }
     }
+
+    munmap(data, size);
+    close(fd);
+
+    info->ret = 0;
+}
+
+/* Run fn(0) ... fn(count - 1) on up to FW_SCAN_MAX_THREADS threads */
+static void run_parallel(size_t count, const std::function<void(size_t)>& fn) {
+    std::atomic<size_t> next(0);
+    size_t nr_threads = MIN(count, (size_t)FW_SCAN_MAX_THREADS);
+    std::vector<std::thread> workers;
+
+    auto worker = [count, &fn, &next]() {
+        size_t i;
+        while ((i = next.fetch_add(1)) < count) {
+            fn(i);
+        }
+    };
+
+    /* The calling thread takes a share of the work as well */
+    for (size_t i = 1; i < nr_threads; i++) {
+        workers.emplace_back(worker);
+    }
+    worker();
+
+    for (auto& t : workers) {
+        t.join();
+    }
 }
 
-static char* bm_search(const char* str, size_t str_len, const char* pat, size_t pat_len) {
-    int delta1[ALPHABET_LEN];
-    int delta2[pat_len];
-    int i;
+static void scan_fw_parts(std::vector<fw_part_info>& parts) {
+    run_parallel(parts.size(), [&parts](size_t i) { scan_fw_part(&parts[i]); });
+}
 
-    bm_make_delta1(delta1, pat, pat_len);
-    bm_make_delta2(delta2, pat, pat_len);
+/* firmware_info(["PART[:sha256]", ...])
+ *
+ * Returns one line per partition, in argument order:
+ *   PART|VERSION|SHA256
+ * VERSION is empty if no version string was found and SHA256 is empty unless
+ * requested. Fails if any of the partitions could not be read.
+ */
+Value* FirmwareInfoFn(const char* name, State* state,
+                      const std::vector<std::unique_ptr<Expr>>& argv) {
+    std::vector<std::string> args;
+    if (!ReadArgs(state, argv, &args)) {
+        return ErrorAbort(state, kArgsParsingFailure, "%s() error parsing arguments", name);
+    }
 
-    if (pat_len == 0) {
-        return (char*)str;
+    if (args.empty()) {
+        for (auto part : default_fw_parts) {
+            args.emplace_back(part);
+        }
     }
 
-    i = pat_len - 1;
-    while (i < (int)str_len) {
-        int j = pat_len - 1;
-        while (j >= 0 && (str[i] == pat[j])) {
-            i--;
-            j--;
+    std::vector<fw_part_info> parts;
+    parts.reserve(args.size());
+    for (auto& arg : args) {
+        fw_part_info info = {};
+        size_t sep = arg.find(':');
+        info.name = arg.substr(0, sep);
+        if (sep != std::string::npos) {
+            if (arg.compare(sep + 1, std::string::npos, "sha256") != 0) {
+                return ErrorAbort(state, kArgsParsingFailure, "%s() unknown option in \"%s\"",
+                                  name, arg.c_str());
+            }
+            info.want_digest = true;
         }
-        if (j < 0) {
-            return (char*)(str + i + 1);
+        if (info.name.empty() || info.name.find('/') != std::string::npos) {
+            return ErrorAbort(state, kArgsParsingFailure, "%s() invalid partition \"%s\"", name,
+                              arg.c_str());
         }
-        i += MAX(delta1[(uint8_t)str[i]], delta2[j]);
+        parts.push_back(std::move(info));
     }
 
-    return NULL;
+    scan_fw_parts(parts);
+
+    std::string result;
+    for (auto& part : parts) {
+        if (part.ret) {
+            return ErrorAbort(state, kFreadFailure, "%s() failed to read %s: %d", name,
+                              part.name.c_str(), part.ret);
+        }
+        if (!result.empty()) {
+            result += "\n";
+        }
+        result += part.name + "|" + part.version + "|" + part.digest;
+    }
+
+    return StringValue(result);
 }
 
-static int get_info(char* str, size_t len, char* lookup_str, size_t lookup_str_len,
-                    char* part_path) {
-    int ret = 0;
+struct fw_flash_ctx {
     int fd;
-    off64_t size;
-    char* data = NULL;
-    char* offset = NULL;
+    off64_t part_size;
+    /* Image bytes received but not compared yet, up to FW_FLASH_BATCH chunks */
+    std::vector<uint8_t> batch;
+    off64_t batch_offset;
+    uint64_t written;
+    uint64_t skipped;
+    int ret;
+};
 
-    fd = open(part_path, O_RDONLY);
-    if (fd < 0) {
-        ret = errno;
-        goto err_ret;
+/* Compare the batch with the partition, one chunk per thread, then write
+ * back only the chunks that differ, in order.
+ */
+static int flash_fw_batch(fw_flash_ctx* ctx) {
+    size_t nr_chunks = (ctx->batch.size() + FW_SCAN_CHUNK_SIZE - 1) / FW_SCAN_CHUNK_SIZE;
+    std::vector<int> changed(nr_chunks);
+    std::atomic<int> err(0);
+
+    run_parallel(nr_chunks, [ctx, &changed, &err](size_t i) {
+        size_t off = i * FW_SCAN_CHUNK_SIZE;
+        size_t len = MIN(ctx->batch.size() - off, (size_t)FW_SCAN_CHUNK_SIZE);
+        std::unique_ptr<uint8_t[]> cur(new uint8_t[len]);
+
+        if (!android::base::ReadFullyAtOffset(ctx->fd, cur.get(), len, ctx->batch_offset + off)) {
+            err = errno;
+            return;
+        }
+        changed[i] = memcmp(cur.get(), ctx->batch.data() + off, len) != 0;
+    });
+    if (err) {
+        return err;
     }
 
-    size = lseek64(fd, 0, SEEK_END);
-    if (size == -1) {
-        ret = errno;
-        goto err_fd_close;
+    for (size_t i = 0; i < nr_chunks; i++) {
+        size_t off = i * FW_SCAN_CHUNK_SIZE;
+        size_t len = MIN(ctx->batch.size() - off, (size_t)FW_SCAN_CHUNK_SIZE);
+
+        if (!changed[i]) {
+            ctx->skipped += len;
+            continue;
+        }
+        if (!android::base::WriteFullyAtOffset(ctx->fd, ctx->batch.data() + off, len,
+                                               ctx->batch_offset + off)) {
+            return errno;
+        }
+        ctx->written += len;
     }
 
-    data = (char*)mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
-    if (data == (char*)-1) {
-        ret = errno;
-        goto err_fd_close;
+    ctx->batch_offset += ctx->batch.size();
+    ctx->batch.clear();
+    return 0;
+}
+
+static bool flash_fw_chunk(const uint8_t* buf, size_t len, void* cookie) {
+    fw_flash_ctx* ctx = (fw_flash_ctx*)cookie;
+
+    while (len > 0) {
+        size_t n = MIN(len, (size_t)FW_FLASH_BATCH * FW_SCAN_CHUNK_SIZE - ctx->batch.size());
+        ctx->batch.insert(ctx->batch.end(), buf, buf + n);
+        buf += n;
+        len -= n;
+
+        if (ctx->batch.size() == (size_t)FW_FLASH_BATCH * FW_SCAN_CHUNK_SIZE &&
+            (ctx->ret = flash_fw_batch(ctx)) != 0) {
+            return false;
+        }
     }
 
-    /* Do Boyer-Moore search across data */
-    offset = bm_search(data, size, lookup_str, lookup_str_len);
-    if (offset != NULL) {
-        snprintf(str, len, "%s", offset + lookup_str_len);
-    } else {
-        ret = -ENOENT;
+    return true;
+}
+
+/* flash_firmware("PACKAGE_ENTRY", "PART")
+ *
+ * Writes the image stored in the package at PACKAGE_ENTRY to the firmware
+ * partition PART, skipping every chunk that already holds the same data.
+ * The image is streamed out of the package, compared against the partition
+ * on several threads and only the changed chunks are written. Returns the
+ * number of bytes skipped.
+ */
+Value* FlashFirmwareFn(const char* name, State* state,
+                       const std::vector<std::unique_ptr<Expr>>& argv) {
+    if (argv.size() != 2) {
+        return ErrorAbort(state, kArgsParsingFailure, "%s() expects 2 args, got %zu", name,
+                          argv.size());
     }
 
-    munmap(data, size);
-err_fd_close:
-    close(fd);
-err_ret:
-    return ret;
+    std::vector<std::string> args;
+    if (!ReadArgs(state, argv, &args)) {
+        return ErrorAbort(state, kArgsParsingFailure, "%s() error parsing arguments", name);
+    }
+    const std::string& entry_name = args[0];
+    const std::string& part = args[1];
+    if (part.empty() || part.find('/') != std::string::npos) {
+        return ErrorAbort(state, kArgsParsingFailure, "%s() invalid partition \"%s\"", name,
+                          part.c_str());
+    }
+
+    ZipArchiveHandle za = state->updater->GetPackageHandle();
+    ZipEntry entry;
+    if (FindEntry(za, entry_name, &entry) != 0) {
+        return ErrorAbort(state, kPackageExtractFileFailure, "%s() no %s in package", name,
+                          entry_name.c_str());
+    }
+
+    fw_flash_ctx ctx = {};
+    ctx.fd = open_fw_part(part, O_RDWR);
+    if (ctx.fd < 0) {
+        return ErrorAbort(state, kFileOpenFailure, "%s() failed to open %s: %d", name,
+                          part.c_str(), errno);
+    }
+
+    ctx.part_size = lseek64(ctx.fd, 0, SEEK_END);
+    if (ctx.part_size < 0 || (uint64_t)ctx.part_size < entry.uncompressed_length) {
+        close(ctx.fd);
+        return ErrorAbort(state, kVendorFailure, "%s() %s does not fit in %s", name,
+                          entry_name.c_str(), part.c_str());
+    }
+
+    ctx.batch.reserve((size_t)FW_FLASH_BATCH * FW_SCAN_CHUNK_SIZE);
+    int32_t zret = ProcessZipEntryContents(za, &entry, flash_fw_chunk, &ctx);
+    if (zret == 0 && !ctx.batch.empty()) {
+        ctx.ret = flash_fw_batch(&ctx);
+    }
+    if (zret == 0 && ctx.ret == 0 && ctx.written > 0 && fsync(ctx.fd) < 0) {
+        ctx.ret = errno;
+    }
+    close(ctx.fd);
+
+    if (ctx.ret) {
+        return ErrorAbort(state, kFwriteFailure, "%s() failed to flash %s: %d", name,
+                          part.c_str(), ctx.ret);
+    }
+    if (zret != 0) {
+        return ErrorAbort(state, kPackageExtractFileFailure, "%s() failed to extract %s: %s",
+                          name, entry_name.c_str(), ErrorCodeString(zret));
+    }
+
+    state->updater->UiPrint(android::base::StringPrintf(
+            "%s: wrote %" PRIu64 " KiB, %" PRIu64 " KiB unchanged", part.c_str(),
+            ctx.written / 1024, ctx.skipped / 1024));
+    return StringValue(std::to_string(ctx.skipped));
 }
 
 /* verify_trustzone("TZ_VERSION", "TZ_VERSION", ...) */
 Value* VerifyTrustZoneFn(const char* name, State* state,
                      const std::vector<std::unique_ptr<Expr>>& argv) {
-    char current_tz_version[TZ_VER_BUF_LEN];
+    std::string current_tz_version;
     int ret;
 
-    ret = get_info(current_tz_version, TZ_VER_BUF_LEN, TZ_VER_STR, TZ_VER_STR_LEN,
-                   XBL_PART_PATH);
+    ret = get_info(&current_tz_version, fwmarkers::kTrustZoneVersionMarker, XBL_PART_PATH);
     if (ret) {
         return ErrorAbort(state, kFreadFailure,
                           "%s() failed to read current TZ version: %d", name, ret);
@@ -179,7 +451,7 @@ Value* VerifyTrustZoneFn(const char* name, State* state,
 
     ret = 0;
     for (auto &tz_version : args) {
-        if (strncmp(tz_version.c_str(), current_tz_version, tz_version.length()) == 0) {
+        if (strncmp(tz_version.c_str(), current_tz_version.c_str(), tz_version.length()) == 0) {
             ret = 1;
             break;
         }
@@ -189,5 +461,7 @@ Value* VerifyTrustZoneFn(const char* name, State* state,
 }
 
 void Register_librecovery_updater_raphael() {
+    RegisterFunction("xiaomi.firmware_info", FirmwareInfoFn);
+    RegisterFunction("xiaomi.flash_firmware", FlashFirmwareFn);
     RegisterFunction("xiaomi.verify_trustzone", VerifyTrustZoneFn);
 }
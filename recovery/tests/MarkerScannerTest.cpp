@@ -0,0 +1,106 @@
+/*
+ * Copyright (C) 2021 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdint.h>
+
+#include <algorithm>
+#include <string>
+
+#include <gtest/gtest.h>
+
+#include "fwmarkers/MarkerScanner.h"
+
+namespace fwmarkers {
+namespace {
+
+using namespace std::string_literals;
+
+// Filler, then a near miss of the TZ marker and the image version of the
+// boot loader, and finally the TZ version which verify_trustzone() looks for.
+std::string Image() {
+    std::string image;
+    for (int i = 0; i < 3000; i++) {
+        image += static_cast<char>('A' + i * 7 % 26);
+    }
+    image += "QC_IMAGE_VERSION_STRING=T\0"s;
+    image += std::string(517, 'Q');
+    image += "QC_IMAGE_VERSION_STRING=BOOT.XF.3.0-00123\0"s;
+    image += std::string(1021, '\0');
+    image += "QC_IMAGE_VERSION_STRING=TZ.XF.5.0-00456\0"s;
+    image += std::string(300, 'x');
+    return image;
+}
+
+void Feed(MarkerScanner* scanner, const std::string& image, size_t chunk) {
+    for (size_t pos = 0; pos < image.size(); pos += chunk) {
+        size_t len = std::min(chunk, image.size() - pos);
+        scanner->update(reinterpret_cast<const uint8_t*>(image.data() + pos), len);
+    }
+}
+
+class MarkerScannerTest : public ::testing::TestWithParam<size_t> {};
+
+TEST_P(MarkerScannerTest, FindsMarkersAcrossChunks) {
+    std::string image = Image();
+    MarkerScanner scanner({kTrustZoneVersionMarker, kImageVersionMarker, "NOT_THERE"});
+    Feed(&scanner, image, GetParam());
+
+    EXPECT_EQ(scanner.value(0), "XF.5.0-00456");
+    EXPECT_EQ(scanner.value(1), "T");
+    EXPECT_EQ(scanner.value(2), std::nullopt);
+    EXPECT_FALSE(scanner.done());
+}
+
+TEST_P(MarkerScannerTest, CapturesValuesAcrossChunks) {
+    std::string image = Image();
+    MarkerScanner scanner({"BOOT."}, 8);
+    Feed(&scanner, image, GetParam());
+
+    // Cut at the maximum length instead of the NUL.
+    EXPECT_EQ(scanner.value(0), "XF.3.0-0");
+    EXPECT_TRUE(scanner.done());
+}
+
+TEST_P(MarkerScannerTest, KeepsValuesCutShortByTheEnd) {
+    std::string image = Image() + "QC_IMAGE_VERSION_STRING=MPSS.HT";
+    MarkerScanner scanner({"STRING=MPSS."});
+    Feed(&scanner, image, GetParam());
+
+    EXPECT_EQ(scanner.value(0), "HT");
+    EXPECT_FALSE(scanner.done());
+}
+
+// Every chunk size below the marker length, a few odd ones and the whole
+// image in one go.
+INSTANTIATE_TEST_SUITE_P(ChunkSizes, MarkerScannerTest,
+                         ::testing::Values(1, 2, 3, 5, 7, 11, 13, 17, 19, 23, 26, 27, 29, 31, 61,
+                                           509, 4093, Image().size(), 1 << 20));
+
+TEST(MarkerScannerTest, FindsMarkersWhichStraddleEveryOffset) {
+    std::string marker = kTrustZoneVersionMarker;
+    for (size_t split = 1; split < marker.size(); split++) {
+        std::string image = std::string(64 - split, 'Q') + marker + "XF.5.0\0"s;
+        for (size_t chunk : {64, 61, 3}) {
+            MarkerScanner scanner({kTrustZoneVersionMarker});
+            Feed(&scanner, image, chunk);
+            EXPECT_EQ(scanner.value(0), "XF.5.0") << "split " << split << " chunk " << chunk;
+            EXPECT_TRUE(scanner.done());
+        }
+    }
+}
+
+}  // namespace
+}  // namespace fwmarkers
@@ -1,6 +1,6 @@
 # Copyright (C) 2009 The Android Open Source Project
 # Copyright (c) 2011, The Linux Foundation. All rights reserved.
-# Copyright (C) 2017-2020 The LineageOS Project
+# Copyright (C) 2017-2021 The LineageOS Project
 #
 # Licensed under the Apache License, Version 2.0 (the "License");
 # you may not use this file except in compliance with the License.
@@ -43,18 +43,44 @@ def AddImage(info, basename, dest):
   common.ZipWriteStr(info.output_zip, basename, data)
   info.script.AppendExtra('package_extract_file("%s", "%s");' % (basename, dest))
 
+# Firmware partitions flashed from RADIO/<name>.img when the target files carry them
+FIRMWARE_PARTITIONS = ["xbl", "tz", "hyp", "modem", "dsp", "abl"]
+
+def GetFirmwareImages(input_zip):
+  names = input_zip.namelist()
+  return [name for name in FIRMWARE_PARTITIONS if "RADIO/" + name + ".img" in names]
+
+def AddFirmwareImage(info, name):
+  # xiaomi.flash_firmware() only rewrites the chunks which changed
+  data = info.input_zip.read("RADIO/" + name + ".img")
+  common.ZipWriteStr(info.output_zip, "firmware-update/" + name + ".img", data)
+  info.script.AppendExtra('xiaomi.flash_firmware("firmware-update/%s.img", "%s");' % (name, name))
+
 def OTA_InstallEnd(info):
   info.script.Print("Patching dtbo and vbmeta images...")
   AddImage(info, "dtbo.img", "/dev/block/bootdevice/by-name/dtbo")
   AddImage(info, "vbmeta.img", "/dev/block/bootdevice/by-name/vbmeta")
+  for name in GetFirmwareImages(info.input_zip):
+    AddFirmwareImage(info, name)
   return
 
-def AddTrustZoneAssertion(info, input_zip):
-  android_info = info.input_zip.read("OTA/android-info.txt")
-  m = re.search(r'require\s+version-trustzone\s*=\s*(\S+)'.encode('utf-8'), android_info)
+def GetTrustZoneVersions(info, input_zip):
+  android_info = info.input_zip.read("OTA/android-info.txt").decode('utf-8')
+  m = re.search(r'require\s+version-trustzone\s*=\s*(\S+)', android_info)
   if m:
-    versions = m.group(1).split('|')
-    if len(versions) and '*' not in versions:
-      cmd = 'assert(xiaomi.verify_trustzone(' + ','.join(['"%s"' % tz for tz in versions]) + ') == "1" || abort("ERROR: This package requires firmware from an Android 10 based MIUI build. Please upgrade firmware and retry!"););'
-      info.script.AppendExtra(cmd)
+    return m.group(1).split('|')
+  return []
+
+def AddTrustZoneAssertion(info, input_zip):
+  versions = GetTrustZoneVersions(info, input_zip)
+  if len(versions) and '*' not in versions:
+    cmd = 'assert(xiaomi.verify_trustzone(' + ','.join(['"%s"' % tz for tz in versions]) + ') == "1" || abort("ERROR: This package requires firmware from an Android 10 based MIUI build. Please upgrade firmware and retry!"););'
+    info.script.AppendExtra(cmd)
+
+  # A package which carries firmware still requires a compatible base. Its
+  # partitions are resolved here, before anything is written, so a device
+  # on which they can't be found is refused instead of half updated.
+  images = GetFirmwareImages(input_zip)
+  if images:
+    info.script.AppendExtra('xiaomi.firmware_info(%s);' % ', '.join(['"%s"' % name for name in images]))
   return
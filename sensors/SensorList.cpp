@@ -0,0 +1,122 @@
+/*
+ * Copyright (C) 2021 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "SensorList.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <android-base/stringprintf.h>
+#include <android-base/strings.h>
+
+using ::android::base::StringPrintf;
+
+namespace subhal {
+
+namespace {
+
+constexpr const char* kHeader = "# sensors 1 ";
+constexpr size_t kNumFields = 15;
+
+}  // anonymous namespace
+
+const char* SensorList::intern(const char* str) {
+    if (str == nullptr) {
+        return nullptr;
+    }
+    strings_.emplace_back(str);
+    return strings_.back().c_str();
+}
+
+void SensorList::assign(const sensor_t* list, int count) {
+    sensors.clear();
+    strings_.clear();
+    for (int i = 0; i < count; i++) {
+        sensor_t s = list[i];
+        s.name = intern(s.name);
+        s.vendor = intern(s.vendor);
+        s.stringType = intern(s.stringType);
+        s.requiredPermission = intern(s.requiredPermission);
+        sensors.push_back(s);
+    }
+}
+
+std::string SensorList::serialize() const {
+    std::string out = StringPrintf("%s%d %s\n", kHeader, deviceVersion, fingerprint.c_str());
+    for (const auto& s : sensors) {
+        // Floats in hex so they read back bit for bit.
+        out += StringPrintf("%s\t%s\t%d\t%d\t%d\t%a\t%a\t%a\t%" PRId32 "\t%" PRIu32 "\t%" PRIu32
+                            "\t%s\t%s\t%" PRId64 "\t%" PRIu64 "\n",
+                            s.name ? s.name : "", s.vendor ? s.vendor : "", s.version, s.handle,
+                            s.type, s.maxRange, s.resolution, s.power, s.minDelay,
+                            s.fifoReservedEventCount, s.fifoMaxEventCount,
+                            s.stringType ? s.stringType : "",
+                            s.requiredPermission ? s.requiredPermission : "",
+                            static_cast<int64_t>(s.maxDelay), static_cast<uint64_t>(s.flags));
+    }
+    return out;
+}
+
+bool SensorList::parse(const std::string& buf) {
+    std::vector<std::string> lines = android::base::Split(buf, "\n");
+    if (lines.empty() || !android::base::StartsWith(lines[0], kHeader)) {
+        return false;
+    }
+
+    std::string header = lines[0].substr(strlen(kHeader));
+    size_t space = header.find(' ');
+    if (space == std::string::npos) {
+        return false;
+    }
+    deviceVersion = strtol(header.c_str(), nullptr, 0);
+    fingerprint = header.substr(space + 1);
+
+    sensors.clear();
+    strings_.clear();
+    for (size_t i = 1; i < lines.size(); i++) {
+        if (lines[i].empty()) {
+            continue;
+        }
+
+        std::vector<std::string> f = android::base::Split(lines[i], "\t");
+        if (f.size() != kNumFields) {
+            return false;
+        }
+
+        sensor_t s = {};
+        s.name = intern(f[0].c_str());
+        s.vendor = intern(f[1].c_str());
+        s.version = strtol(f[2].c_str(), nullptr, 10);
+        s.handle = strtol(f[3].c_str(), nullptr, 10);
+        s.type = strtol(f[4].c_str(), nullptr, 10);
+        s.maxRange = strtof(f[5].c_str(), nullptr);
+        s.resolution = strtof(f[6].c_str(), nullptr);
+        s.power = strtof(f[7].c_str(), nullptr);
+        s.minDelay = strtol(f[8].c_str(), nullptr, 10);
+        s.fifoReservedEventCount = strtoul(f[9].c_str(), nullptr, 10);
+        s.fifoMaxEventCount = strtoul(f[10].c_str(), nullptr, 10);
+        s.stringType = intern(f[11].c_str());
+        s.requiredPermission = f[12].empty() ? nullptr : intern(f[12].c_str());
+        s.maxDelay = strtoll(f[13].c_str(), nullptr, 10);
+        s.flags = strtoull(f[14].c_str(), nullptr, 10);
+        sensors.push_back(s);
+    }
+    return true;
+}
+
+}  // namespace subhal
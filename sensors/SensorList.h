@@ -0,0 +1,57 @@
+/*
+ * Copyright (C) 2021 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <hardware/sensors.h>
+
+#include <deque>
+#include <string>
+#include <vector>
+
+namespace subhal {
+
+// A sub-HAL's sensor list, owning the strings the sensor_t entries point to.
+// Cached on disk so a lazily loaded sub-HAL can announce its sensors without
+// being loaded.
+//
+//   # sensors 1 <device api version> <build fingerprint>
+//   <one tab separated sensor_t per line>
+struct SensorList {
+    int deviceVersion = 0;
+    std::string fingerprint;
+    std::vector<sensor_t> sensors;
+
+    SensorList() = default;
+    SensorList(const SensorList&) = delete;
+    SensorList& operator=(const SensorList&) = delete;
+
+    // Deep copies list, which belongs to the sub-HAL.
+    void assign(const sensor_t* list, int count);
+
+    std::string serialize() const;
+
+    // Returns false on malformed input.
+    bool parse(const std::string& buf);
+
+  private:
+    const char* intern(const char* str);
+
+    // A deque never moves its elements, the c_str()s stay valid.
+    std::deque<std::string> strings_;
+};
+
+}  // namespace subhal
@@ -0,0 +1,308 @@
+/*
+ * Copyright (C) 2021 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "sensors.subhal"
+
+#include "SubHal.h"
+
+#include <dlfcn.h>
+#include <errno.h>
+#include <time.h>
+
+#include <algorithm>
+
+#include <android-base/file.h>
+#include <android-base/logging.h>
+#include <android-base/properties.h>
+
+using ::android::base::GetProperty;
+using ::android::base::ReadFileToString;
+using ::android::base::WriteStringToFile;
+
+namespace subhal {
+
+namespace {
+
+// The sensor list only changes with the vendor build.
+constexpr const char* kFingerprintProp = "ro.vendor.build.fingerprint";
+
+int64_t NowUs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000LL + ts.tv_nsec / 1000;
+}
+
+}  // anonymous namespace
+
+SubHal::SubHal(std::string library, bool lazy, std::string cachePath)
+    : library_(std::move(library)),
+      lazy_(lazy),
+      cache_path_(std::move(cachePath)),
+      fingerprint_(GetProperty(kFingerprintProp, "")) {}
+
+bool SubHal::readCacheLocked() {
+    std::string buf;
+    if (!ReadFileToString(cache_path_, &buf) || !list_.parse(buf) ||
+        list_.fingerprint != fingerprint_) {
+        return false;
+    }
+    return true;
+}
+
+void SubHal::writeCacheLocked() {
+    list_.fingerprint = fingerprint_;
+    std::string tmpPath = cache_path_ + ".tmp";
+    if (!WriteStringToFile(list_.serialize(), tmpPath) ||
+        rename(tmpPath.c_str(), cache_path_.c_str()) < 0) {
+        PLOG(WARNING) << "Failed to cache the sensor list in " << cache_path_;
+        unlink(tmpPath.c_str());
+    }
+}
+
+bool SubHal::loadLocked(const char* reason) {
+    if (device_ != nullptr) {
+        return true;
+    }
+    if (load_failed_) {
+        return false;
+    }
+
+    int64_t start = NowUs();
+    void* handle = dlopen(library_.c_str(), RTLD_NOW);
+    sensors_module_t* module =
+            handle ? static_cast<sensors_module_t*>(dlsym(handle, HAL_MODULE_INFO_SYM_AS_STR))
+                   : nullptr;
+    if (module == nullptr) {
+        LOG(ERROR) << "Failed to load " << library_ << ": " << dlerror();
+        load_failed_ = true;
+        return false;
+    }
+    module->common.dso = handle;
+    module_ = module;
+    int64_t dlopenUs = NowUs() - start;
+
+    const sensor_t* list;
+    int count = module->get_sensors_list(module, &list);
+    int64_t listUs = NowUs() - start - dlopenUs;
+
+    hw_device_t* device = nullptr;
+    int ret = module->common.methods->open(&module->common, SENSORS_HARDWARE_POLL, &device);
+    if (ret != 0 || device == nullptr) {
+        LOG(ERROR) << "Failed to open " << library_ << ": " << ret;
+        load_failed_ = true;
+        return false;
+    }
+    int64_t openUs = NowUs() - start - dlopenUs - listUs;
+
+    // The list announced from the cache must be the one the sub-HAL has.
+    SensorList loaded;
+    loaded.assign(list, std::max(count, 0));
+    loaded.deviceVersion = device->version;
+    loaded.fingerprint = fingerprint_;
+    if (!listed_ || loaded.serialize() != list_.serialize()) {
+        if (listed_) {
+            LOG(WARNING) << "Cached sensor list of " << library_ << " is stale";
+        }
+        list_.assign(list, std::max(count, 0));
+        list_.deviceVersion = loaded.deviceVersion;
+        writeCacheLocked();
+    }
+    listed_ = true;
+
+    device_ = reinterpret_cast<sensors_poll_device_1_t*>(device);
+    for (const auto& [sensor, b] : batches_) {
+        device_->batch(device_, sensor, b.flags, b.periodNs, b.latencyNs);
+    }
+    polled_device_ = device_;
+
+    LOG(INFO) << "event=load lib=" << library_ << " reason=" << reason
+              << " sensors=" << count << " dlopen_us=" << dlopenUs << " list_us=" << listUs
+              << " open_us=" << openUs;
+    loaded_cv_.notify_all();
+    return true;
+}
+
+int SubHal::getSensorsList(const sensor_t** list) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!listed_) {
+        if (lazy_ && readCacheLocked()) {
+            listed_ = true;
+            LOG(INFO) << "event=deferred lib=" << library_ << " sensors=" << list_.sensors.size();
+        } else if (!loadLocked(lazy_ ? "no_cache" : "startup")) {
+            *list = nullptr;
+            return 0;
+        }
+    }
+    *list = list_.sensors.data();
+    return list_.sensors.size();
+}
+
+int SubHal::deviceVersion() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return list_.deviceVersion;
+}
+
+int SubHal::open() {
+    const sensor_t* list;
+    getSensorsList(&list);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!lazy_ && !loadLocked("startup")) {
+        return -ENODEV;
+    }
+    return load_failed_ ? -ENODEV : 0;
+}
+
+int SubHal::activate(int handle, int enabled) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (device_ == nullptr && !enabled) {
+        return 0;
+    }
+
+    int64_t start = NowUs();
+    if (!loadLocked("activate")) {
+        return -ENODEV;
+    }
+
+    // Tracked before the call, the first event may beat its return.
+    if (enabled) {
+        std::lock_guard<std::mutex> pending(pending_lock_);
+        pending_first_event_[handle] = start;
+        has_pending_ = true;
+    }
+
+    int ret = device_->activate(&device_->v0, handle, enabled);
+    int64_t now = NowUs();
+    if (enabled && ret == 0) {
+        LOG(INFO) << "event=activate lib=" << library_ << " handle=" << handle
+                  << " took_us=" << now - start;
+    } else {
+        std::lock_guard<std::mutex> pending(pending_lock_);
+        pending_first_event_.erase(handle);
+        has_pending_ = !pending_first_event_.empty();
+    }
+    return ret;
+}
+
+int SubHal::setDelay(int handle, int64_t periodNs) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (device_ == nullptr) {
+        batches_[handle] = {0, periodNs, 0};
+        return 0;
+    }
+    return device_->setDelay(&device_->v0, handle, periodNs);
+}
+
+int SubHal::batch(int handle, int flags, int64_t periodNs, int64_t latencyNs) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    batches_[handle] = {flags, periodNs, latencyNs};
+    if (device_ == nullptr) {
+        return 0;
+    }
+    return device_->batch(device_, handle, flags, periodNs, latencyNs);
+}
+
+int SubHal::flush(int handle) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    // Nothing is active before the sub-HAL is loaded.
+    return device_ ? device_->flush(device_, handle) : -EINVAL;
+}
+
+int SubHal::injectSensorData(const sensors_event_t* data) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (device_ == nullptr || device_->common.version < SENSORS_DEVICE_API_VERSION_1_1) {
+        return -EPERM;
+    }
+    return device_->inject_sensor_data(device_, data);
+}
+
+int SubHal::registerDirectChannel(const sensors_direct_mem_t* mem, int channelHandle) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    // Nothing was registered before the sub-HAL is loaded.
+    if (device_ == nullptr && mem == nullptr) {
+        return 0;
+    }
+    if (!loadLocked("direct_channel")) {
+        return -ENODEV;
+    }
+    if (device_->common.version < SENSORS_DEVICE_API_VERSION_1_4 ||
+        device_->register_direct_channel == nullptr) {
+        return -EINVAL;
+    }
+    return device_->register_direct_channel(device_, mem, channelHandle);
+}
+
+int SubHal::configDirectReport(int sensorHandle, int channelHandle,
+                               const sensors_direct_cfg_t* config) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!loadLocked("direct_report")) {
+        return -ENODEV;
+    }
+    if (device_->common.version < SENSORS_DEVICE_API_VERSION_1_4 ||
+        device_->config_direct_report == nullptr) {
+        return -EINVAL;
+    }
+    return device_->config_direct_report(device_, sensorHandle, channelHandle, config);
+}
+
+int SubHal::setOperationMode(unsigned int mode) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    // A sub-HAL which isn't loaded is already in the normal mode.
+    if (device_ == nullptr && mode == SENSOR_HAL_NORMAL_MODE) {
+        return 0;
+    }
+    if (!loadLocked("operation_mode")) {
+        return -ENODEV;
+    }
+    if (module_->set_operation_mode == nullptr) {
+        return mode == SENSOR_HAL_NORMAL_MODE ? 0 : -EINVAL;
+    }
+    return module_->set_operation_mode(mode);
+}
+
+int SubHal::poll(sensors_event_t* data, int count) {
+    sensors_poll_device_1_t* device = polled_device_;
+    if (device == nullptr) {
+        // The multi-HAL polls again straight away on an error, so a sub-HAL
+        // which failed to load keeps its polling thread parked here for good
+        // rather than spinning it.
+        std::unique_lock<std::mutex> lock(mutex_);
+        loaded_cv_.wait(lock, [this] { return device_ != nullptr; });
+        device = device_;
+    }
+
+    int n = device->poll(&device->v0, data, count);
+    if (n > 0 && has_pending_) {
+        trackFirstEvents(data, n);
+    }
+    return n;
+}
+
+void SubHal::trackFirstEvents(const sensors_event_t* data, int count) {
+    int64_t now = NowUs();
+    std::lock_guard<std::mutex> lock(pending_lock_);
+    for (int i = 0; i < count && !pending_first_event_.empty(); i++) {
+        auto it = pending_first_event_.find(data[i].sensor);
+        if (it != pending_first_event_.end()) {
+            LOG(INFO) << "event=first_event lib=" << library_ << " handle=" << it->first
+                      << " latency_us=" << now - it->second;
+            pending_first_event_.erase(it);
+        }
+    }
+    has_pending_ = !pending_first_event_.empty();
+}
+
+}  // namespace subhal
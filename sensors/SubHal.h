@@ -0,0 +1,102 @@
+/*
+ * Copyright (C) 2021 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <hardware/sensors.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <string>
+
+#include "SensorList.h"
+
+namespace subhal {
+
+// Stands in for one sub-HAL of the sensors multi-HAL. It logs how long the
+// library takes to load and open, and how long every activation takes until
+// the first event, as "event=..." lines.
+//
+// A lazy sub-HAL announces its sensors from a list cached on an earlier
+// boot and is only loaded once one of them is activated. Batch parameters
+// set before that are replayed on load, and poll() blocks until then, or
+// forever if the sub-HAL fails to load.
+//
+// The sub-HAL's device version is passed through as is, along with its
+// direct channels and operation modes.
+class SubHal {
+  public:
+    SubHal(std::string library, bool lazy, std::string cachePath);
+
+    int getSensorsList(const sensor_t** list);
+    int deviceVersion();
+
+    // Eager sub-HALs are loaded here.
+    int open();
+
+    int activate(int handle, int enabled);
+    int setDelay(int handle, int64_t periodNs);
+    int batch(int handle, int flags, int64_t periodNs, int64_t latencyNs);
+    int flush(int handle);
+    int poll(sensors_event_t* data, int count);
+    int injectSensorData(const sensors_event_t* data);
+    int registerDirectChannel(const sensors_direct_mem_t* mem, int channelHandle);
+    int configDirectReport(int sensorHandle, int channelHandle, const sensors_direct_cfg_t* config);
+    int setOperationMode(unsigned int mode);
+
+  private:
+    struct Batch {
+        int flags;
+        int64_t periodNs;
+        int64_t latencyNs;
+    };
+
+    // Called with mutex_ held.
+    bool loadLocked(const char* reason);
+    bool readCacheLocked();
+    void writeCacheLocked();
+
+    void trackFirstEvents(const sensors_event_t* data, int count);
+
+    const std::string library_;
+    const bool lazy_;
+    const std::string cache_path_;
+    const std::string fingerprint_;
+
+    // Held across calls into the sub-HAL, which may block. poll() never
+    // takes it once the sub-HAL is loaded.
+    std::mutex mutex_;
+    std::condition_variable loaded_cv_;
+    bool listed_ = false;
+    bool load_failed_ = false;
+    SensorList list_;
+    sensors_module_t* module_ = nullptr;
+    sensors_poll_device_1_t* device_ = nullptr;
+    // device_ for poll(), set once the sub-HAL is up.
+    std::atomic<sensors_poll_device_1_t*> polled_device_{nullptr};
+    std::map<int, Batch> batches_;
+
+    // Activation time of the sensors still waiting for their first event.
+    std::mutex pending_lock_;
+    std::map<int, int64_t> pending_first_event_;
+    // Lets poll() skip pending_lock_ while nothing is waiting.
+    std::atomic<bool> has_pending_{false};
+};
+
+}  // namespace subhal
@@ -0,0 +1,165 @@
+/*
+ * Copyright (C) 2021 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "sensors.subhal"
+
+#include <dlfcn.h>
+#include <errno.h>
+#include <hardware/sensors.h>
+#include <string.h>
+
+#include <string>
+
+#include <android-base/logging.h>
+#include <android-base/strings.h>
+
+#include "SubHal.h"
+
+using ::subhal::SubHal;
+
+// The wrapped library follows from the name this one is installed as:
+//
+//   sensors.<name>.lazy.so      loads sensors.<name>.so on first activation
+//   sensors.<name>.profiled.so  loads sensors.<name>.so right away
+//
+// so hals.conf picks the behaviour per sub-HAL by listing the wrapper.
+
+namespace {
+
+constexpr const char* kCacheDir = "/data/vendor/sensorhal/";
+
+SubHal* GetSubHal();
+
+SubHal* CreateSubHal() {
+    Dl_info info;
+    std::string self = "sensors.unknown.profiled.so";
+    if (dladdr(reinterpret_cast<const void*>(&GetSubHal), &info) && info.dli_fname) {
+        self = info.dli_fname;
+        self = self.substr(self.rfind('/') + 1);
+    }
+
+    bool lazy = android::base::EndsWith(self, ".lazy.so");
+    std::string suffix = lazy ? ".lazy.so" : ".profiled.so";
+    std::string base = android::base::EndsWith(self, suffix)
+                               ? self.substr(0, self.size() - suffix.size())
+                               : self.substr(0, self.rfind(".so"));
+
+    return new SubHal(base + ".so", lazy, kCacheDir + base + ".list");
+}
+
+SubHal* GetSubHal() {
+    static SubHal* sSubHal = CreateSubHal();
+    return sSubHal;
+}
+
+int DeviceClose(hw_device_t* device) {
+    delete reinterpret_cast<sensors_poll_device_1_t*>(device);
+    return 0;
+}
+
+int DeviceActivate(sensors_poll_device_t*, int handle, int enabled) {
+    return GetSubHal()->activate(handle, enabled);
+}
+
+int DeviceSetDelay(sensors_poll_device_t*, int handle, int64_t periodNs) {
+    return GetSubHal()->setDelay(handle, periodNs);
+}
+
+int DevicePoll(sensors_poll_device_t*, sensors_event_t* data, int count) {
+    return GetSubHal()->poll(data, count);
+}
+
+int DeviceBatch(sensors_poll_device_1_t*, int handle, int flags, int64_t periodNs,
+                int64_t latencyNs) {
+    return GetSubHal()->batch(handle, flags, periodNs, latencyNs);
+}
+
+int DeviceFlush(sensors_poll_device_1_t*, int handle) {
+    return GetSubHal()->flush(handle);
+}
+
+int DeviceInjectSensorData(sensors_poll_device_1_t*, const sensors_event_t* data) {
+    return GetSubHal()->injectSensorData(data);
+}
+
+int DeviceRegisterDirectChannel(sensors_poll_device_1_t*, const sensors_direct_mem_t* mem,
+                                int channelHandle) {
+    return GetSubHal()->registerDirectChannel(mem, channelHandle);
+}
+
+int DeviceConfigDirectReport(sensors_poll_device_1_t*, int sensorHandle, int channelHandle,
+                             const sensors_direct_cfg_t* config) {
+    return GetSubHal()->configDirectReport(sensorHandle, channelHandle, config);
+}
+
+int ModuleGetSensorsList(sensors_module_t*, const sensor_t** list) {
+    return GetSubHal()->getSensorsList(list);
+}
+
+int ModuleSetOperationMode(unsigned int mode) {
+    return GetSubHal()->setOperationMode(mode);
+}
+
+int ModuleOpen(const hw_module_t* module, const char* id, hw_device_t** device) {
+    if (strcmp(id, SENSORS_HARDWARE_POLL) != 0) {
+        return -EINVAL;
+    }
+
+    int ret = GetSubHal()->open();
+    if (ret != 0) {
+        return ret;
+    }
+
+    sensors_poll_device_1_t* dev = new sensors_poll_device_1_t();
+    dev->common.tag = HARDWARE_DEVICE_TAG;
+    dev->common.version = GetSubHal()->deviceVersion();
+    dev->common.module = const_cast<hw_module_t*>(module);
+    dev->common.close = DeviceClose;
+    dev->activate = DeviceActivate;
+    dev->setDelay = DeviceSetDelay;
+    dev->poll = DevicePoll;
+    dev->batch = DeviceBatch;
+    dev->flush = DeviceFlush;
+    dev->inject_sensor_data = DeviceInjectSensorData;
+    if (dev->common.version >= SENSORS_DEVICE_API_VERSION_1_4) {
+        dev->register_direct_channel = DeviceRegisterDirectChannel;
+        dev->config_direct_report = DeviceConfigDirectReport;
+    }
+
+    *device = &dev->common;
+    return 0;
+}
+
+hw_module_methods_t sModuleMethods = {
+        .open = ModuleOpen,
+};
+
+}  // anonymous namespace
+
+sensors_module_t HAL_MODULE_INFO_SYM = {
+        .common =
+                {
+                        .tag = HARDWARE_MODULE_TAG,
+                        .module_api_version = SENSORS_MODULE_API_VERSION_0_1,
+                        .hal_api_version = HARDWARE_HAL_API_VERSION,
+                        .id = SENSORS_HARDWARE_MODULE_ID,
+                        .name = "Profiling and lazy loading sensors sub-HAL",
+                        .author = "The LineageOS Project",
+                        .methods = &sModuleMethods,
+                },
+        .get_sensors_list = ModuleGetSensorsList,
+        .set_operation_mode = ModuleSetOperationMode,
+};
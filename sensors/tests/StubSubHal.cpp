@@ -0,0 +1,176 @@
+/*
+ * Copyright (C) 2021 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// A sensors_module_t for SubHal to load, driven by the test through
+// gStubControl.
+
+#include <errno.h>
+#include <string.h>
+
+#include "StubSubHal.h"
+
+using ::subhal::testing::kStubAccelHandle;
+using ::subhal::testing::kStubLightHandle;
+using ::subhal::testing::StubControl;
+
+extern "C" {
+StubControl gStubControl;
+}
+
+namespace {
+
+const sensor_t kSensors[] = {
+        {.name = "Stub Accelerometer",
+         .vendor = "LineageOS",
+         .version = 1,
+         .handle = kStubAccelHandle,
+         .type = 1,
+         .maxRange = 78.4f,
+         .resolution = 0.01f,
+         .power = 0.2f,
+         .minDelay = 5000,
+         .stringType = "android.sensor.accelerometer",
+         .maxDelay = 200000},
+        {.name = "Stub Light",
+         .vendor = "LineageOS",
+         .version = 1,
+         .handle = kStubLightHandle,
+         .type = 5,
+         .maxRange = 10000.0f,
+         .resolution = 1.0f,
+         .power = 0.1f,
+         .stringType = "android.sensor.light",
+         .flags = 2 /* SENSOR_FLAG_ON_CHANGE_MODE */},
+};
+
+int Activate(sensors_poll_device_t*, int handle, int enabled) {
+    std::unique_lock<std::mutex> lock(gStubControl.lock);
+    gStubControl.inActivate = true;
+    gStubControl.cv.notify_all();
+    gStubControl.cv.wait(lock, [] { return !gStubControl.blockActivate; });
+    gStubControl.inActivate = false;
+    if (enabled) {
+        gStubControl.activated.push_back(handle);
+    }
+    return 0;
+}
+
+int SetDelay(sensors_poll_device_t*, int, int64_t) {
+    return 0;
+}
+
+int Poll(sensors_poll_device_t*, sensors_event_t* data, int count) {
+    std::unique_lock<std::mutex> lock(gStubControl.lock);
+    gStubControl.cv.wait(lock, [] { return !gStubControl.events.empty(); });
+    int n = 0;
+    while (n < count && !gStubControl.events.empty()) {
+        data[n++] = gStubControl.events.front();
+        gStubControl.events.pop_front();
+    }
+    return n;
+}
+
+int Batch(sensors_poll_device_1_t*, int handle, int, int64_t periodNs, int64_t latencyNs) {
+    std::lock_guard<std::mutex> lock(gStubControl.lock);
+    gStubControl.batches.push_back({handle, periodNs, latencyNs});
+    return 0;
+}
+
+int Flush(sensors_poll_device_1_t*, int) {
+    return 0;
+}
+
+int InjectSensorData(sensors_poll_device_1_t*, const sensors_event_t*) {
+    return 0;
+}
+
+int RegisterDirectChannel(sensors_poll_device_1_t*, const sensors_direct_mem_t*,
+                          int channelHandle) {
+    std::lock_guard<std::mutex> lock(gStubControl.lock);
+    gStubControl.directChannels++;
+    return channelHandle;
+}
+
+int ConfigDirectReport(sensors_poll_device_1_t*, int, int, const sensors_direct_cfg_t* config) {
+    std::lock_guard<std::mutex> lock(gStubControl.lock);
+    gStubControl.directReports++;
+    return config->rate_level;
+}
+
+int Close(hw_device_t* device) {
+    delete reinterpret_cast<sensors_poll_device_1_t*>(device);
+    return 0;
+}
+
+int Open(const hw_module_t* module, const char* id, hw_device_t** device) {
+    if (strcmp(id, SENSORS_HARDWARE_POLL) != 0) {
+        return -EINVAL;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(gStubControl.lock);
+        gStubControl.opens++;
+    }
+
+    sensors_poll_device_1_t* dev = new sensors_poll_device_1_t();
+    dev->common.tag = HARDWARE_DEVICE_TAG;
+    dev->common.version = SENSORS_DEVICE_API_VERSION_1_4;
+    dev->common.module = const_cast<hw_module_t*>(module);
+    dev->common.close = Close;
+    dev->activate = Activate;
+    dev->setDelay = SetDelay;
+    dev->poll = Poll;
+    dev->batch = Batch;
+    dev->flush = Flush;
+    dev->inject_sensor_data = InjectSensorData;
+    dev->register_direct_channel = RegisterDirectChannel;
+    dev->config_direct_report = ConfigDirectReport;
+
+    *device = &dev->common;
+    return 0;
+}
+
+int GetSensorsList(sensors_module_t*, const sensor_t** list) {
+    *list = kSensors;
+    return sizeof(kSensors) / sizeof(kSensors[0]);
+}
+
+int SetOperationMode(unsigned int mode) {
+    std::lock_guard<std::mutex> lock(gStubControl.lock);
+    gStubControl.mode = mode;
+    return 0;
+}
+
+hw_module_methods_t sModuleMethods = {
+        .open = Open,
+};
+
+}  // anonymous namespace
+
+sensors_module_t HAL_MODULE_INFO_SYM = {
+        .common =
+                {
+                        .tag = HARDWARE_MODULE_TAG,
+                        .module_api_version = SENSORS_MODULE_API_VERSION_0_1,
+                        .hal_api_version = HARDWARE_HAL_API_VERSION,
+                        .id = SENSORS_HARDWARE_MODULE_ID,
+                        .name = "Stub sensors sub-HAL",
+                        .author = "The LineageOS Project",
+                        .methods = &sModuleMethods,
+                },
+        .get_sensors_list = GetSensorsList,
+        .set_operation_mode = SetOperationMode,
+};
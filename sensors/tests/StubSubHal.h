@@ -0,0 +1,76 @@
+/*
+ * Copyright (C) 2021 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <hardware/sensors.h>
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <vector>
+
+namespace subhal {
+namespace testing {
+
+// Steers the stub sub-HAL, which the test finds by looking up
+// kStubControlSymbol in it.
+struct StubControl {
+    struct Batch {
+        int handle;
+        int64_t periodNs;
+        int64_t latencyNs;
+    };
+
+    std::mutex lock;
+    std::condition_variable cv;
+
+    int opens = 0;
+    std::vector<Batch> batches;
+    std::vector<int> activated;
+    int directChannels = 0;
+    int directReports = 0;
+    unsigned int mode = SENSOR_HAL_NORMAL_MODE;
+
+    // activate() waits for this to be cleared, with inActivate set.
+    bool blockActivate = false;
+    bool inActivate = false;
+
+    // poll() waits for events.
+    std::deque<sensors_event_t> events;
+
+    void reset() {
+        std::lock_guard<std::mutex> guard(lock);
+        opens = 0;
+        batches.clear();
+        activated.clear();
+        directChannels = 0;
+        directReports = 0;
+        mode = SENSOR_HAL_NORMAL_MODE;
+        blockActivate = false;
+        inActivate = false;
+        events.clear();
+    }
+};
+
+constexpr const char* kStubControlSymbol = "gStubControl";
+
+// Sensor handles the stub announces.
+constexpr int kStubAccelHandle = 1;
+constexpr int kStubLightHandle = 2;
+
+}  // namespace testing
+}  // namespace subhal
@@ -0,0 +1,191 @@
+/*
+ * Copyright (C) 2021 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Loads a stub sub-HAL through SubHal and checks what reaches it, and when.
+
+#include <dlfcn.h>
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include <android-base/file.h>
+#include <gtest/gtest.h>
+
+#include "../SubHal.h"
+#include "StubSubHal.h"
+
+namespace subhal {
+namespace {
+
+using testing::kStubAccelHandle;
+using testing::kStubControlSymbol;
+using testing::kStubLightHandle;
+using testing::StubControl;
+
+constexpr auto kTimeout = std::chrono::seconds(5);
+
+class SubHalTest : public ::testing::Test {
+  protected:
+    void SetUp() override {
+        library_ = android::base::GetExecutableDirectory() + "/sensors.stub_subhal.so";
+        // Stays loaded, SubHal gets the same instance.
+        void* handle = dlopen(library_.c_str(), RTLD_NOW);
+        ASSERT_NE(handle, nullptr) << dlerror();
+        stub_ = static_cast<StubControl*>(dlsym(handle, kStubControlSymbol));
+        ASSERT_NE(stub_, nullptr);
+        stub_->reset();
+        cache_ = std::string(cache_dir_.path) + "/stub.list";
+    }
+
+    // A lazy sub-HAL which finds the list cached by an earlier boot.
+    std::unique_ptr<SubHal> cachedLazySubHal() {
+        SubHal earlier(library_, true, cache_);
+        const sensor_t* list;
+        earlier.getSensorsList(&list);
+        stub_->reset();
+        return std::make_unique<SubHal>(library_, true, cache_);
+    }
+
+    int opens() {
+        std::lock_guard<std::mutex> lock(stub_->lock);
+        return stub_->opens;
+    }
+
+    std::string library_;
+    TemporaryDir cache_dir_;
+    std::string cache_;
+    StubControl* stub_ = nullptr;
+};
+
+TEST_F(SubHalTest, DeviceVersionIsPassedThrough) {
+    SubHal hal(library_, false, cache_);
+    ASSERT_EQ(hal.open(), 0);
+
+    const sensor_t* list;
+    EXPECT_EQ(hal.getSensorsList(&list), 2);
+    EXPECT_EQ(hal.deviceVersion(), SENSORS_DEVICE_API_VERSION_1_4);
+    EXPECT_EQ(opens(), 1);
+}
+
+TEST_F(SubHalTest, LazySubHalLoadsOnFirstActivation) {
+    std::unique_ptr<SubHal> hal = cachedLazySubHal();
+
+    const sensor_t* list;
+    ASSERT_EQ(hal->getSensorsList(&list), 2);
+    EXPECT_EQ(list[0].handle, kStubAccelHandle);
+    EXPECT_EQ(hal->deviceVersion(), SENSORS_DEVICE_API_VERSION_1_4);
+    ASSERT_EQ(hal->open(), 0);
+    EXPECT_EQ(hal->batch(kStubAccelHandle, 0, 20000000, 0), 0);
+    EXPECT_EQ(opens(), 0);
+
+    ASSERT_EQ(hal->activate(kStubAccelHandle, 1), 0);
+
+    EXPECT_EQ(opens(), 1);
+    ASSERT_EQ(stub_->batches.size(), 1u);
+    EXPECT_EQ(stub_->batches[0].handle, kStubAccelHandle);
+    EXPECT_EQ(stub_->batches[0].periodNs, 20000000);
+    EXPECT_EQ(stub_->activated, std::vector<int>({kStubAccelHandle}));
+}
+
+TEST_F(SubHalTest, PollIsNotHeldUpByASlowActivation) {
+    SubHal hal(library_, false, cache_);
+    ASSERT_EQ(hal.open(), 0);
+
+    {
+        std::lock_guard<std::mutex> lock(stub_->lock);
+        stub_->blockActivate = true;
+    }
+    std::thread activation([&hal] { hal.activate(kStubLightHandle, 1); });
+    {
+        std::unique_lock<std::mutex> lock(stub_->lock);
+        ASSERT_TRUE(stub_->cv.wait_for(lock, kTimeout, [this] { return stub_->inActivate; }));
+        sensors_event_t event = {};
+        event.sensor = kStubAccelHandle;
+        stub_->events.push_back(event);
+        stub_->cv.notify_all();
+    }
+
+    sensors_event_t events[4];
+    auto polled = std::async(std::launch::async, [&] { return hal.poll(events, 4); });
+    bool returned = polled.wait_for(kTimeout) == std::future_status::ready;
+
+    {
+        std::lock_guard<std::mutex> lock(stub_->lock);
+        stub_->blockActivate = false;
+        stub_->cv.notify_all();
+    }
+    activation.join();
+
+    ASSERT_TRUE(returned);
+    EXPECT_EQ(polled.get(), 1);
+    EXPECT_EQ(events[0].sensor, kStubAccelHandle);
+}
+
+TEST_F(SubHalTest, PollParksWhenTheSubHalFailsToLoad) {
+    // Outlives the test, the polling thread never comes back.
+    auto* hal = new SubHal(library_ + ".missing", true, cache_);
+    const sensor_t* list;
+    EXPECT_EQ(hal->getSensorsList(&list), 0);
+    EXPECT_EQ(hal->activate(kStubAccelHandle, 1), -ENODEV);
+
+    auto returned = std::make_shared<std::atomic<bool>>(false);
+    std::thread([hal, returned] {
+        sensors_event_t events[4];
+        hal->poll(events, 4);
+        *returned = true;
+    }).detach();
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    EXPECT_FALSE(*returned);
+}
+
+TEST_F(SubHalTest, DirectChannelIsForwarded) {
+    SubHal hal(library_, false, cache_);
+    ASSERT_EQ(hal.open(), 0);
+
+    sensors_direct_mem_t mem = {};
+    sensors_direct_cfg_t config = {.rate_level = 2};
+    EXPECT_EQ(hal.registerDirectChannel(&mem, 7), 7);
+    EXPECT_EQ(hal.configDirectReport(kStubAccelHandle, 7, &config), 2);
+    EXPECT_EQ(stub_->directChannels, 1);
+    EXPECT_EQ(stub_->directReports, 1);
+}
+
+TEST_F(SubHalTest, OperationModeIsForwarded) {
+    SubHal hal(library_, false, cache_);
+    ASSERT_EQ(hal.open(), 0);
+
+    EXPECT_EQ(hal.setOperationMode(SENSOR_HAL_DATA_INJECTION_MODE), 0);
+    EXPECT_EQ(stub_->mode, static_cast<unsigned int>(SENSOR_HAL_DATA_INJECTION_MODE));
+    EXPECT_EQ(hal.setOperationMode(SENSOR_HAL_NORMAL_MODE), 0);
+    EXPECT_EQ(stub_->mode, static_cast<unsigned int>(SENSOR_HAL_NORMAL_MODE));
+}
+
+TEST_F(SubHalTest, LazySubHalIsNotLoadedForNoOps) {
+    std::unique_ptr<SubHal> hal = cachedLazySubHal();
+    ASSERT_EQ(hal->open(), 0);
+
+    EXPECT_EQ(hal->setOperationMode(SENSOR_HAL_NORMAL_MODE), 0);
+    EXPECT_EQ(hal->registerDirectChannel(nullptr, 7), 0);
+    EXPECT_EQ(hal->activate(kStubAccelHandle, 0), 0);
+    EXPECT_EQ(opens(), 0);
+}
+
+}  // namespace
+}  // namespace subhal
@@ -22,17 +22,22 @@ BOARD_VENDOR_SEPOLICY_DIRS += \
 
 # Xiaomi Sepolicy
 BOARD_VENDOR_SEPOLICY_DIRS += \
+    device/xiaomi/raphael/sepolicy/vendor/xiaomi/apptune \
     device/xiaomi/raphael/sepolicy/vendor/xiaomi/audio \
     device/xiaomi/raphael/sepolicy/vendor/xiaomi/battery \
     device/xiaomi/raphael/sepolicy/vendor/xiaomi/camera \
     device/xiaomi/raphael/sepolicy/vendor/xiaomi/fingerprint \
     device/xiaomi/raphael/sepolicy/vendor/xiaomi/fod \
+    device/xiaomi/raphael/sepolicy/vendor/xiaomi/iotune \
     device/xiaomi/raphael/sepolicy/vendor/xiaomi/last_kmsg \
     device/xiaomi/raphael/sepolicy/vendor/xiaomi/light \
+    device/xiaomi/raphael/sepolicy/vendor/xiaomi/memtune \
     device/xiaomi/raphael/sepolicy/vendor/xiaomi/motor \
     device/xiaomi/raphael/sepolicy/vendor/xiaomi/mlipay \
     device/xiaomi/raphael/sepolicy/vendor/xiaomi/parts \
+    device/xiaomi/raphael/sepolicy/vendor/xiaomi/popupcamera \
     device/xiaomi/raphael/sepolicy/vendor/xiaomi/power \
+    device/xiaomi/raphael/sepolicy/vendor/xiaomi/prefetch \
     device/xiaomi/raphael/sepolicy/vendor/xiaomi/radio \
     device/xiaomi/raphael/sepolicy/vendor/xiaomi/sensors \
     device/xiaomi/raphael/sepolicy/vendor/xiaomi/thermald \
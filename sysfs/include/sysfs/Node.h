@@ -0,0 +1,204 @@
+/*
+ * Copyright (C) 2021 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <fcntl.h>
+#include <glob.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <charconv>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#include <android-base/logging.h>
+#include <android-base/unique_fd.h>
+
+namespace sysfs {
+
+namespace internal {
+
+// Only sysfs::testing::FakeSysfs, in libsysfs_testing.raphael, changes it.
+inline std::string& MutableRoot() {
+    static std::string sRoot;
+    return sRoot;
+}
+
+}  // namespace internal
+
+// Prefix prepended to every path opened through this header. Services have
+// no way to set it, it is only ever non-empty under the test fixture.
+inline const std::string& Root() {
+    return internal::MutableRoot();
+}
+
+// Expands a glob below Root(), the returned paths are relative to it.
+inline std::vector<std::string> Glob(const std::string& pattern) {
+    std::vector<std::string> paths;
+    glob_t g;
+    if (::glob((Root() + pattern).c_str(), GLOB_NOSORT, nullptr, &g) == 0) {
+        for (size_t i = 0; i < g.gl_pathc; i++) {
+            paths.emplace_back(g.gl_pathv[i] + Root().size());
+        }
+    }
+    globfree(&g);
+    return paths;
+}
+
+// A sysfs attribute with a persistent fd. Every access is a single pread or
+// pwrite at offset 0, so the fd never has to be reopened or rewound.
+class Node {
+  public:
+    Node() = default;
+    explicit Node(const std::string& path, int flags = O_RDWR) { open(path, flags); }
+
+    Node(Node&&) = default;
+    Node& operator=(Node&&) = default;
+
+    bool open(const std::string& path, int flags = O_RDWR) {
+        if (!openOptional(path, flags)) {
+            PLOG(ERROR) << "Failed to open " << path_;
+            return false;
+        }
+        return true;
+    }
+
+    // Like open(), for attributes only some kernels or panels have. Failing
+    // to open one is not an error, so it is left to the caller to report.
+    bool openOptional(const std::string& path, int flags = O_RDWR) {
+        path_ = path;
+        fd_.reset(TEMP_FAILURE_RETRY(::open((Root() + path).c_str(), flags | O_CLOEXEC)));
+        return fd_ >= 0;
+    }
+
+    bool valid() const { return fd_ >= 0; }
+    int fd() const { return fd_; }
+    const std::string& path() const { return path_; }
+
+    // Reads the whole attribute, without the trailing newline.
+    bool read(std::string* out) const {
+        char buf[4096];
+        ssize_t len = readRaw(buf, sizeof(buf));
+        if (len < 0) {
+            return false;
+        }
+        while (len > 0 && (buf[len - 1] == '\n' || buf[len - 1] == ' ')) {
+            len--;
+        }
+        out->assign(buf, len);
+        return true;
+    }
+
+    template <typename T, typename = std::enable_if_t<std::is_integral_v<T>>>
+    bool read(T* out) const {
+        char buf[32];
+        ssize_t len = readRaw(buf, sizeof(buf));
+        if (len < 0) {
+            return false;
+        }
+
+        const char* begin = buf;
+        const char* end = buf + len;
+        while (begin < end && *begin == ' ') {
+            begin++;
+        }
+
+        if constexpr (std::is_same_v<T, bool>) {
+            int value;
+            if (std::from_chars(begin, end, value).ec != std::errc()) {
+                LOG(ERROR) << "Malformed value in " << path_;
+                return false;
+            }
+            *out = value != 0;
+        } else {
+            if (std::from_chars(begin, end, *out).ec != std::errc()) {
+                LOG(ERROR) << "Malformed value in " << path_;
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool write(std::string_view value) const {
+        if (TEMP_FAILURE_RETRY(pwrite(fd_, value.data(), value.size(), 0)) < 0) {
+            PLOG(ERROR) << "Failed to write " << path_;
+            return false;
+        }
+        return true;
+    }
+
+    bool write(const char* value) const { return write(std::string_view(value)); }
+    bool write(const std::string& value) const { return write(std::string_view(value)); }
+
+    template <typename T, typename = std::enable_if_t<std::is_integral_v<T>>>
+    bool write(T value) const {
+        char buf[24];
+        if constexpr (std::is_same_v<T, bool>) {
+            return write(std::string_view(value ? "1" : "0"));
+        } else {
+            auto [end, ec] = std::to_chars(buf, buf + sizeof(buf), value);
+            return write(std::string_view(buf, end - buf));
+        }
+    }
+
+    // Blocks until the kernel signals a change through sysfs_notify(). The
+    // attribute has to be read after every wakeup to rearm the notification.
+    // Returns false on timeout or error.
+    bool waitForChange(int timeoutMs = -1) const {
+        struct pollfd pfd = {
+                .fd = fd_,
+                .events = POLLERR | POLLPRI,
+                .revents = 0,
+        };
+        int rc = TEMP_FAILURE_RETRY(poll(&pfd, 1, timeoutMs));
+        if (rc < 0) {
+            PLOG(ERROR) << "Failed to poll " << path_;
+        }
+        return rc > 0;
+    }
+
+  private:
+    ssize_t readRaw(char* buf, size_t size) const {
+        ssize_t len = TEMP_FAILURE_RETRY(pread(fd_, buf, size, 0));
+        if (len < 0) {
+            PLOG(ERROR) << "Failed to read " << path_;
+        }
+        return len;
+    }
+
+    std::string path_;
+    android::base::unique_fd fd_;
+};
+
+// One-off accesses, for attributes which are touched too rarely to keep an
+// fd around.
+template <typename T>
+bool ReadValue(const std::string& path, T* out) {
+    Node node(path, O_RDONLY);
+    return node.valid() && node.read(out);
+}
+
+template <typename T>
+bool WriteValue(const std::string& path, const T& value) {
+    Node node(path, O_WRONLY);
+    return node.valid() && node.write(value);
+}
+
+}  // namespace sysfs
@@ -0,0 +1,433 @@
+/*
+ * Copyright (C) 2021 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Built without fortification, so the plain syscall wrappers can be
+// replaced below.
+#undef _FORTIFY_SOURCE
+
+#include <sysfs/testing/FakeSysfs.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <ftw.h>
+#include <limits.h>
+#include <poll.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <sysfs/Node.h>
+
+namespace sysfs {
+namespace testing {
+
+namespace {
+
+FakeSysfs* gFake = nullptr;
+
+// The real syscalls, issued directly so they never recurse into the
+// interposers below.
+int RawOpen(const char* path, int flags, mode_t mode) {
+    return syscall(SYS_openat, AT_FDCWD, path, flags, mode);
+}
+
+ssize_t RawPread(int fd, void* buf, size_t count, off64_t offset) {
+    return syscall(SYS_pread64, fd, buf, count, offset);
+}
+
+ssize_t RawPwrite(int fd, const void* buf, size_t count, off64_t offset) {
+    return syscall(SYS_pwrite64, fd, buf, count, offset);
+}
+
+ssize_t RawRead(int fd, void* buf, size_t count) {
+    return syscall(SYS_read, fd, buf, count);
+}
+
+ssize_t RawWrite(int fd, const void* buf, size_t count) {
+    return syscall(SYS_write, fd, buf, count);
+}
+
+int RawPoll(struct pollfd* fds, nfds_t nfds, int timeoutMs) {
+    struct timespec ts = {
+            .tv_sec = timeoutMs / 1000,
+            .tv_nsec = (timeoutMs % 1000) * 1000000L,
+    };
+    return syscall(SYS_ppoll, fds, nfds, timeoutMs < 0 ? nullptr : &ts, nullptr, 0);
+}
+
+void MakeDirs(const std::string& path) {
+    for (size_t pos = 1; pos != std::string::npos; pos = path.find('/', pos + 1)) {
+        mkdir(path.substr(0, pos).c_str(), 0755);
+    }
+    mkdir(path.c_str(), 0755);
+}
+
+void WriteFile(const std::string& path, std::string_view value) {
+    int fd = RawOpen(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    CHECK(fd >= 0) << "Failed to create " << path;
+    CHECK_EQ(RawWrite(fd, value.data(), value.size()), static_cast<ssize_t>(value.size()));
+    close(fd);
+}
+
+std::string ReadFile(const std::string& path) {
+    int fd = RawOpen(path.c_str(), O_RDONLY | O_CLOEXEC, 0);
+    if (fd < 0) {
+        return "";
+    }
+    std::string value;
+    char buf[4096];
+    for (ssize_t len; (len = RawRead(fd, buf, sizeof(buf))) > 0;) {
+        value.append(buf, len);
+    }
+    close(fd);
+    return value;
+}
+
+int RemoveEntry(const char* path, const struct stat*, int, struct FTW*) {
+    return remove(path);
+}
+
+}  // namespace
+
+FakeSysfs::FakeSysfs() {
+#ifdef __ANDROID__
+    std::string tmpl = "/data/local/tmp/sysfs.XXXXXX";
+#else
+    std::string tmpl = std::string(getenv("TMPDIR") ?: "/tmp") + "/sysfs.XXXXXX";
+#endif
+    CHECK(mkdtemp(tmpl.data()) != nullptr) << "Failed to create " << tmpl;
+    char real[PATH_MAX];
+    CHECK(realpath(tmpl.c_str(), real) != nullptr);
+    root_ = real;
+
+    CHECK(gFake == nullptr) << "Only one FakeSysfs may exist at a time";
+    gFake = this;
+    internal::MutableRoot() = root_;
+}
+
+FakeSysfs::~FakeSysfs() {
+    internal::MutableRoot().clear();
+    gFake = nullptr;
+    for (const auto& [path, fds] : notify_pipes_) {
+        close(fds.first);
+        close(fds.second);
+    }
+    for (const auto& [path, fd] : fifos_) {
+        close(fd);
+    }
+    nftw(root_.c_str(), RemoveEntry, 16, FTW_DEPTH | FTW_PHYS);
+}
+
+void FakeSysfs::add(const std::string& path, std::string_view value) {
+    MakeDirs(root_ + path.substr(0, path.rfind('/')));
+    WriteFile(root_ + path, value);
+}
+
+void FakeSysfs::addDir(const std::string& path) {
+    MakeDirs(root_ + path);
+}
+
+void FakeSysfs::addFifo(const std::string& path) {
+    MakeDirs(root_ + path.substr(0, path.rfind('/')));
+    CHECK_EQ(mkfifo((root_ + path).c_str(), 0644), 0) << "Failed to create " << path;
+    // Held open for writing, so that readers never see a hangup.
+    int fd = RawOpen((root_ + path).c_str(), O_RDWR | O_NONBLOCK | O_CLOEXEC, 0);
+    CHECK(fd >= 0) << "Failed to open " << path;
+    std::lock_guard<std::mutex> lock(lock_);
+    fifos_[path] = fd;
+}
+
+void FakeSysfs::feed(const std::string& path, const void* data, size_t size) {
+    int fd;
+    {
+        std::lock_guard<std::mutex> lock(lock_);
+        auto it = fifos_.find(path);
+        CHECK(it != fifos_.end()) << path << " is not a FIFO";
+        fd = it->second;
+    }
+    CHECK_EQ(RawWrite(fd, data, size), static_cast<ssize_t>(size));
+}
+
+size_t FakeSysfs::queued(const std::string& path) const {
+    std::lock_guard<std::mutex> lock(lock_);
+    auto it = fifos_.find(path);
+    CHECK(it != fifos_.end()) << path << " is not a FIFO";
+    int size = 0;
+    CHECK_EQ(ioctl(it->second, FIONREAD, &size), 0);
+    return size;
+}
+
+void FakeSysfs::set(const std::string& path, std::string_view value) {
+    WriteFile(root_ + path, value);
+}
+
+std::string FakeSysfs::value(const std::string& path) const {
+    std::string value = ReadFile(root_ + path);
+    while (!value.empty() && (value.back() == '\n' || value.back() == ' ')) {
+        value.pop_back();
+    }
+    return value;
+}
+
+void FakeSysfs::notify(const std::string& path) {
+    char c = 0;
+    CHECK_EQ(RawWrite(notifyPipe(path).second, &c, 1), 1);
+}
+
+std::vector<std::string> FakeSysfs::writes(const std::string& path) const {
+    std::lock_guard<std::mutex> lock(lock_);
+    std::vector<std::string> values;
+    for (const auto& [written, value] : writes_) {
+        if (written == path) {
+            values.push_back(value);
+        }
+    }
+    return values;
+}
+
+std::vector<std::string> FakeSysfs::allWrites() const {
+    std::lock_guard<std::mutex> lock(lock_);
+    std::vector<std::string> entries;
+    for (const auto& [path, value] : writes_) {
+        entries.push_back(path + "=" + value);
+    }
+    return entries;
+}
+
+IoCounts FakeSysfs::counts() const {
+    std::lock_guard<std::mutex> lock(lock_);
+    IoCounts total;
+    for (const auto& [path, c] : counts_) {
+        total.opens += c.opens;
+        total.reads += c.reads;
+        total.writes += c.writes;
+        total.polls += c.polls;
+    }
+    return total;
+}
+
+IoCounts FakeSysfs::counts(const std::string& path) const {
+    std::lock_guard<std::mutex> lock(lock_);
+    auto it = counts_.find(path);
+    return it != counts_.end() ? it->second : IoCounts();
+}
+
+void FakeSysfs::resetCounts() {
+    std::lock_guard<std::mutex> lock(lock_);
+    counts_.clear();
+    writes_.clear();
+}
+
+// Returns the path below the root which fd refers to, or an empty string.
+std::string FakeSysfs::fakePath(int fd) const {
+    char link[PATH_MAX];
+    ssize_t len = readlink(("/proc/self/fd/" + std::to_string(fd)).c_str(), link, sizeof(link));
+    if (len <= static_cast<ssize_t>(root_.size()) || root_.compare(0, root_.size(), link, root_.size()) != 0 ||
+        link[root_.size()] != '/') {
+        return "";
+    }
+    return std::string(link + root_.size(), len - root_.size());
+}
+
+// Returns the pipe standing in for notifications on path.
+std::pair<int, int> FakeSysfs::notifyPipe(const std::string& path) {
+    std::lock_guard<std::mutex> lock(lock_);
+    auto it = notify_pipes_.find(path);
+    if (it == notify_pipes_.end()) {
+        int fds[2];
+        CHECK_EQ(pipe2(fds, O_CLOEXEC), 0);
+        it = notify_pipes_.emplace(path, std::make_pair(fds[0], fds[1])).first;
+    }
+    return it->second;
+}
+
+struct FakeSysfs::Interposer {
+    static int open(const char* path, int flags, mode_t mode) {
+        int fd = RawOpen(path, flags, mode);
+        FakeSysfs* fake = gFake;
+        if (fd >= 0 && fake != nullptr) {
+            std::string fakePath = fake->fakePath(fd);
+            if (!fakePath.empty()) {
+                std::lock_guard<std::mutex> lock(fake->lock_);
+                fake->counts_[fakePath].opens++;
+            }
+        }
+        return fd;
+    }
+
+    static ssize_t read(int fd, void* buf, size_t count, off64_t offset, bool positional) {
+        FakeSysfs* fake = gFake;
+        if (fake != nullptr) {
+            std::string fakePath = fake->fakePath(fd);
+            if (!fakePath.empty()) {
+                std::lock_guard<std::mutex> lock(fake->lock_);
+                fake->counts_[fakePath].reads++;
+            }
+        }
+        return positional ? RawPread(fd, buf, count, offset) : RawRead(fd, buf, count);
+    }
+
+    static ssize_t write(int fd, const void* buf, size_t count, off64_t offset, bool positional) {
+        FakeSysfs* fake = gFake;
+        std::string fakePath = fake != nullptr ? fake->fakePath(fd) : "";
+        if (fakePath.empty()) {
+            return positional ? RawPwrite(fd, buf, count, offset) : RawWrite(fd, buf, count);
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(fake->lock_);
+            fake->counts_[fakePath].writes++;
+            fake->writes_.emplace_back(fakePath, std::string(static_cast<const char*>(buf), count));
+        }
+        struct stat st;
+        if (fstat(fd, &st) < 0 || !S_ISREG(st.st_mode)) {
+            return RawWrite(fd, buf, count);
+        }
+        // A sysfs store replaces the whole attribute, wherever the fd points.
+        ssize_t len = RawPwrite(fd, buf, count, 0);
+        if (len >= 0) {
+            ftruncate(fd, len);
+        }
+        return len;
+    }
+
+    static int poll(struct pollfd* fds, nfds_t nfds, int timeoutMs) {
+        FakeSysfs* fake = gFake;
+        if (fake == nullptr) {
+            return RawPoll(fds, nfds, timeoutMs);
+        }
+
+        // Regular files are always readable, so stand in a pipe for every
+        // attribute polled for POLLPRI, which only notify() makes readable.
+        std::vector<struct pollfd> polled(fds, fds + nfds);
+        std::vector<bool> swapped(nfds, false);
+        for (nfds_t i = 0; i < nfds; i++) {
+            if (!(fds[i].events & POLLPRI)) {
+                continue;
+            }
+            std::string fakePath = fake->fakePath(fds[i].fd);
+            if (fakePath.empty()) {
+                continue;
+            }
+            {
+                std::lock_guard<std::mutex> lock(fake->lock_);
+                fake->counts_[fakePath].polls++;
+            }
+            polled[i].fd = fake->notifyPipe(fakePath).first;
+            polled[i].events = POLLIN;
+            swapped[i] = true;
+        }
+
+        int rc = RawPoll(polled.data(), nfds, timeoutMs);
+        if (rc < 0) {
+            return rc;
+        }
+        for (nfds_t i = 0; i < nfds; i++) {
+            fds[i].revents = polled[i].revents;
+            if (swapped[i] && (polled[i].revents & POLLIN)) {
+                char c;
+                RawRead(polled[i].fd, &c, 1);
+                fds[i].revents = POLLPRI | POLLERR;
+            }
+        }
+        return rc;
+    }
+};
+
+}  // namespace testing
+}  // namespace sysfs
+
+using sysfs::testing::FakeSysfs;
+
+#define OPEN_MODE(flags)                                         \
+    ({                                                           \
+        mode_t mode = 0;                                         \
+        if ((flags) & (O_CREAT | O_TMPFILE)) {                   \
+            va_list args;                                        \
+            va_start(args, flags);                               \
+            mode = static_cast<mode_t>(va_arg(args, int));       \
+            va_end(args);                                        \
+        }                                                        \
+        mode;                                                    \
+    })
+
+extern "C" {
+
+int open(const char* path, int flags, ...) {
+    return FakeSysfs::Interposer::open(path, flags, OPEN_MODE(flags));
+}
+
+int open64(const char* path, int flags, ...) {
+    return FakeSysfs::Interposer::open(path, flags, OPEN_MODE(flags));
+}
+
+int __open_2(const char* path, int flags) {
+    return FakeSysfs::Interposer::open(path, flags, 0);
+}
+
+int __open64_2(const char* path, int flags) {
+    return FakeSysfs::Interposer::open(path, flags, 0);
+}
+
+ssize_t read(int fd, void* buf, size_t count) {
+    return FakeSysfs::Interposer::read(fd, buf, count, 0, false);
+}
+
+ssize_t __read_chk(int fd, void* buf, size_t count, size_t) {
+    return FakeSysfs::Interposer::read(fd, buf, count, 0, false);
+}
+
+ssize_t pread(int fd, void* buf, size_t count, off_t offset) {
+    return FakeSysfs::Interposer::read(fd, buf, count, offset, true);
+}
+
+ssize_t pread64(int fd, void* buf, size_t count, off64_t offset) {
+    return FakeSysfs::Interposer::read(fd, buf, count, offset, true);
+}
+
+ssize_t __pread_chk(int fd, void* buf, size_t count, off_t offset, size_t) {
+    return FakeSysfs::Interposer::read(fd, buf, count, offset, true);
+}
+
+ssize_t __pread64_chk(int fd, void* buf, size_t count, off64_t offset, size_t) {
+    return FakeSysfs::Interposer::read(fd, buf, count, offset, true);
+}
+
+ssize_t write(int fd, const void* buf, size_t count) {
+    return FakeSysfs::Interposer::write(fd, buf, count, 0, false);
+}
+
+ssize_t pwrite(int fd, const void* buf, size_t count, off_t offset) {
+    return FakeSysfs::Interposer::write(fd, buf, count, offset, true);
+}
+
+ssize_t pwrite64(int fd, const void* buf, size_t count, off64_t offset) {
+    return FakeSysfs::Interposer::write(fd, buf, count, offset, true);
+}
+
+int poll(struct pollfd* fds, nfds_t nfds, int timeout) {
+    return FakeSysfs::Interposer::poll(fds, nfds, timeout);
+}
+
+int __poll_chk(struct pollfd* fds, nfds_t nfds, int timeout, size_t) {
+    return FakeSysfs::Interposer::poll(fds, nfds, timeout);
+}
+
+}  // extern "C"
@@ -0,0 +1,111 @@
+/*
+ * Copyright (C) 2021 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <stddef.h>
+
+#include <map>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace sysfs {
+namespace testing {
+
+// Syscalls the code under test issued on files below the fake root.
+struct IoCounts {
+    size_t opens = 0;
+    size_t reads = 0;
+    size_t writes = 0;
+    size_t polls = 0;
+
+    bool operator==(const IoCounts& o) const {
+        return opens == o.opens && reads == o.reads && writes == o.writes && polls == o.polls;
+    }
+};
+
+// A temporary directory standing in for sysfs, /dev and /proc. Creating one
+// points sysfs::Root() at it, destroying it removes the tree and resets the
+// root.
+//
+// Linking the fixture interposes open, read, write and poll, along with their
+// positional and fortified variants. Calls on files below the root are
+// counted, and emulate what the kernel does for sysfs attributes: a write
+// replaces the whole value, and POLLPRI is only raised by notify().
+// Everything else is passed straight through. Only one fixture
+// may exist at a time.
+class FakeSysfs {
+  public:
+    FakeSysfs();
+    ~FakeSysfs();
+
+    FakeSysfs(const FakeSysfs&) = delete;
+    FakeSysfs& operator=(const FakeSysfs&) = delete;
+
+    const std::string& root() const { return root_; }
+
+    // Creates an attribute holding value, along with its parent directories.
+    void add(const std::string& path, std::string_view value = "");
+    void addDir(const std::string& path);
+    // Creates a FIFO, for character devices such as evdev nodes.
+    void addFifo(const std::string& path);
+    // Queues data on a FIFO for the code under test to read, without
+    // counting it as a write.
+    void feed(const std::string& path, const void* data, size_t size);
+    // Bytes fed to a FIFO which have not been read yet.
+    size_t queued(const std::string& path) const;
+
+    // Changes an attribute the way the kernel would, without counting it as
+    // a write.
+    void set(const std::string& path, std::string_view value);
+    // The current value, without the trailing newline.
+    std::string value(const std::string& path) const;
+
+    // Raises POLLPRI on the attribute, like sysfs_notify(). Notifications
+    // are queued, one is consumed by every poll which returns it.
+    void notify(const std::string& path);
+
+    // Every value written to an attribute, in order.
+    std::vector<std::string> writes(const std::string& path) const;
+    // Every write below the root, as "<path>=<value>", in order.
+    std::vector<std::string> allWrites() const;
+
+    IoCounts counts() const;
+    IoCounts counts(const std::string& path) const;
+    void resetCounts();
+
+    // Used by the interposed syscalls.
+    struct Interposer;
+
+  private:
+    std::string fakePath(int fd) const;
+    std::pair<int, int> notifyPipe(const std::string& path);
+
+    std::string root_;
+    mutable std::mutex lock_;
+    std::map<std::string, IoCounts> counts_;
+    std::vector<std::pair<std::string, std::string>> writes_;
+    // Read and write ends of a pipe per notified attribute.
+    std::map<std::string, std::pair<int, int>> notify_pipes_;
+    // Write ends of the FIFOs.
+    std::map<std::string, int> fifos_;
+};
+
+}  // namespace testing
+}  // namespace sysfs
@@ -0,0 +1,142 @@
+/*
+ * Copyright (C) 2021 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Compares Node with the idioms it replaced. The attributes are regular
+// files in a temporary directory, which leaves out the cost of the sysfs
+// show and store callbacks but keeps every syscall the idioms issue.
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <fstream>
+#include <string>
+
+#include <android-base/file.h>
+#include <benchmark/benchmark.h>
+#include <sysfs/Node.h>
+
+namespace sysfs {
+namespace {
+
+class TempAttr {
+  public:
+    TempAttr() {
+        dir_ = std::string(getenv("TMPDIR") ?: "/tmp") + "/sysfs_bench.XXXXXX";
+        if (mkdtemp(dir_.data()) == nullptr) {
+            abort();
+        }
+        path_ = dir_ + "/attr";
+        android::base::WriteStringToFile("1324800\n", path_);
+    }
+    ~TempAttr() {
+        unlink(path_.c_str());
+        rmdir(dir_.c_str());
+    }
+
+    const std::string& path() const { return path_; }
+
+  private:
+    std::string dir_;
+    std::string path_;
+};
+
+// Lights, livedisplay and the fingerprint HAL opened the file per access.
+void BM_WriteOfstream(benchmark::State& state) {
+    TempAttr attr;
+    for (auto _ : state) {
+        std::ofstream file(attr.path());
+        file << 1324800;
+    }
+}
+BENCHMARK(BM_WriteOfstream);
+
+void BM_WriteStringToFile(benchmark::State& state) {
+    TempAttr attr;
+    for (auto _ : state) {
+        android::base::WriteStringToFile(std::to_string(1324800), attr.path());
+    }
+}
+BENCHMARK(BM_WriteStringToFile);
+
+// InputBoost kept its fd, but formatted through std::string.
+void BM_WritePwriteToString(benchmark::State& state) {
+    TempAttr attr;
+    android::base::unique_fd fd(open(attr.path().c_str(), O_WRONLY | O_CLOEXEC));
+    for (auto _ : state) {
+        std::string value = std::to_string(1324800);
+        pwrite(fd, value.c_str(), value.size(), 0);
+    }
+}
+BENCHMARK(BM_WritePwriteToString);
+
+void BM_WriteNode(benchmark::State& state) {
+    TempAttr attr;
+    Node node(attr.path(), O_WRONLY);
+    for (auto _ : state) {
+        node.write(1324800);
+    }
+}
+BENCHMARK(BM_WriteNode);
+
+void BM_ReadIfstream(benchmark::State& state) {
+    TempAttr attr;
+    for (auto _ : state) {
+        std::ifstream file(attr.path());
+        int value;
+        file >> value;
+        benchmark::DoNotOptimize(value);
+    }
+}
+BENCHMARK(BM_ReadIfstream);
+
+void BM_ReadFileToString(benchmark::State& state) {
+    TempAttr attr;
+    for (auto _ : state) {
+        std::string buf;
+        android::base::ReadFileToString(attr.path(), &buf);
+        benchmark::DoNotOptimize(std::stoi(buf));
+    }
+}
+BENCHMARK(BM_ReadFileToString);
+
+// The old fod_ui loop rewound the fd before every read.
+void BM_ReadLseek(benchmark::State& state) {
+    TempAttr attr;
+    android::base::unique_fd fd(open(attr.path().c_str(), O_RDONLY | O_CLOEXEC));
+    for (auto _ : state) {
+        char buf[16];
+        lseek(fd, 0, SEEK_SET);
+        benchmark::DoNotOptimize(read(fd, buf, sizeof(buf)));
+    }
+}
+BENCHMARK(BM_ReadLseek);
+
+void BM_ReadNode(benchmark::State& state) {
+    TempAttr attr;
+    Node node(attr.path(), O_RDONLY);
+    for (auto _ : state) {
+        int value;
+        node.read(&value);
+        benchmark::DoNotOptimize(value);
+    }
+}
+BENCHMARK(BM_ReadNode);
+
+}  // namespace
+}  // namespace sysfs
+
+BENCHMARK_MAIN();
@@ -0,0 +1,157 @@
+/*
+ * Copyright (C) 2021 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <thread>
+
+#include <gtest/gtest.h>
+#include <sysfs/Node.h>
+#include <sysfs/testing/FakeSysfs.h>
+
+namespace sysfs {
+namespace {
+
+using testing::FakeSysfs;
+using testing::IoCounts;
+
+class NodeTest : public ::testing::Test {
+  protected:
+    FakeSysfs fake_;
+};
+
+TEST_F(NodeTest, ReadsTrimmedStrings) {
+    fake_.add("/sys/a", "performance \n");
+    Node node("/sys/a", O_RDONLY);
+    std::string value;
+    ASSERT_TRUE(node.read(&value));
+    EXPECT_EQ(value, "performance");
+}
+
+TEST_F(NodeTest, ReadsIntegers) {
+    fake_.add("/sys/a", " 1804800\n");
+    fake_.add("/sys/b", "1\n");
+    fake_.add("/sys/c", "-3\n");
+
+    int64_t freq;
+    bool enabled;
+    int offset;
+    ASSERT_TRUE(Node("/sys/a", O_RDONLY).read(&freq));
+    ASSERT_TRUE(Node("/sys/b", O_RDONLY).read(&enabled));
+    ASSERT_TRUE(Node("/sys/c", O_RDONLY).read(&offset));
+    EXPECT_EQ(freq, 1804800);
+    EXPECT_TRUE(enabled);
+    EXPECT_EQ(offset, -3);
+}
+
+TEST_F(NodeTest, RejectsMalformedIntegers) {
+    fake_.add("/sys/a", "on\n");
+    int value;
+    EXPECT_FALSE(Node("/sys/a", O_RDONLY).read(&value));
+}
+
+TEST_F(NodeTest, EveryAccessIsOneSyscall) {
+    fake_.add("/sys/a", "0\n");
+    Node node("/sys/a");
+    int value;
+    for (int i = 0; i < 10; i++) {
+        ASSERT_TRUE(node.write(i));
+        ASSERT_TRUE(node.read(&value));
+        EXPECT_EQ(value, i);
+    }
+    EXPECT_EQ(fake_.counts("/sys/a"), (IoCounts{.opens = 1, .reads = 10, .writes = 10}));
+}
+
+TEST_F(NodeTest, WritesReplaceTheValue) {
+    fake_.add("/sys/a", "1804800\n");
+    Node node("/sys/a");
+    ASSERT_TRUE(node.write(300000));
+    ASSERT_TRUE(node.write(true));
+    ASSERT_TRUE(node.write("performance"));
+    EXPECT_EQ(fake_.value("/sys/a"), "performance");
+    EXPECT_EQ(fake_.writes("/sys/a"), (std::vector<std::string>{"300000", "1", "performance"}));
+}
+
+TEST_F(NodeTest, OpenFailsOnMissingNodes) {
+    Node node;
+    EXPECT_FALSE(node.open("/sys/missing"));
+    EXPECT_FALSE(node.valid());
+    EXPECT_EQ(node.path(), "/sys/missing");
+}
+
+TEST_F(NodeTest, OpenOptional) {
+    fake_.add("/sys/a", "0\n");
+    Node node;
+    EXPECT_TRUE(node.openOptional("/sys/a", O_RDONLY));
+    EXPECT_TRUE(node.valid());
+    EXPECT_FALSE(node.openOptional("/sys/missing", O_RDONLY));
+    EXPECT_FALSE(node.valid());
+}
+
+TEST_F(NodeTest, WaitForChangeTimesOut) {
+    fake_.add("/sys/a", "0\n");
+    Node node("/sys/a", O_RDONLY);
+    EXPECT_FALSE(node.waitForChange(10));
+    EXPECT_EQ(fake_.counts("/sys/a").polls, 1u);
+}
+
+TEST_F(NodeTest, WaitForChangeWakesOnNotify) {
+    fake_.add("/sys/a", "0\n");
+    Node node("/sys/a", O_RDONLY);
+
+    std::thread kernel([this] {
+        fake_.set("/sys/a", "1\n");
+        fake_.notify("/sys/a");
+    });
+    ASSERT_TRUE(node.waitForChange(1000));
+    kernel.join();
+
+    int value;
+    ASSERT_TRUE(node.read(&value));
+    EXPECT_EQ(value, 1);
+    EXPECT_EQ(fake_.counts("/sys/a").writes, 0u);
+}
+
+TEST_F(NodeTest, NotificationsAreNotLost) {
+    fake_.add("/sys/a", "0\n");
+    Node node("/sys/a", O_RDONLY);
+    // Raised while nobody is polling, like a change between the read and
+    // the next poll.
+    fake_.notify("/sys/a");
+    EXPECT_TRUE(node.waitForChange(0));
+    EXPECT_FALSE(node.waitForChange(0));
+}
+
+TEST_F(NodeTest, GlobIsRelativeToRoot) {
+    fake_.add("/sys/class/thermal/thermal_zone0/type", "cpu0\n");
+    fake_.add("/sys/class/thermal/thermal_zone1/type", "quiet_therm\n");
+    auto zones = Glob("/sys/class/thermal/thermal_zone*");
+    std::sort(zones.begin(), zones.end());
+    EXPECT_EQ(zones, (std::vector<std::string>{"/sys/class/thermal/thermal_zone0",
+                                               "/sys/class/thermal/thermal_zone1"}));
+}
+
+TEST_F(NodeTest, OneOffAccesses) {
+    fake_.add("/sys/a", "255\n");
+    int value;
+    ASSERT_TRUE(ReadValue("/sys/a", &value));
+    EXPECT_EQ(value, 255);
+    ASSERT_TRUE(WriteValue("/sys/a", 128));
+    EXPECT_EQ(fake_.value("/sys/a"), "128");
+    EXPECT_FALSE(WriteValue("/sys/missing", 1));
+}
+
+}  // namespace
+}  // namespace sysfs
@@ -17,6 +17,7 @@
 #
 
 import os
+import subprocess
 import sys
 from hashlib import sha1
 
@@ -64,6 +65,14 @@ def update():
             lines[index] = '%s|%s' % (line, hash)
 
 
+# extract_blobs.raphael hashes in parallel and skips blobs which haven't
+# changed since it last saw them, use it when it has been built
+try:
+    sys.exit(subprocess.call(['extract_blobs.raphael', 'sha1'] + sys.argv[1:] +
+                             ['proprietary-files.txt', vendorPath]))
+except OSError:
+    pass
+
 if len(sys.argv) == 2 and sys.argv[1] == '-c':
     cleanup()
 else: